@@ -214,9 +214,8 @@ void App::handle_events() {
 						game.init_game(GameMode::LOCAL_MULTIPLAYER, window_width, window_height, sound_on, end_score_to_pass);
 					else if (data2 == "online_multiplayer_as_client") {
 						game.game_mode = GameMode::ONLINE_MULTIPLAYER;
+						game.netcode_mode = NetcodeMode::SERVER_AUTHORITATIVE; // Until the server says otherwise.
 						game.connection_manager.type = "client";
-						update(); // Need to call these here for the screen to update and show the "connecting" message as the connection calls are blocking and prevent the screen from updating on its own.
-						render();
 
 						// Convert string to wstring.
 						int len = 0;
@@ -232,11 +231,10 @@ void App::handle_events() {
 
 						game.init_game(GameMode::ONLINE_MULTIPLAYER, window_width, window_height, sound_on, end_score_to_pass);
 					}
-					else if (data2 == "online_multiplayer_as_server") {
+					else if (data2 == "online_multiplayer_as_server" || data2 == "rollback_multiplayer_as_server") {
 						game.game_mode = GameMode::ONLINE_MULTIPLAYER;
+						game.netcode_mode = (data2 == "rollback_multiplayer_as_server") ? NetcodeMode::ROLLBACK : NetcodeMode::SERVER_AUTHORITATIVE;
 						game.connection_manager.type = "server";
-						update(); // // Need to call these here for the screen to update and show the "awaiting connection" message as the connection calls are blocking and prevent the screen from updating on its own.
-						render();
 
 						game.init_game(GameMode::ONLINE_MULTIPLAYER, window_width, window_height, sound_on, end_score_to_pass);
 					}
@@ -280,6 +278,7 @@ void App::handle_events() {
 
 						main_menu.buttons.emplace_back(main_menu.back_to_main_menu_button);
 						main_menu.buttons.emplace_back(main_menu.server_button);
+						main_menu.buttons.emplace_back(main_menu.rollback_server_button);
 						main_menu.buttons.emplace_back(main_menu.client_button);
 					}
 					else if (data2 == "get_end_score") {
@@ -369,14 +368,10 @@ void App::handle_events() {
 		}
 	}
 
-	if (app_state == AppState::IN_GAME) {
-		game.tick();
-	}
-
 	discord_manager.update_rpc(app_state, game.game_mode);
 }
 
-void App::update() {
+void App::update(double step_progress) {
 	SDL_RenderClear(renderer.get());
 
 	switch (app_state) {
@@ -389,20 +384,6 @@ void App::update() {
 			if (main_menu.had_error)
 				SDL_RenderCopy(renderer.get(), main_menu.error_text.texture.get(), NULL, &main_menu.error_text.rect);
 			
-			// Makes the city move in the main menu.
-			main_menu.current_frame_on_main_menu++;
-
-			main_menu.city_front_current_rect.x++;
-			if (main_menu.city_front_current_rect.x >= 3000)
-				main_menu.city_front_current_rect.x = 0;
-			
-			if (main_menu.current_frame_on_main_menu % main_menu.frames_to_city_back_swap == 0) {
-				main_menu.city_back_current_rect.x++;
-
-				if (main_menu.city_back_current_rect.x >= 3000)
-					main_menu.city_back_current_rect.x = 0;
-			}
-
 			// Render buttons in the main menu.
 			for (auto&& button : main_menu.buttons) {
 				if (button.is_hovered())
@@ -426,13 +407,18 @@ void App::update() {
 
 		case AppState::IN_GAME:
 			if (!game.has_ended) {
+				// Draw the paddles and the ball in between where the latest step left them and where they were before it.
+				SDL_Rect player_1_render_rect = game.get_render_rect(game.previous_player_1_rect, game.match.player_1, step_progress);
+				SDL_Rect player_2_render_rect = game.get_render_rect(game.previous_player_2_rect, game.match.player_2, step_progress);
+				SDL_Rect ball_render_rect = game.get_render_rect(game.previous_ball_rect, game.match.ball, step_progress);
+
 				SDL_RenderCopy(renderer.get(), game.game_background.texture.get(), NULL, &game.game_background.rect); // Render background.
-				SDL_RenderCopy(renderer.get(), game.player_1.sprite.texture.get(), NULL, &game.player_1.sprite.rect); // Render left paddle.
-				SDL_RenderCopy(renderer.get(), game.player_2.sprite.texture.get(), NULL, &game.player_2.sprite.rect); // Render right paddle.
+				SDL_RenderCopy(renderer.get(), game.player_1.sprite.texture.get(), NULL, &player_1_render_rect); // Render left paddle.
+				SDL_RenderCopy(renderer.get(), game.player_2.sprite.texture.get(), NULL, &player_2_render_rect); // Render right paddle.
 				SDL_RenderCopy(renderer.get(), game.middle_line.texture.get(), NULL, &game.middle_line.rect); // Render the vertical line in the middle of the screen.
 				SDL_RenderCopy(renderer.get(), game.player_1_score_text.texture.get(), NULL, &game.player_1_score_text.rect); // Render player 1's score.
 				SDL_RenderCopy(renderer.get(), game.player_2_score_text.texture.get(), NULL, &game.player_2_score_text.rect); // Render player 2's score.
-				SDL_RenderCopy(renderer.get(), game.ball.sprite.texture.get(), NULL, &game.ball.sprite.rect); // Render the ball.
+				SDL_RenderCopy(renderer.get(), game.ball.sprite.texture.get(), NULL, &ball_render_rect); // Render the ball.
 
 				// Render the "awaiting connection" or "connecting" messages if the game is online multiplayer but we haven't connected to someone yet.
 				if (game.game_mode == GameMode::ONLINE_MULTIPLAYER && !game.connection_manager.is_connected) {
@@ -460,12 +446,31 @@ void App::render() {
 	SDL_RenderPresent(renderer.get());
 }
 
+void App::step() {
+	switch (app_state) {
+		case AppState::MAIN_MENU:
+			main_menu.scroll_city();
+			break;
+		case AppState::IN_GAME:
+			game.tick();
+			break;
+	}
+}
+
 void App::main_loop() {
 	// Implementation of FPS lock using chrono.
 	using dsec = std::chrono::duration<double>;
-	auto casted_fps_limit = std::chrono::round<std::chrono::system_clock::duration>(dsec{ 1. / FPS_LIMIT }); // How many milliseconds will we wait for the next frame?
-	auto frame_begin_time = std::chrono::system_clock::now(); // Frame start time is now.
+	using dmsec = std::chrono::duration<double, std::milli>;
+	auto casted_fps_limit = std::chrono::steady_clock::duration::zero(); // How long will we wait for the next frame?
+	if (FPS_LIMIT > 0)
+		casted_fps_limit = std::chrono::round<std::chrono::steady_clock::duration>(dsec{ 1. / FPS_LIMIT });
+
+	auto frame_begin_time = std::chrono::steady_clock::now(); // Frame start time is now.
 	auto frame_end_time = frame_begin_time + casted_fps_limit; // Next frame will be in (time it took to process this frame) + 1000/FPS_LIMIT milliseconds.
+	auto previous_frame_begin_time = frame_begin_time;
+
+	// The game moves in fixed SIMULATION_STEP_MS steps no matter how fast we render. This is how much time has passed that it hasn't caught up with yet.
+	double step_accumulator = 0.0;
 
 	/* Uncomment this and the part inside the loop below to get reported of the framerate every second.
 	unsigned int frame_count_per_second = 0;
@@ -473,18 +478,31 @@ void App::main_loop() {
 	*/
 
 	while (app_active) {
-		if (std::chrono::system_clock::now() < frame_end_time) // If it's not the time for the next frame, wait until we're there.
+		if (std::chrono::steady_clock::now() < frame_end_time) // If it's not the time for the next frame, wait until we're there.
 			std::this_thread::sleep_until(frame_end_time);
 
-		frame_begin_time = std::chrono::system_clock::now();
+		frame_begin_time = std::chrono::steady_clock::now();
 		frame_end_time = frame_begin_time + casted_fps_limit;
 
+		step_accumulator += dmsec(frame_begin_time - previous_frame_begin_time).count();
+		previous_frame_begin_time = frame_begin_time;
+
+		if (step_accumulator > MAX_STEPS_PER_FRAME * SIMULATION_STEP_MS)
+			step_accumulator = MAX_STEPS_PER_FRAME * SIMULATION_STEP_MS;
+
 		handle_events();
-		update();
+
+		while (step_accumulator >= SIMULATION_STEP_MS) {
+			step();
+			step_accumulator -= SIMULATION_STEP_MS;
+		}
+
+		// Whatever is left over is how far we are into the next step, which is how far the paddles and the ball get drawn towards where they are now.
+		update(step_accumulator / SIMULATION_STEP_MS);
 		render();
 		
 		/*
-		auto time_in_seconds = std::chrono::time_point_cast<std::chrono::seconds>(std::chrono::system_clock::now());
+		auto time_in_seconds = std::chrono::time_point_cast<std::chrono::seconds>(std::chrono::steady_clock::now());
 		++frame_count_per_second;
 		if (time_in_seconds > previous_time_in_seconds) {
 			std::cerr << frame_count_per_second << " frames per second.\n"; // Using cerr for instant reports as it's not buffered like cout.
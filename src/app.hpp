@@ -16,6 +16,9 @@
 #include "mainmenu.hpp"
 #include "sdl_garbage_collector.hpp"
 
+// If the game falls this many steps behind (a frame took really long, like when the window is being dragged around), it skips the rest instead of trying to catch up all at once.
+#define MAX_STEPS_PER_FRAME 8
+
 enum class AppState {
 	DUMMY_VALUE,
 	MAIN_MENU,
@@ -36,7 +39,7 @@ class DiscordManager {
 
 class App {
 	protected:
-		const int FPS_LIMIT = 60;
+		const int FPS_LIMIT = 240; // Only limits how often we render, the game always moves in SIMULATION_STEP_MS steps. 0 renders as fast as we can.
 	private:
 		std::unique_ptr<SDL_Window, SDLGarbageCollector> window = nullptr;
 		std::shared_ptr<SDL_Renderer> renderer = nullptr;
@@ -61,7 +64,8 @@ class App {
 		void handle_events();
 		void play_if_sound_on(Mix_Chunk* chunk, int loops = 0);
 		void process_input(SDL_Keycode pressed_key);
-		void update();
+		void step();
+		void update(double step_progress = 1.0);
 		void render();
 		void main_loop();
 		void quit_all_subsystems();
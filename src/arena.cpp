@@ -0,0 +1,274 @@
+#include "arena.hpp"
+
+void ArenaStats::merge(const ArenaStats& other) {
+	match_count += other.match_count;
+	player_1_win_count += other.player_1_win_count;
+	player_2_win_count += other.player_2_win_count;
+	unfinished_count += other.unfinished_count;
+	tick_count += other.tick_count;
+
+	rally_count += other.rally_count;
+	hit_count += other.hit_count;
+	for (int i = 0; i <= ARENA_MAX_RALLY_LENGTH; i++)
+		rally_length_counts[i] += other.rally_length_counts[i];
+}
+
+// The shortest rally length that at least percentile percent of rallies are no longer than.
+int ArenaStats::get_rally_length_percentile(double percentile) const {
+	uint64_t seen = 0;
+	for (int i = 0; i <= ARENA_MAX_RALLY_LENGTH; i++) {
+		seen += rally_length_counts[i];
+		if (seen > 0 && seen * 100.0 >= percentile * rally_count)
+			return i;
+	}
+
+	return ARENA_MAX_RALLY_LENGTH;
+}
+
+void ArenaWorkRange::set(uint32_t begin, uint32_t end) {
+	range = (static_cast<uint64_t>(end) << 32) | begin;
+}
+
+bool ArenaWorkRange::take_front(uint32_t& index) {
+	uint64_t current = range.load();
+
+	while (true) {
+		uint32_t begin = static_cast<uint32_t>(current);
+		uint32_t end = static_cast<uint32_t>(current >> 32);
+		if (begin >= end)
+			return false;
+
+		if (range.compare_exchange_weak(current, (static_cast<uint64_t>(end) << 32) | (begin + 1))) {
+			index = begin;
+			return true;
+		}
+	}
+}
+
+bool ArenaWorkRange::steal_back_half(uint32_t& begin, uint32_t& end) {
+	uint64_t current = range.load();
+
+	while (true) {
+		uint32_t current_begin = static_cast<uint32_t>(current);
+		uint32_t current_end = static_cast<uint32_t>(current >> 32);
+		if (current_begin >= current_end)
+			return false;
+
+		// Rounds in the thief's favour, so the last match left can be stolen too.
+		uint32_t middle = current_begin + (current_end - current_begin) / 2;
+		if (range.compare_exchange_weak(current, (static_cast<uint64_t>(middle) << 32) | current_begin)) {
+			begin = middle;
+			end = current_end;
+			return true;
+		}
+	}
+}
+
+// Puts a new match in the lane, the AIs and everything else coming from the seed, so the same seed always plays out the same whichever lane or thread it ends up in.
+void start_arena_match(MatchBatch& batch, int index, ArenaLane& lane, const AiSettings& player_1_settings, const AiSettings& player_2_settings, int end_score, uint32_t seed) {
+	batch.set_match(index, create_match(end_score, seed));
+
+	lane.player_1_ai.init(player_1_settings, 1, seed * 2 + 1);
+	lane.player_2_ai.init(player_2_settings, 2, seed * 2 + 2);
+	lane.rally_length = 0;
+	lane.is_playing = true;
+}
+
+// Nothing left to play in this lane. A match that has ended costs next to nothing to step, so it can stay in the batch.
+void park_arena_lane(MatchBatch& batch, int index, ArenaLane& lane) {
+	MatchState match = create_match(1, 1);
+	match.has_ended = true;
+	batch.set_match(index, match);
+
+	lane.is_playing = false;
+}
+
+// Counts what happened to the lane's match during the last step. Returns true once the match is over, and counts how it ended too.
+bool note_arena_step(const MatchBatch& batch, int index, ArenaLane& lane, ArenaStats& stats) {
+	int events = batch.events[index];
+
+	// Only hits that send the ball back count, clipping the top or bottom of a paddle doesn't make the rally any longer.
+	if (((events & MATCH_EVENT_PLAYER_1_HIT) && batch.ball_velocity_x[index] > 0) || ((events & MATCH_EVENT_PLAYER_2_HIT) && batch.ball_velocity_x[index] < 0)) {
+		lane.rally_length++;
+		stats.hit_count++;
+	}
+
+	if (events & (MATCH_EVENT_PLAYER_1_SCORED | MATCH_EVENT_PLAYER_2_SCORED)) {
+		stats.rally_count++;
+		stats.rally_length_counts[std::min(lane.rally_length, ARENA_MAX_RALLY_LENGTH)]++;
+		lane.rally_length = 0;
+	}
+
+	if (!batch.has_ended[index] && batch.tick[index] < ARENA_MAX_MATCH_TICKS)
+		return false;
+
+	stats.match_count++;
+	stats.tick_count += batch.tick[index];
+
+	if (!batch.has_ended[index])
+		stats.unfinished_count++;
+	else if (batch.player_1_score[index] > batch.player_2_score[index])
+		stats.player_1_win_count++;
+	else
+		stats.player_2_win_count++;
+
+	return true;
+}
+
+static bool parse_arena_difficulty(const char* name, AiDifficulty& difficulty) {
+	if (!parse_ai_difficulty(name, difficulty) || difficulty == AiDifficulty::EXPERT) {
+		std::cerr << "Unknown AI difficulty \"" << name << "\", expected easy, normal or hard." << "\n";
+		return false;
+	}
+
+	return true;
+}
+
+/*
+"dingdong --arena [player 1 ai] [player 2 ai] [matches] [threads] [seed] [end score]" plays that many matches between two AIs headlessly and reports how they went.
+Match i is played with seed + i, and every count is summed up in the same way whichever thread played it, so the same arguments always give the same report, however many threads there are. Only the throughput changes.
+Each thread starts out with an even share of the matches, and plays ARENA_BATCH_SIZE of them at a time in a MatchBatch. How long a match takes depends a lot on the AIs and the seed, so a thread that runs out steals the back half of whatever another thread has left instead of waiting on it.
+The expert AI isn't allowed in here, what it does depends on how far its search got in time.
+*/
+int run_arena(int argc, char* argv[]) {
+	AiDifficulty player_1_difficulty = AiDifficulty::HARD;
+	AiDifficulty player_2_difficulty = DEFAULT_AI_DIFFICULTY;
+	if (argc > 2 && !parse_arena_difficulty(argv[2], player_1_difficulty))
+		return 1;
+	if (argc > 3 && !parse_arena_difficulty(argv[3], player_2_difficulty))
+		return 1;
+
+	uint32_t match_count = (argc > 4) ? static_cast<uint32_t>(std::strtoul(argv[4], nullptr, 10)) : ARENA_DEFAULT_MATCHES;
+	int thread_count = (argc > 5) ? std::atoi(argv[5]) : static_cast<int>(std::thread::hardware_concurrency());
+	uint32_t seed = (argc > 6) ? static_cast<uint32_t>(std::strtoul(argv[6], nullptr, 10)) : ARENA_DEFAULT_SEED;
+	int end_score = (argc > 7) ? std::atoi(argv[7]) : ARENA_DEFAULT_END_SCORE;
+
+	thread_count = std::clamp(thread_count, 1, static_cast<int>(std::max(match_count, 1u)));
+	end_score = std::max(end_score, 1);
+
+	const char* player_1_name = get_ai_difficulty_name(player_1_difficulty);
+	const char* player_2_name = get_ai_difficulty_name(player_2_difficulty);
+	std::cout << "Playing " << match_count << " matches to " << end_score << " of " << player_1_name << " against " << player_2_name << " on " << thread_count << " threads (" << get_simd_level_name(get_supported_simd_level()) << "), seeds " << seed << " and up." << "\n";
+
+	AiSettings player_1_settings = get_ai_settings(player_1_difficulty);
+	AiSettings player_2_settings = get_ai_settings(player_2_difficulty);
+
+	std::vector<ArenaWorkRange> ranges(thread_count);
+	for (int i = 0; i < thread_count; i++)
+		ranges[i].set(static_cast<uint32_t>(static_cast<uint64_t>(match_count) * i / thread_count), static_cast<uint32_t>(static_cast<uint64_t>(match_count) * (i + 1) / thread_count));
+
+	std::vector<ArenaStats> worker_stats(thread_count);
+	std::atomic<uint32_t> steal_count{ 0 };
+
+	auto start_time = std::chrono::steady_clock::now();
+
+	std::vector<std::thread> workers;
+	for (int i = 0; i < thread_count; i++) {
+		workers.emplace_back([&, i]() {
+			ArenaStats& stats = worker_stats[i];
+
+			// Out of matches, try everyone else in turn starting with the next thread. Once nobody has anything left, the matches still being played are the last ones.
+			auto take_match = [&](uint32_t& index) {
+				while (!ranges[i].take_front(index)) {
+					bool has_stolen = false;
+					for (int j = 1; j < thread_count && !has_stolen; j++) {
+						uint32_t begin = 0;
+						uint32_t end = 0;
+						if (ranges[(i + j) % thread_count].steal_back_half(begin, end)) {
+							ranges[i].set(begin, end);
+							steal_count++;
+							has_stolen = true;
+						}
+					}
+
+					if (!has_stolen)
+						return false;
+				}
+
+				return true;
+			};
+
+			MatchBatch batch;
+			batch.init(ARENA_BATCH_SIZE, end_score, seed); // Every lane gets a match of its own right below.
+			std::vector<ArenaLane> lanes(ARENA_BATCH_SIZE);
+
+			int playing_count = 0;
+			for (int lane = 0; lane < ARENA_BATCH_SIZE; lane++) {
+				uint32_t index = 0;
+				if (take_match(index)) {
+					start_arena_match(batch, lane, lanes[lane], player_1_settings, player_2_settings, end_score, seed + index);
+					playing_count++;
+				}
+				else
+					park_arena_lane(batch, lane, lanes[lane]);
+			}
+
+			while (playing_count > 0) {
+				// The AIs only ever look at the match they play, the batch steps all of them at once.
+				for (int lane = 0; lane < ARENA_BATCH_SIZE; lane++) {
+					if (!lanes[lane].is_playing)
+						continue;
+
+					MatchState match = batch.get_match(lane);
+					MatchInputs inputs;
+					inputs.player_1 = lanes[lane].player_1_ai.get_input(match);
+					inputs.player_2 = lanes[lane].player_2_ai.get_input(match);
+					batch.set_inputs(lane, inputs);
+				}
+
+				batch.step();
+
+				for (int lane = 0; lane < ARENA_BATCH_SIZE; lane++) {
+					if (!lanes[lane].is_playing || !note_arena_step(batch, lane, lanes[lane], stats))
+						continue;
+
+					uint32_t index = 0;
+					if (take_match(index))
+						start_arena_match(batch, lane, lanes[lane], player_1_settings, player_2_settings, end_score, seed + index);
+					else {
+						park_arena_lane(batch, lane, lanes[lane]);
+						playing_count--;
+					}
+				}
+			}
+		});
+	}
+
+	for (std::thread& worker : workers)
+		worker.join();
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+	ArenaStats total;
+	for (const ArenaStats& stats : worker_stats)
+		total.merge(stats);
+
+	double matches = static_cast<double>(std::max<uint64_t>(total.match_count, 1));
+	std::cout << player_1_name << " (player 1) won " << 100.0 * total.player_1_win_count / matches << "%, " << player_2_name << " (player 2) won " << 100.0 * total.player_2_win_count / matches << "%";
+	std::cout << ", " << 100.0 * total.unfinished_count / matches << "% were still going after " << ARENA_MAX_MATCH_TICKS << " ticks." << "\n";
+
+	std::cout << "Rallies: " << total.rally_count << ", " << static_cast<double>(total.hit_count) / std::max<uint64_t>(total.rally_count, 1) << " hits on average, median " << total.get_rally_length_percentile(50.0);
+	std::cout << ", 90th percentile " << total.get_rally_length_percentile(90.0) << ", 99th percentile " << total.get_rally_length_percentile(99.0) << "." << "\n";
+
+	// Doubling buckets, 0 hits, 1, 2-3, 4-7 and so on.
+	for (int low = 0; low <= ARENA_MAX_RALLY_LENGTH; low = std::max(low * 2, 1)) {
+		int high = std::min(std::max(low * 2 - 1, 0), ARENA_MAX_RALLY_LENGTH);
+		uint64_t count = 0;
+		for (int i = low; i <= high; i++)
+			count += total.rally_length_counts[i];
+
+		if (count == 0)
+			continue;
+
+		std::cout << "  " << low;
+		if (high == ARENA_MAX_RALLY_LENGTH)
+			std::cout << "+";
+		else if (high > low)
+			std::cout << "-" << high;
+		std::cout << " hits: " << count << " (" << 100.0 * count / std::max<uint64_t>(total.rally_count, 1) << "%)" << "\n";
+	}
+
+	std::cout << "Took " << seconds << " s, " << total.match_count / std::max(seconds, 0.001) << " matches/sec and " << total.tick_count / std::max(seconds, 0.001) << " ticks/sec, " << steal_count << " steals." << "\n";
+
+	return 0;
+}
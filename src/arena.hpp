@@ -0,0 +1,68 @@
+#pragma once
+
+#include <iostream>
+#include <cstdint>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include "match_simulation.hpp"
+#include "match_batch.hpp"
+#include "paddle_ai.hpp"
+
+// What "dingdong --arena" runs with unless told otherwise.
+#define ARENA_DEFAULT_MATCHES 10000
+#define ARENA_DEFAULT_SEED 1
+#define ARENA_DEFAULT_END_SCORE 10
+
+// A match that's still going after this many ticks (about 28 minutes of play) is stopped and counted as unfinished.
+#define ARENA_MAX_MATCH_TICKS 100000
+
+// How many matches each thread plays side by side in a MatchBatch. A match that's over makes room for the next one right away.
+#define ARENA_BATCH_SIZE 64
+
+// Rallies are counted by their exact length up to this many paddle hits, anything longer goes in the last bucket.
+#define ARENA_MAX_RALLY_LENGTH 1024
+
+// Everything the arena measures, summed up over however many matches. Only ever counts, so merging the workers' stats gives the same result whichever worker played which match.
+struct ArenaStats {
+	uint64_t match_count = 0;
+	uint64_t player_1_win_count = 0;
+	uint64_t player_2_win_count = 0;
+	uint64_t unfinished_count = 0;
+	uint64_t tick_count = 0;
+
+	uint64_t rally_count = 0;
+	uint64_t hit_count = 0;
+	uint64_t rally_length_counts[ARENA_MAX_RALLY_LENGTH + 1] = { 0 };
+
+	void merge(const ArenaStats& other);
+	int get_rally_length_percentile(double percentile) const;
+};
+
+// The matches one worker still has to play, a run of match indices packed into a single atomic so that its owner and anyone stealing from it never need a lock.
+// The owner takes one match at a time from the front, a thief takes the back half.
+class ArenaWorkRange {
+	private:
+		std::atomic<uint64_t> range{ 0 }; // Begin in the low 32 bits, end in the high 32.
+	public:
+		void set(uint32_t begin, uint32_t end);
+		bool take_front(uint32_t& index);
+		bool steal_back_half(uint32_t& begin, uint32_t& end);
+};
+
+// One of the matches a thread is playing in its MatchBatch, and the AIs playing it.
+struct ArenaLane {
+	PaddleAi player_1_ai;
+	PaddleAi player_2_ai;
+	int rally_length = 0;
+	bool is_playing = false;
+};
+
+void start_arena_match(MatchBatch& batch, int index, ArenaLane& lane, const AiSettings& player_1_settings, const AiSettings& player_2_settings, int end_score, uint32_t seed);
+void park_arena_lane(MatchBatch& batch, int index, ArenaLane& lane);
+bool note_arena_step(const MatchBatch& batch, int index, ArenaLane& lane, ArenaStats& stats);
+int run_arena(int argc, char* argv[]);
@@ -0,0 +1,20 @@
+#include <vector>
+#include "arena.hpp"
+
+/*
+The entry point of dingdong-arena, the arena on its own: "dingdong-arena [player 1 ai] [player 2 ai] [matches] [threads] [seed] [end score]" does the same as "dingdong --arena" with the same arguments.
+It's only the rules, the AIs and the batch simulator, so it builds anywhere with a C++17 compiler, without SDL, Winsock or the rest of the server. Only link one of this, main.cpp and headless_main.cpp into a build.
+*/
+int main(int argc, char* argv[]) {
+	if (argc > 1 && argv[1][0] == '-') {
+		std::cout << "Usage: dingdong-arena [player 1 ai] [player 2 ai] [matches] [threads] [seed] [end score]" << "\n";
+		return 1;
+	}
+
+	// run_arena reads its arguments from after the mode, like every other headless mode.
+	char mode[] = "--arena";
+	std::vector<char*> arena_argv = { argv[0], mode };
+	arena_argv.insert(arena_argv.end(), argv + 1, argv + argc);
+
+	return run_arena(static_cast<int>(arena_argv.size()), arena_argv.data());
+}
@@ -4,14 +4,11 @@
 #include <string>
 #include "sprite.hpp"
 
+// Only what the ball looks like. Where it is and how it moves is up to MatchState.
 class Ball {
 	public:
 		Sprite sprite;
 
-		int velocity_x = 5;
-		int velocity_y = 5;
-
 		Ball() {};
 		Ball(std::string image_path, SDL_Renderer* renderer);
-		void move();
 };
\ No newline at end of file
@@ -0,0 +1,81 @@
+#include "ball_trajectory.hpp"
+
+void BallTrajectory::set_bounds(int screen_height_param, int ball_height_param) {
+	screen_height = screen_height_param;
+	ball_height = ball_height_param;
+}
+
+// Events can arrive twice (once on their own and once inside a snapshot) or out of order, so keep them sorted and skip the ones we already have.
+void BallTrajectory::push(const BallEventMessage& event) {
+	// The server went back and changed what happened to the ball from this tick on, so anything we heard about after it never happened.
+	if (event.type == BallEventType::REWIND) {
+		while (event_count > 0 && events[event_count - 1].tick >= event.tick)
+			event_count--;
+	}
+
+	int insert_at = event_count;
+	while (insert_at > 0 && events[insert_at - 1].tick > event.tick)
+		insert_at--;
+
+	if (insert_at > 0 && events[insert_at - 1].tick == event.tick)
+		return;
+
+	if (event_count == BALL_EVENT_HISTORY_SIZE) { // Full, forget the oldest one.
+		if (insert_at == 0)
+			return;
+
+		std::move(events + 1, events + event_count, events);
+		event_count--;
+		insert_at--;
+	}
+
+	std::move_backward(events + insert_at, events + event_count, events + event_count + 1);
+	events[insert_at] = event;
+	event_count++;
+}
+
+// Returns the event that was in effect at the given tick, or nullptr if the tick is before every event we know of.
+const BallEventMessage* BallTrajectory::find_event(double tick) {
+	for (int i = event_count - 1; i >= 0; i--) {
+		if (events[i].tick <= tick)
+			return &events[i];
+	}
+
+	return nullptr;
+}
+
+// Follows the ball from the event to the given tick with the same rules as step() in match_simulation.cpp: move by the velocity, and whenever the ball gets to the top or bottom of the screen on the way, mirror the rest of the move back from it.
+void BallTrajectory::evaluate(const BallEventMessage& event, double tick, double& x, double& y) {
+	double elapsed = std::max(tick - event.tick, 0.0);
+	int steps = static_cast<int>(std::min(std::floor(elapsed), static_cast<double>(MAX_TRAJECTORY_STEPS)));
+
+	int ball_x = event.x;
+	int ball_y = event.y;
+	int velocity_y = event.velocity_y;
+
+	for (int i = 0; i < steps; i++) {
+		ball_x += event.velocity_x;
+		ball_y += velocity_y;
+
+		for (int bounce = 0; bounce < MAX_TRAJECTORY_BOUNCES_PER_TICK; bounce++) {
+			if (velocity_y < 0 && ball_y <= 0)
+				ball_y = -ball_y;
+			else if (velocity_y > 0 && ball_y + ball_height >= screen_height)
+				ball_y = 2 * (screen_height - ball_height) - ball_y;
+			else
+				break;
+
+			velocity_y *= -1;
+		}
+	}
+
+	// Move the rest of the way in between two ticks in a straight line.
+	double fraction = (steps == MAX_TRAJECTORY_STEPS) ? 0.0 : elapsed - steps;
+
+	x = ball_x + event.velocity_x * fraction;
+	y = ball_y + velocity_y * fraction;
+}
+
+void BallTrajectory::clear() {
+	event_count = 0;
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cmath>
+#include <algorithm>
+#include "protocol.hpp"
+
+#define BALL_EVENT_HISTORY_SIZE 16
+
+// Don't follow a trajectory for longer than this many ticks after its event. If we haven't heard anything for 10 seconds, something else is wrong.
+#define MAX_TRAJECTORY_STEPS 600
+
+// Same as MATCH_MAX_BOUNCES_PER_STEP in match_simulation.cpp.
+#define MAX_TRAJECTORY_BOUNCES_PER_TICK 16
+
+// The client's copy of the ball's path, rebuilt from the trajectory events the server sends instead of from streamed positions.
+class BallTrajectory {
+	private:
+		BallEventMessage events[BALL_EVENT_HISTORY_SIZE]; // Sorted by tick, oldest first.
+		int event_count = 0;
+
+		// In fixed-point, same as the events.
+		int screen_height = 0;
+		int ball_height = 0;
+	public:
+		void set_bounds(int screen_height_param, int ball_height_param);
+		void push(const BallEventMessage& event);
+		const BallEventMessage* find_event(double tick);
+		void evaluate(const BallEventMessage& event, double tick, double& x, double& y);
+		void clear();
+};
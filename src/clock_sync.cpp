@@ -0,0 +1,108 @@
+#include "clock_sync.hpp"
+
+bool ClockSync::should_send_request(double now) const {
+	if (!has_sent_request)
+		return true;
+
+	double interval = (total_sample_count < CLOCK_SYNC_BURST_SAMPLES) ? CLOCK_SYNC_BURST_INTERVAL_MS : CLOCK_SYNC_INTERVAL_MS;
+	return now - last_request_time >= interval;
+}
+
+void ClockSync::make_request(double now, TimeRequestMessage& message) {
+	PendingRequest& request = pending_requests[next_request_sequence % CLOCK_SYNC_PENDING_REQUESTS]; // Overwrites one that's so old it's not coming back anyway.
+	request.sequence = next_request_sequence++;
+	request.send_time = now;
+	request.is_pending = true;
+
+	last_request_time = now;
+	has_sent_request = true;
+
+	message.sequence = request.sequence;
+}
+
+void ClockSync::on_response(const TimeResponseMessage& message, double arrival_time) {
+	PendingRequest& request = pending_requests[message.sequence % CLOCK_SYNC_PENDING_REQUESTS];
+	if (!request.is_pending || request.sequence != message.sequence) // Duplicate, or the answer to a request we gave up on.
+		return;
+
+	request.is_pending = false;
+
+	double server_hold_time = (message.send_clock - message.receive_clock) * SIMULATION_STEP_MS;
+
+	ClockSample sample;
+	sample.local_time = (request.send_time + arrival_time) / 2.0;
+	sample.round_trip = std::max(arrival_time - request.send_time - server_hold_time, 0.0);
+	sample.offset = (message.receive_clock + message.send_clock) / 2.0 - sample.local_time / SIMULATION_STEP_MS;
+
+	newest_sample_index = (newest_sample_index + 1) % CLOCK_SYNC_SAMPLE_COUNT;
+	sample_count = std::min(sample_count + 1, CLOCK_SYNC_SAMPLE_COUNT);
+	total_sample_count++;
+	samples[newest_sample_index] = sample;
+
+	fit();
+}
+
+// Least squares line through the samples that have a round trip close to the fastest one. Flat until they span long enough for the slope to mean anything.
+void ClockSync::fit() {
+	min_round_trip = samples[newest_sample_index].round_trip;
+	for (int i = 0; i < sample_count; i++)
+		min_round_trip = std::min(min_round_trip, samples[i].round_trip);
+
+	double trusted_round_trip = min_round_trip + std::max(CLOCK_SYNC_DELAY_MARGIN_MS, min_round_trip * CLOCK_SYNC_DELAY_MARGIN_SHARE);
+
+	double mean_time = 0.0;
+	double mean_offset = 0.0;
+	double first_time = 0.0;
+	double last_time = 0.0;
+	int used_count = 0;
+
+	for (int i = 0; i < sample_count; i++) {
+		const ClockSample& sample = samples[i];
+		if (sample.round_trip > trusted_round_trip)
+			continue;
+
+		first_time = (used_count == 0) ? sample.local_time : std::min(first_time, sample.local_time);
+		last_time = (used_count == 0) ? sample.local_time : std::max(last_time, sample.local_time);
+		mean_time += sample.local_time;
+		mean_offset += sample.offset;
+		used_count++;
+	}
+
+	mean_time /= used_count;
+	mean_offset /= used_count;
+
+	double slope = 0.0;
+	if (last_time - first_time >= CLOCK_SYNC_MIN_DRIFT_SPAN_MS) {
+		double covariance = 0.0;
+		double variance = 0.0;
+
+		for (int i = 0; i < sample_count; i++) {
+			const ClockSample& sample = samples[i];
+			if (sample.round_trip > trusted_round_trip)
+				continue;
+
+			covariance += (sample.local_time - mean_time) * (sample.offset - mean_offset);
+			variance += (sample.local_time - mean_time) * (sample.local_time - mean_time);
+		}
+
+		double max_slope = CLOCK_SYNC_MAX_DRIFT_PPM / 1000000.0 / SIMULATION_STEP_MS;
+		slope = std::clamp(covariance / variance, -max_slope, max_slope);
+	}
+
+	fit_time = mean_time;
+	offset = mean_offset;
+	drift = slope;
+}
+
+double ClockSync::get_server_clock(double local_time) const {
+	return local_time / SIMULATION_STEP_MS + offset + drift * (local_time - fit_time);
+}
+
+// When the server's clock reads server_clock, on our clock. The inverse of get_server_clock.
+double ClockSync::get_local_time(double server_clock) const {
+	return (server_clock - offset + drift * fit_time) / (1.0 / SIMULATION_STEP_MS + drift);
+}
+
+void ClockSync::reset() {
+	*this = ClockSync();
+}
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include "protocol.hpp"
+#include "match_simulation.hpp"
+
+// Right after connecting, a request goes out every CLOCK_SYNC_BURST_INTERVAL_MS until CLOCK_SYNC_BURST_SAMPLES of them have been answered, which gets done during the countdown.
+// After that, one every CLOCK_SYNC_INTERVAL_MS keeps the estimate fresh and lets the drift show.
+#define CLOCK_SYNC_BURST_SAMPLES 4
+#define CLOCK_SYNC_BURST_INTERVAL_MS 100.0
+#define CLOCK_SYNC_INTERVAL_MS 2000.0
+
+// The latest samples that are kept for the estimate, about two minutes' worth once the burst is over.
+#define CLOCK_SYNC_SAMPLE_COUNT 64
+#define CLOCK_SYNC_PENDING_REQUESTS 8
+
+// Only samples whose round trip is within this much (or this share of it, on a slow link) of the fastest one are trusted, the rest spent time queued up somewhere, and probably more of it one way than the other.
+#define CLOCK_SYNC_DELAY_MARGIN_MS 10.0
+#define CLOCK_SYNC_DELAY_MARGIN_SHARE 0.25
+
+// The drift is only estimated once the trusted samples span this long, and is never believed to be more than CLOCK_SYNC_MAX_DRIFT_PPM. Real clocks are off by tens of ppm at most.
+#define CLOCK_SYNC_MIN_DRIFT_SPAN_MS 30000.0
+#define CLOCK_SYNC_MAX_DRIFT_PPM 500.0
+
+struct ClockSample {
+	double local_time = 0.0; // Halfway between sending the request and getting the response.
+	double offset = 0.0; // The server's clock minus ours, in ticks, at local_time.
+	double round_trip = 0.0; // Not counting the time the server held on to the request.
+};
+
+/*
+Works out the server's clock from ours, NTP style. Every request gives a sample of the offset between the two (assuming the way there took as long as the way back) and of the round trip.
+The estimate is a line fitted through the offsets of the samples with the fastest round trips, so its slope is how fast the server's clock drifts from ours.
+The client uses it to place everything the server sends on its own timeline by the server tick it's stamped with, instead of by when it happened to arrive.
+Our clock is get_network_time, in milliseconds. The server's clock is in ticks, see TimeResponseMessage.
+*/
+class ClockSync {
+	private:
+		struct PendingRequest {
+			uint16_t sequence = 0;
+			double send_time = 0.0;
+			bool is_pending = false;
+		};
+
+		PendingRequest pending_requests[CLOCK_SYNC_PENDING_REQUESTS];
+		uint16_t next_request_sequence = 0;
+		double last_request_time = 0.0;
+		bool has_sent_request = false;
+
+		ClockSample samples[CLOCK_SYNC_SAMPLE_COUNT];
+		int newest_sample_index = -1;
+		int sample_count = 0;
+		uint32_t total_sample_count = 0;
+
+		// server clock = local_time / SIMULATION_STEP_MS + offset + drift * (local_time - fit_time)
+		double fit_time = 0.0;
+		double offset = 0.0;
+		double drift = 0.0; // Ticks per millisecond on top of ours.
+
+		void fit();
+	public:
+		double min_round_trip = 0.0;
+
+		bool should_send_request(double now) const;
+		void make_request(double now, TimeRequestMessage& message);
+		void on_response(const TimeResponseMessage& message, double arrival_time);
+
+		bool is_synced() const { return sample_count > 0; }
+		double get_server_clock(double local_time) const;
+		double get_local_time(double server_clock) const;
+		double get_drift_ppm() const { return drift * SIMULATION_STEP_MS * 1000000.0; }
+
+		void reset();
+};
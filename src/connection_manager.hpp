@@ -5,36 +5,39 @@
 #include <iphlpapi.h>
 #include <iostream>
 #include <string>
+#include <memory>
+#include "protocol.hpp"
+#include "network_thread.hpp"
 
 #pragma comment (lib, "Ws2_32.lib")
 
-#define DEFAULT_PORT 27015
-#define DEFAULT_BUFFER_LENGTH 64
+#define DEFAULT_BUFFER_LENGTH MAX_PACKET_LENGTH
 
 class ConnectionManager {
 	private:
-		fd_set fdset;
-		struct timeval client_wait_timeout;
-		struct timeval server_wait_timeout;
-
 		SOCKET sock = INVALID_SOCKET;
 
-		// This is where we'll be setting up connection parameters or where we'll be storing the parameters for a connection that's made.
+		// This is where we'll be setting up connection parameters, the network thread keeps its own copy once it's running.
 		SOCKADDR_IN connection_data;
 		int connection_data_len = sizeof(connection_data);
 
-		char receive_buffer[DEFAULT_BUFFER_LENGTH] = { 0 }; // The object where the recieved data will be placed on.
+		std::unique_ptr<NetworkThread> network_thread; // Everything that touches the socket after init happens on here.
+
+		DropCounter outgoing_drops{ "Outgoing queue is full, dropping datagrams." };
 	public:
 		std::wstring server_ipv4;
 
 		bool is_connected = false;
 		std::string type = "uwu";
 
+		HandshakeState handshake_state = HandshakeState::IDLE;
+		int handshake_error = 0; // Set when the handshake fails, same codes as init returns.
+		MatchSetup match_setup; // The server fills this in (except for the seed) before init, the client gets it from the server during the handshake.
+
 		ConnectionManager();
 		int init(std::string connection_type);
 		void reset();
-		bool establish_first_connection();
-		bool await_first_connection();
-		std::string receive_data();
-		std::string send_data(std::string data);
+		HandshakeState poll_handshake();
+		int receive_data(uint8_t* buffer, int capacity, double* arrival_time = nullptr);
+		bool send_data(const uint8_t* data, int length);
 };
\ No newline at end of file
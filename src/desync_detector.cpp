@@ -0,0 +1,36 @@
+#include "desync_detector.hpp"
+
+bool DesyncDetector::compare(uint32_t tick) {
+	const TickHash& local_hash = local_hashes[tick % STATE_HASH_HISTORY_SIZE];
+	const TickHash& remote_hash = remote_hashes[tick % STATE_HASH_HISTORY_SIZE];
+
+	if (!local_hash.is_valid || !remote_hash.is_valid || local_hash.tick != remote_hash.tick || local_hash.hash == remote_hash.hash)
+		return false;
+
+	// Only the first one matters, everything after it is going to be off too.
+	if (has_desynced)
+		return false;
+
+	has_desynced = true;
+	desync_tick = tick;
+	std::cerr << "Desync on tick " << tick << ": our state hashes to " << std::hex << local_hash.hash << ", theirs to " << remote_hash.hash << std::dec << "\n";
+	return true;
+}
+
+bool DesyncDetector::store_local(uint32_t tick, uint32_t hash) {
+	local_hashes[tick % STATE_HASH_HISTORY_SIZE] = { tick, hash, true };
+	return compare(tick);
+}
+
+bool DesyncDetector::store_remote(uint32_t tick, uint32_t hash) {
+	remote_hashes[tick % STATE_HASH_HISTORY_SIZE] = { tick, hash, true };
+	return compare(tick);
+}
+
+void DesyncDetector::clear() {
+	for (int i = 0; i < STATE_HASH_HISTORY_SIZE; i++)
+		local_hashes[i] = remote_hashes[i] = TickHash();
+
+	has_desynced = false;
+	desync_tick = 0;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <iostream>
+#include <cstdint>
+
+// How many ticks worth of hashes each side keeps around, waiting for the other side's hash of the same tick to show up. About two seconds at 60 ticks per second.
+#define STATE_HASH_HISTORY_SIZE 128
+
+struct TickHash {
+	uint32_t tick = 0;
+	uint32_t hash = 0;
+	bool is_valid = false;
+};
+
+/*
+Compares our hash_match_state of every tick against the other side's hash of the same tick, whichever of the two comes in first.
+Two sides that have stepped the same match with the same inputs can only disagree if something isn't deterministic, so the first mismatch is the tick things went wrong on.
+A hash that's older than STATE_HASH_HISTORY_SIZE ticks by the time its pair shows up just doesn't get compared.
+*/
+class DesyncDetector {
+	private:
+		TickHash local_hashes[STATE_HASH_HISTORY_SIZE];
+		TickHash remote_hashes[STATE_HASH_HISTORY_SIZE];
+
+		bool compare(uint32_t tick);
+	public:
+		bool has_desynced = false;
+		uint32_t desync_tick = 0; // The first tick the hashes didn't match on.
+
+		// Both return true if this hash is the one that revealed the desync.
+		bool store_local(uint32_t tick, uint32_t hash);
+		bool store_remote(uint32_t tick, uint32_t hash);
+		void clear();
+};
@@ -0,0 +1,102 @@
+#include "epoll_transport.hpp"
+
+#ifdef HAS_EPOLL
+EpollTransport::~EpollTransport() {
+	if (epoll_fd != -1)
+		close(epoll_fd);
+}
+
+bool EpollTransport::open(SOCKET sock_param) {
+	sock = sock_param;
+
+	epoll_fd = epoll_create1(0);
+	if (epoll_fd == -1) {
+		last_error = errno;
+		return false;
+	}
+
+	epoll_event event;
+	memset(&event, 0, sizeof(event));
+	event.events = EPOLLIN;
+	event.data.fd = sock;
+
+	if (epoll_ctl(epoll_fd, EPOLL_CTL_ADD, sock, &event) == -1) {
+		last_error = errno;
+		return false;
+	}
+
+	memset(headers, 0, sizeof(headers));
+	return true;
+}
+
+// The headers point straight into the caller's datagrams, so nothing gets copied on the way in or out.
+void EpollTransport::point_headers_at(const Datagram* datagrams, int count, bool is_receiving) {
+	for (int i = 0; i < count; i++) {
+		Datagram& datagram = const_cast<Datagram&>(datagrams[i]); // sendmmsg doesn't write to them, it just doesn't take const pointers.
+
+		vectors[i].iov_base = datagram.data;
+		vectors[i].iov_len = is_receiving ? MAX_DATAGRAM_LENGTH : datagram.length;
+
+		headers[i].msg_hdr.msg_iov = &vectors[i];
+		headers[i].msg_hdr.msg_iovlen = 1;
+		headers[i].msg_hdr.msg_name = &datagram.address;
+		headers[i].msg_hdr.msg_namelen = sizeof(datagram.address);
+	}
+}
+
+int EpollTransport::receive(Datagram* datagrams, int capacity, int timeout_us) {
+	if (pending_error != 0) {
+		last_error = pending_error;
+		pending_error = 0;
+		return SOCKET_ERROR;
+	}
+
+	if (timeout_us > 0) {
+		epoll_event event;
+		syscall_count++;
+		if (epoll_wait(epoll_fd, &event, 1, (timeout_us + 999) / 1000) <= 0)
+			return 0;
+	}
+
+	capacity = std::min(capacity, TRANSPORT_BATCH_SIZE);
+	point_headers_at(datagrams, capacity, true);
+
+	syscall_count++;
+	int count = recvmmsg(sock, headers, capacity, MSG_DONTWAIT, nullptr);
+	if (count == SOCKET_ERROR) {
+		if (errno == EWOULDBLOCK)
+			return 0;
+
+		last_error = errno;
+		return SOCKET_ERROR;
+	}
+
+	for (int i = 0; i < count; i++)
+		datagrams[i].length = static_cast<int>(headers[i].msg_len);
+
+	return count;
+}
+
+bool EpollTransport::send(const Datagram* datagrams, int count) {
+	bool has_sent_all = true;
+
+	int sent = 0;
+	while (sent < count) {
+		int batch_size = std::min(count - sent, TRANSPORT_BATCH_SIZE);
+		point_headers_at(datagrams + sent, batch_size, false);
+
+		syscall_count++;
+		int result = sendmmsg(sock, headers, batch_size, 0);
+
+		if (result == SOCKET_ERROR) { // Only the first datagram of what's left failed, skip it and try the rest.
+			last_error = errno;
+			has_sent_all = false;
+			result = 1;
+		}
+
+		sent += result;
+	}
+
+	return has_sent_all;
+}
+#endif
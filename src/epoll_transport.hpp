@@ -0,0 +1,22 @@
+#pragma once
+
+#include "transport.hpp"
+
+#ifdef HAS_EPOLL
+// epoll to wait, then recvmmsg/sendmmsg to move a whole batch of datagrams per call.
+class EpollTransport : public Transport {
+	private:
+		SOCKET sock = INVALID_SOCKET;
+		int epoll_fd = -1;
+
+		mmsghdr headers[TRANSPORT_BATCH_SIZE];
+		iovec vectors[TRANSPORT_BATCH_SIZE];
+
+		void point_headers_at(const Datagram* datagrams, int count, bool is_receiving);
+	public:
+		~EpollTransport();
+		bool open(SOCKET sock_param) override;
+		int receive(Datagram* datagrams, int capacity, int timeout_us) override;
+		bool send(const Datagram* datagrams, int count) override;
+};
+#endif
@@ -8,8 +8,8 @@ Game::Game(int screen_width_param, int screen_height_param, GameMode game_mode_p
 	screen_width = screen_width_param;
 	screen_height = screen_height_param;
 
-	player_1 = { screen_height, "sprites/paddle_1.png", renderer };
-	player_2 = { screen_height, "sprites/paddle_2.png", renderer };
+	player_1 = { "sprites/paddle_1.png", renderer };
+	player_2 = { "sprites/paddle_2.png", renderer };
 	ball = { "sprites/ball.png", renderer };
 
 	game_background = { "sprites/game_background.png", renderer };
@@ -17,11 +17,11 @@ Game::Game(int screen_width_param, int screen_height_param, GameMode game_mode_p
 	you_lost_screen = { "sprites/you_lost_screen.png", renderer };
 	middle_line = { "sprites/middle_line.png", renderer };
 
-	player_1_score_text = { std::to_string(player_1_score), renderer, 30, {255, 255, 255} };
-	player_2_score_text = { std::to_string(player_2_score), renderer, 30, {255, 255, 255} };
+	player_1_score_text = { std::to_string(match.player_1_score), renderer, 30, {255, 255, 255} };
+	player_2_score_text = { std::to_string(match.player_2_score), renderer, 30, {255, 255, 255} };
 
-	server_awaiting_connection_text = { "Awaiting connection, the game may become unresponsive during this time...", renderer_ptr.get(), 14, {255, 0, 0} };
-	client_connecting_text = { "Attempting to connect, the game may become unresponsive during this time...", renderer_ptr.get(), 14, {255, 0, 0} };
+	server_awaiting_connection_text = { "Awaiting connection, press ESC to cancel...", renderer_ptr.get(), 14, {255, 0, 0} };
+	client_connecting_text = { "Attempting to connect, press ESC to cancel...", renderer_ptr.get(), 14, {255, 0, 0} };
 
 	// Center the middle line on the middle of the screen.
 	middle_line.rect.x = (screen_width / 2) - (middle_line.rect.w / 2);
@@ -50,54 +50,98 @@ Game::Game(int screen_width_param, int screen_height_param, GameMode game_mode_p
 
 void Game::init_game(GameMode init_mode, int screen_width, int screen_height, bool is_sound_on, int end_score_param) {
 	sound_on = is_sound_on;
-	end_score = end_score_param;
 
 	game_mode = init_mode;
 
 	// Reset game in case we have left over stuff from a possible previous game.
 	reset_game();
 
-	// Center paddles on opposite sides of the screen.
-	player_1.sprite.rect.x = 5;
-	player_1.sprite.rect.y = (screen_height / 2) - (player_1.sprite.rect.h / 2);
+	// Centers the paddles on opposite sides of the screen and the ball in the middle, and sends the ball towards a random direction.
+	match = create_match(end_score_param, std::random_device()(), game_mode == GameMode::PRACTICE);
+	ai.init(get_ai_settings(ai_difficulty), 2, match.random_state);
 
-	player_2.sprite.rect.x = (screen_width - player_2.sprite.rect.w) - 5;
-	player_2.sprite.rect.y = (screen_height / 2) - (player_2.sprite.rect.h / 2);
-
-	// Center ball on the middle of the screen.
-	ball.sprite.rect.x = (screen_width / 2) - (ball.sprite.rect.w / 2);
-	ball.sprite.rect.y = (screen_height / 2) - (ball.sprite.rect.h / 2);
+	if (game_mode == GameMode::SINGLE_PLAYER && ai_difficulty == AiDifficulty::EXPERT)
+		lookahead_ai = std::make_unique<LookaheadAi>(2, match.random_state);
+	else
+		lookahead_ai.reset();
 
 	center_scores();
 
-	// Make the ball go towards a random direction at the start of the match.
-	std::vector<int> velocities = { -1, 1 };
-	ball.velocity_x *= velocities[generate_random_number(0, 1)];
-	ball.velocity_y *= velocities[generate_random_number(0, 1)];
+	ball_trajectory.set_bounds(to_fixed(MATCH_HEIGHT), to_fixed(MATCH_BALL_SIZE));
 
 	if (Mix_PlayingMusic())
 		Mix_HaltMusic();
 
+	// Online games only start the handshake here, poll_connection takes it from there every step.
 	if (game_mode == GameMode::ONLINE_MULTIPLAYER) {
+		if (connection_manager.type == "server") {
+			connection_manager.match_setup.end_score = match.end_score;
+			connection_manager.match_setup.is_rollback = (netcode_mode == NetcodeMode::ROLLBACK);
+		}
+
 		int connection_result = connection_manager.init(connection_manager.type);
 
-		if (connection_result != 0) {
-			switch (connection_result) {
-				case 9999: // Server timeout.
-					push_event("main_menu_err", "No one connected to the server before timeout.");
-					break;
-				case 8888: // Client timeout.
-					push_event("main_menu_err", "Could not connect to the server.");
-					break;
-				default:
-					push_event("main_menu_err", get_nethelpmsgstr(connection_result));
-			}
-		}
+		if (connection_result != 0)
+			report_connection_error(connection_result);
 	}
 
+	save_render_positions();
+
 	game_start_time = SDL_GetTicks();
 }
 
+void Game::report_connection_error(int error_code) {
+	switch (error_code) {
+		case 9999: // Server timeout.
+			push_event("main_menu_err", "No one connected to the server before timeout.");
+			break;
+		case 8888: // Client timeout.
+			push_event("main_menu_err", "Could not connect to the server.");
+			break;
+		case 7777: // Other side is on a different protocol version.
+			push_event("main_menu_err", "The other side is running an incompatible version of dingdong.");
+			break;
+		default:
+			push_event("main_menu_err", get_nethelpmsgstr(error_code));
+	}
+}
+
+// Both sides confirmed the same frame and ended up in different places, so every frame from here on is going to disagree too. There's no server to take the right state from, so the match is over.
+void Game::report_desync() {
+	connection_manager.is_connected = false;
+	push_event("main_menu_err", "The match went out of sync with the other side.");
+}
+
+// Moves the handshake along by one step. The countdown starts once it's done, and we go back to the main menu if it fails.
+void Game::poll_connection() {
+	switch (connection_manager.poll_handshake()) {
+		case HandshakeState::CONNECTED:
+		{
+			// Both sides start from the seed the server picked, and the client plays by whatever rules the server chose.
+			const MatchSetup& match_setup = connection_manager.match_setup;
+			netcode_mode = match_setup.is_rollback ? NetcodeMode::ROLLBACK : NetcodeMode::SERVER_AUTHORITATIVE;
+			match = create_match(match_setup.end_score, match_setup.seed);
+
+			if (netcode_mode == NetcodeMode::ROLLBACK)
+				rollback_session.init(match, (connection_manager.type == "server") ? 1 : 2);
+			else if (connection_manager.type == "server")
+				lag_compensator.reset(match); // Player 1 is whoever's at the keyboard, their inputs get replayed.
+
+			update_scores(renderer_ptr.get());
+			save_render_positions();
+			game_start_time = SDL_GetTicks();
+			last_step_network_time = get_network_time() + countdown_time - SIMULATION_STEP_MS; // The first step happens once the countdown is over, so the server's clock reads 0 one step before that.
+			break;
+		}
+		case HandshakeState::FAILED:
+			report_connection_error(connection_manager.handshake_error);
+			reset_game();
+			break;
+		default:
+			break;
+	}
+}
+
 void Game::play_if_sound_on(Mix_Chunk* chunk, int loops) {
 	if (sound_on)
 		Mix_PlayChannel(-1, chunk, loops);
@@ -118,43 +162,35 @@ std::string Game::get_nethelpmsgstr(int errcode) {
 	return result;
 }
 
-void Game::process_input(const Uint8* keyboard_state) {
+// Reads which way the players want their paddles to go this step. The client's own paddle is moved right away instead, see record_client_input.
+MatchInputs Game::process_input(const Uint8* keyboard_state) {
+	MatchInputs inputs;
+
 	if (game_mode == GameMode::SINGLE_PLAYER || game_mode == GameMode::PRACTICE) {
-		if (keyboard_state[SDL_SCANCODE_W] || keyboard_state[SDL_SCANCODE_UP])
-			player_1.move(MoveDirection::UP);
-		if (keyboard_state[SDL_SCANCODE_S] || keyboard_state[SDL_SCANCODE_DOWN])
-			player_1.move(MoveDirection::DOWN);
+		inputs.player_1.up = keyboard_state[SDL_SCANCODE_W] || keyboard_state[SDL_SCANCODE_UP];
+		inputs.player_1.down = keyboard_state[SDL_SCANCODE_S] || keyboard_state[SDL_SCANCODE_DOWN];
 	}
 	else if (game_mode == GameMode::LOCAL_MULTIPLAYER) {
-		if (keyboard_state[SDL_SCANCODE_W])
-			player_1.move(MoveDirection::UP);
-		if (keyboard_state[SDL_SCANCODE_S])
-			player_1.move(MoveDirection::DOWN);
-		if (keyboard_state[SDL_SCANCODE_UP])
-			player_2.move(MoveDirection::UP);
-		if (keyboard_state[SDL_SCANCODE_DOWN])
-			player_2.move(MoveDirection::DOWN);
+		inputs.player_1.up = keyboard_state[SDL_SCANCODE_W];
+		inputs.player_1.down = keyboard_state[SDL_SCANCODE_S];
+		inputs.player_2.up = keyboard_state[SDL_SCANCODE_UP];
+		inputs.player_2.down = keyboard_state[SDL_SCANCODE_DOWN];
 	}
 	else if (game_mode == GameMode::ONLINE_MULTIPLAYER) {
 		if (connection_manager.type == "client") {
-			if (keyboard_state[SDL_SCANCODE_W] || keyboard_state[SDL_SCANCODE_UP]) {
-				online_has_moved = true;
-				player_2.move(MoveDirection::UP);
-			}
-			if (keyboard_state[SDL_SCANCODE_S] || keyboard_state[SDL_SCANCODE_DOWN]) {
-				online_has_moved = true;
-				player_2.move(MoveDirection::DOWN);
+			bool up = keyboard_state[SDL_SCANCODE_W] || keyboard_state[SDL_SCANCODE_UP];
+			bool down = keyboard_state[SDL_SCANCODE_S] || keyboard_state[SDL_SCANCODE_DOWN];
+
+			if (netcode_mode == NetcodeMode::ROLLBACK) {
+				inputs.player_2.up = up;
+				inputs.player_2.down = down;
 			}
+			else if (connection_manager.is_connected)
+				record_client_input(up, down);
 		}
 		else if (connection_manager.type == "server") {
-			if (keyboard_state[SDL_SCANCODE_W] || keyboard_state[SDL_SCANCODE_UP]) {
-				online_has_moved = true;
-				player_1.move(MoveDirection::UP);
-			}
-			if (keyboard_state[SDL_SCANCODE_S] || keyboard_state[SDL_SCANCODE_DOWN]) {
-				online_has_moved = true;
-				player_1.move(MoveDirection::DOWN);
-			}
+			inputs.player_1.up = keyboard_state[SDL_SCANCODE_W] || keyboard_state[SDL_SCANCODE_UP];
+			inputs.player_1.down = keyboard_state[SDL_SCANCODE_S] || keyboard_state[SDL_SCANCODE_DOWN];
 		}
 	}
 
@@ -166,6 +202,8 @@ void Game::process_input(const Uint8* keyboard_state) {
 
 		push_event("main_menu", "start");
 	}
+
+	return inputs;
 }
 
 // Pushes an SDL_USEREVENT with two datas as string pointers.
@@ -193,8 +231,8 @@ void Game::center_scores() {
 }
 
 void Game::update_scores(SDL_Renderer* renderer) {
-	player_1_score_text.swap_text(std::to_string(player_1_score));
-	player_2_score_text.swap_text(std::to_string(player_2_score));
+	player_1_score_text.swap_text(std::to_string(match.player_1_score));
+	player_2_score_text.swap_text(std::to_string(match.player_2_score));
 }
 
 void Game::reset_game() {
@@ -204,39 +242,103 @@ void Game::reset_game() {
 	has_ended = false;
 	has_won = false;
 
-	player_1.sprite.rect.y = (screen_height / 2) - (player_1.sprite.rect.h / 2);
-	player_2.sprite.rect.y = (screen_height / 2) - (player_2.sprite.rect.h / 2);
-
-	player_1_score = player_2_score = 0;
+	match = create_match(match.end_score, std::random_device()(), game_mode == GameMode::PRACTICE);
 	update_scores(renderer_ptr.get());
 
-	ball.velocity_x = ball.velocity_y = 5;
-	ball_hit_count = 0;
+	reset_network_state();
 
 	if (game_mode == GameMode::ONLINE_MULTIPLAYER)
 		connection_manager.reset();
 }
 
-void Game::reset_paddle_positions() {
-	player_1.sprite.rect.y = (screen_height / 2) - (player_1.sprite.rect.h / 2);
-	player_2.sprite.rect.y = (screen_height / 2) - (player_2.sprite.rect.h / 2);
+void Game::reset_network_state() {
+	next_snapshot_sequence = 0;
+	sent_snapshots.clear();
+	has_snapshot_ack = false;
+	acked_snapshot_sequence = 0;
+	snapshot_rate.reset(get_network_time());
+	reliable_events.reset();
+	clock_sync.reset();
+	view_tick = 0.0;
+
+	received_snapshots.clear();
+	has_received_snapshot = false;
+	latest_snapshot_sequence = 0;
+
+	next_input_sequence = 1;
+	last_processed_input = last_acked_input = 0;
+
+	snapshot_interpolator.clear();
+
+	has_pending_ball_event = false;
+	latest_ball_event = BallEventMessage();
+	ball_correction_timer = 0;
+
+	ball_trajectory.clear();
+	last_played_ball_event_tick = 0;
+
+	desync_detector.clear();
+	hashed_frame_count = 0;
 }
 
-void Game::reset_ball_position() {
-	ball.sprite.rect.x = (screen_width / 2) - (ball.sprite.rect.w / 2);
-	ball.sprite.rect.y = (screen_height / 2) - (ball.sprite.rect.h / 2);
+// Applies the client's input right away and keeps it around until the server lets us know that it has applied it too. Called every tick, keys or not.
+void Game::record_client_input(bool up, bool down) {
+	input_history[next_input_sequence % INPUT_HISTORY_SIZE] = pack_frame_input({ up, down });
+	next_input_sequence = advance_input_sequence(next_input_sequence, 1);
+
+	move_paddle(match.player_2, { up, down });
 }
 
-int Game::generate_random_number(int range_begin, int range_end, int multiples) {
-	std::random_device randomdevice;
-	std::mt19937 gen(rand());
-	std::uniform_int_distribution<> dis(range_begin, range_end);
-	return dis(gen) * multiples;
+// One message per tick, with every input the server hasn't acknowledged yet. If there's more of those than fit, the newest ones go and the server skips the rest.
+void Game::send_client_inputs() {
+	uint16_t newest_sequence = advance_input_sequence(next_input_sequence, -1);
+	int unacked_count = input_sequence_distance(newest_sequence, last_acked_input);
+
+	if (unacked_count == 0)
+		return;
+
+	InputMessage input;
+	input.newest_sequence = newest_sequence;
+	input.view_tick = static_cast<uint32_t>(std::max<long>(std::lround(view_tick), 0));
+	input.input_count = std::min<int>(unacked_count, MAX_INPUTS_PER_MESSAGE);
+
+	for (int i = 0; i < input.input_count; i++)
+		input.inputs[i] = input_history[advance_input_sequence(newest_sequence, -(input.input_count - 1 - i)) % INPUT_HISTORY_SIZE];
+
+	connection_manager.send_data(packet_buffer, encode_input(input, packet_buffer, MAX_PACKET_LENGTH));
+}
+
+// Rewinds the client's paddle to where the server says it is, then replays every input the server hasn't seen yet on top of it.
+void Game::reconcile_player_2(int authoritative_y, uint16_t last_processed_input_param) {
+	match.player_2.y = to_fixed(authoritative_y);
+
+	// Sequences skip 0 when they wrap around, which skips a slot of input_history too, so only the last INPUT_HISTORY_SIZE - 1 inputs are always in slots of their own.
+	uint16_t first_unprocessed_input = advance_input_sequence(last_processed_input_param, 1);
+	if (input_sequence_distance(next_input_sequence, first_unprocessed_input) > INPUT_HISTORY_SIZE - 1)
+		first_unprocessed_input = advance_input_sequence(next_input_sequence, -(INPUT_HISTORY_SIZE - 1));
+
+	for (uint16_t sequence = first_unprocessed_input; sequence != next_input_sequence; sequence = advance_input_sequence(sequence, 1))
+		move_paddle(match.player_2, unpack_frame_input(input_history[sequence % INPUT_HISTORY_SIZE]));
 }
 
-void Game::start_new_round(std::string winner) {
+void Game::save_render_positions() {
+	previous_player_1_rect = match.player_1;
+	previous_player_2_rect = match.player_2;
+	previous_ball_rect = match.ball;
+}
+
+// step_progress is how far along we are to the next step, 0 being right after the latest one.
+SDL_Rect Game::get_render_rect(const MatchRect& previous_rect, const MatchRect& current_rect, double step_progress) {
+	SDL_Rect render_rect = { 0, 0, to_pixels(current_rect.w), to_pixels(current_rect.h) };
+	render_rect.x = to_pixels((int)std::lround(previous_rect.x + (current_rect.x - previous_rect.x) * step_progress));
+	render_rect.y = to_pixels((int)std::lround(previous_rect.y + (current_rect.y - previous_rect.y) * step_progress));
+	return render_rect;
+}
+
+// Everything that happens around the match when someone scores. The match itself has already reset the ball and the paddles by now.
+void Game::start_new_round() {
 	// Check if game ended.
-	if (player_1_score == end_score) {
+	if (match.player_1_score == match.end_score) {
 		has_ended = true;
 
 		if (game_mode != GameMode::ONLINE_MULTIPLAYER || (game_mode == GameMode::ONLINE_MULTIPLAYER && connection_manager.type == "server")) {
@@ -258,7 +360,7 @@ void Game::start_new_round(std::string winner) {
 
 		return;
 	}
-	else if (player_2_score == end_score) {
+	else if (match.player_2_score == match.end_score) {
 		has_ended = true;
 
 		if (game_mode == GameMode::ONLINE_MULTIPLAYER && connection_manager.type == "client") {
@@ -283,21 +385,10 @@ void Game::start_new_round(std::string winner) {
 	is_fast = false;
 
 	// easter egg!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!!! funny!!!!!!!!!!!!!!!!!
-	if (player_1_score == 3 && player_2_score == 1)
+	if (match.player_1_score == 3 && match.player_2_score == 1)
 		play_if_sound_on(uwu_sfx.get());
 
-	ball.velocity_x = ball.velocity_y = 5;
-
-	std::vector<int> velocities = { -1, 1 };
-	ball.velocity_y *= velocities[generate_random_number(0, 1)]; // Make the ball go towards above or below in a random fashion, but towards the winner.
-
-	if (winner == "player1")
-		ball.velocity_x *= -1; // Make the ball go towards the winner at the start of the round.
-
-	ball_hit_count = 0;
-
-	reset_paddle_positions();
-	reset_ball_position();
+	save_render_positions(); // Don't draw the ball sliding back to the middle.
 	update_scores(renderer_ptr.get());
 	center_scores(); // Re-center scores when we swap their texts in case they got larger.
 
@@ -307,113 +398,425 @@ void Game::start_new_round(std::string winner) {
 	}
 }
 
-void Game::increase_ball_speed() {
-	if (ball.velocity_x < 0)
-		ball.velocity_x -= 1;
-	else
-		ball.velocity_x += 1;
+void Game::process_received_data(const uint8_t* received_data, int received_length, double arrival_time) {
+	if (received_length == RECEIVE_CONNRESET) {
+		std::cerr << "Lost connection." << "\n";
+		connection_manager.is_connected = false;
+		push_event("main_menu_err", get_nethelpmsgstr(WSAECONNRESET));
+		return;
+	}
 
-	if (ball.velocity_y < 0)
-		ball.velocity_y -= 1;
-	else
-		ball.velocity_y += 1;
+	MessageType message_type;
+	if (received_length <= 0 || !peek_message_type(received_data, received_length, message_type))
+		return;
+
+	switch (message_type) {
+		case MessageType::SNAPSHOT:
+		{
+			SnapshotMessage snapshot;
+			if (!decode_snapshot(received_data, received_length, received_snapshots, snapshot)) // Either malformed or its baseline is too old for us to remember.
+				break;
+
+			if (has_received_snapshot && !sequence_more_recent(snapshot.sequence, latest_snapshot_sequence)) // Drop snapshots that arrived out of order.
+				break;
+
+			received_snapshots.store(snapshot);
+			has_received_snapshot = true;
+			latest_snapshot_sequence = snapshot.sequence;
+
+			// Let the server know it can delta against this one from now on.
+			SnapshotAckMessage snapshot_ack;
+			snapshot_ack.sequence = snapshot.sequence;
+
+			uint8_t ack_buffer[MAX_PACKET_LENGTH];
+			connection_manager.send_data(ack_buffer, encode_snapshot_ack(snapshot_ack, ack_buffer, MAX_PACKET_LENGTH));
+
+			if (snapshot.ball_tick != 0) { // The serve happens on tick 1, anything before that is just the default values.
+				BallEventMessage ball_event;
+				ball_event.type = snapshot.ball_event_type;
+				ball_event.tick = snapshot.ball_tick;
+				ball_event.x = snapshot.ball_x;
+				ball_event.y = snapshot.ball_y;
+				ball_event.velocity_x = snapshot.ball_velocity_x;
+				ball_event.velocity_y = snapshot.ball_velocity_y;
+
+				ball_trajectory.push(ball_event);
+			}
+
+			// Place the snapshot at when the server was at its tick. It can't be from the future though, which it would seem to be during the countdown when every snapshot is on tick 0.
+			double snapshot_time = clock_sync.is_synced() ? std::min(clock_sync.get_local_time(snapshot.server_tick), arrival_time) : arrival_time;
+			snapshot_interpolator.push(snapshot_time, arrival_time, snapshot);
+			reconcile_player_2(snapshot.player_2_y, snapshot.last_processed_input);
+
+			if (input_sequence_more_recent(snapshot.last_processed_input, last_acked_input))
+				last_acked_input = snapshot.last_processed_input;
+			break;
+		}
+		case MessageType::INPUT:
+		{
+			InputMessage input;
+			if (!decode_input(received_data, received_length, input))
+				break;
+
+			BallEventMessage rewind_event;
+			if (lag_compensator.apply_client_inputs(match, input, last_processed_input, rewind_event)) {
+				send_rewind_event(rewind_event);
+				update_scores(renderer_ptr.get()); // The rewind might have taken a point back.
+				center_scores();
+			}
+			break;
+		}
+		case MessageType::BALL_EVENT:
+		{
+			BallEventMessage ball_event;
+			if (decode_ball_event(received_data, received_length, ball_event))
+				ball_trajectory.push(ball_event);
+			break;
+		}
+		case MessageType::ROLLBACK_INPUT:
+		{
+			RollbackInputMessage rollback_input;
+			if (netcode_mode == NetcodeMode::ROLLBACK && decode_rollback_input(received_data, received_length, rollback_input))
+				rollback_session.add_remote_inputs(rollback_input);
+			break;
+		}
+		case MessageType::STATE_HASH:
+		{
+			StateHashMessage state_hash;
+			if (netcode_mode == NetcodeMode::ROLLBACK && decode_state_hash(received_data, received_length, state_hash) && desync_detector.store_remote(state_hash.tick, state_hash.hash))
+				report_desync();
+			break;
+		}
+		case MessageType::RELIABLE_EVENT:
+		{
+			ReliableEventMessage event_message;
+			if (!decode_reliable_event(received_data, received_length, event_message))
+				break;
+
+			EventAckMessage event_ack;
+			reliable_events.receive_events(event_message, event_ack);
+
+			uint8_t ack_buffer[MAX_PACKET_LENGTH];
+			connection_manager.send_data(ack_buffer, encode_event_ack(event_ack, ack_buffer, MAX_PACKET_LENGTH));
+
+			ReliableEvent event;
+			while (reliable_events.pop_event(event))
+				apply_reliable_event(event);
+			break;
+		}
+		case MessageType::EVENT_ACK:
+		{
+			EventAckMessage event_ack;
+			if (decode_event_ack(received_data, received_length, event_ack))
+				reliable_events.on_event_ack(event_ack);
+			break;
+		}
+		case MessageType::TIME_REQUEST:
+		{
+			TimeRequestMessage time_request;
+			if (!decode_time_request(received_data, received_length, time_request))
+				break;
+
+			TimeResponseMessage time_response;
+			time_response.sequence = time_request.sequence;
+			time_response.receive_clock = get_server_clock(arrival_time);
+			time_response.send_clock = get_server_clock(get_network_time());
+
+			uint8_t response_buffer[MAX_PACKET_LENGTH];
+			int time_response_length = encode_time_response(time_response, response_buffer, MAX_PACKET_LENGTH);
+			connection_manager.send_data(response_buffer, time_response_length);
+			snapshot_rate.note_sent_bytes(time_response_length);
+			break;
+		}
+		case MessageType::TIME_RESPONSE:
+		{
+			TimeResponseMessage time_response;
+			if (decode_time_response(received_data, received_length, time_response))
+				clock_sync.on_response(time_response, arrival_time);
+			break;
+		}
+		case MessageType::SNAPSHOT_ACK:
+		{
+			SnapshotAckMessage snapshot_ack;
+			if (!decode_snapshot_ack(received_data, received_length, snapshot_ack))
+				break;
+
+			snapshot_rate.on_snapshot_acked(snapshot_ack.sequence, arrival_time);
+
+			if (!has_snapshot_ack || sequence_more_recent(snapshot_ack.sequence, acked_snapshot_sequence)) {
+				has_snapshot_ack = true;
+				acked_snapshot_sequence = snapshot_ack.sequence;
+			}
+			break;
+		}
+		default: // Duplicate SYN-ACKs and the client's ACK, the handshake is already over by the time we get here. Retransmitted SYNs are answered by the network thread.
+			break;
+	}
 }
 
-// todo - fix the bug that happens when the ball is hit from the side
-void Game::bounce_ball() {
-	ball.velocity_x *= -1;
+void Game::send_snapshot() {
+	SnapshotMessage snapshot;
+	snapshot.sequence = next_snapshot_sequence++;
+	snapshot.server_tick = match.tick;
+	snapshot.ball_event_type = latest_ball_event.type;
+	snapshot.ball_tick = latest_ball_event.tick;
+	snapshot.ball_x = latest_ball_event.x;
+	snapshot.ball_y = latest_ball_event.y;
+	snapshot.ball_velocity_x = latest_ball_event.velocity_x;
+	snapshot.ball_velocity_y = latest_ball_event.velocity_y;
+	snapshot.player_1_y = to_pixels(match.player_1.y);
+	snapshot.player_2_y = to_pixels(lag_compensator.get_client_paddle().y); // Not back in the middle until the client hears about the score, see LagCompensator.
+	snapshot.last_processed_input = last_processed_input;
+
+	// Delta against the latest snapshot the client has, or send everything if it hasn't acknowledged one recently enough.
+	const SnapshotMessage* baseline = has_snapshot_ack ? sent_snapshots.find(acked_snapshot_sequence) : nullptr;
+
+	int snapshot_length = encode_snapshot(snapshot, baseline, packet_buffer, MAX_PACKET_LENGTH);
+
+	sent_snapshots.store(snapshot); // Has to be stored after encoding as it might take the baseline's place in the history.
+	connection_manager.send_data(packet_buffer, snapshot_length);
+
+	snapshot_rate.note_sent_bytes(snapshot_length);
+	snapshot_rate.on_snapshot_sent(snapshot.sequence, get_network_time());
+}
 
-	ball_hit_count++;
-	if (ball_hit_count != 0 && ball_hit_count % 3 == 0)
-		increase_ball_speed();
+// The server's clock in ticks, see TimeResponseMessage. Below 0 during the countdown.
+double Game::get_server_clock(double now) {
+	return match.tick + (now - last_step_network_time) / SIMULATION_STEP_MS;
 }
 
-void Game::ai() {
-	if (ball.sprite.rect.y + ball.sprite.rect.h / 2 > player_2.sprite.rect.y + ball.sprite.rect.h / 2) { // Move down if the middle of the ball is below middle of the paddle.
-		player_2.move(MoveDirection::DOWN);
-	}
-	else if (ball.sprite.rect.y + ball.sprite.rect.h / 2 < player_2.sprite.rect.y + player_2.sprite.rect.h / 2) { // Move up if the middle of the ball is above middle of the paddle.
-		player_2.move(MoveDirection::UP);
-	}
+void Game::send_time_request() {
+	TimeRequestMessage time_request;
+	clock_sync.make_request(get_network_time(), time_request);
+
+	connection_manager.send_data(packet_buffer, encode_time_request(time_request, packet_buffer, MAX_PACKET_LENGTH));
 }
 
-void Game::process_received_data(std::string received_data) {
-	if (received_data == "CONNRESET") {
-		std::cerr << "Lost connection." << "\n";
-		connection_manager.is_connected = false;
-		push_event("main_menu_err", get_nethelpmsgstr(WSAECONNRESET));
-	}
-	else {
-		std::vector<std::string> seperated_args = split_string(received_data, 32); // char(32) would be " " (whitespace).
-
-		for (auto&& arg : seperated_args) {
-			std::vector<std::string> command_and_value = split_string(arg, 58); // char(58) would be ":".
-
-			if (command_and_value.size() == 2) {
-				std::string command = command_and_value[0];
-				int value = std::stoi(command_and_value[1]);
-
-				if (command == "bx")
-					ball.sprite.rect.x = value;
-				else if (command == "by")
-					ball.sprite.rect.y = value;
-				else if (command == "p1")
-					player_1.sprite.rect.y = value;
-				else if (command == "p2")
-					player_2.sprite.rect.y = value;
-				else if (command == "p1s") {
-					if (player_1_score != value) {
-						player_1_score = value;
-						update_scores(renderer_ptr.get());
-						center_scores();
-					}
-				}
-				else if (command == "p2s") {
-					if (player_2_score != value) {
-						player_2_score = value;
-						update_scores(renderer_ptr.get());
-						center_scores();
-					}
-				}
-				else if (command == "bvx")
-					ball.velocity_x = value;
-				else if (command == "bvy")
-					ball.velocity_y = value;
-				else if (command == "endsc")
-					if (end_score != value)
-						end_score = value;
-			}
+// Called on the server once a score is too old for lag_compensator to take it back, with the match right after it.
+void Game::push_score_event(const MatchState& scored_match) {
+	ReliableEvent event;
+	event.type = scored_match.has_ended ? ReliableEventType::MATCH_END : ReliableEventType::SCORE;
+	event.tick = scored_match.tick;
+	event.player_1_score = scored_match.player_1_score;
+	event.player_2_score = scored_match.player_2_score;
+
+	reliable_events.push_event(event);
+}
+
+// Every event the client hasn't acknowledged yet and is due to be sent (again).
+void Game::send_reliable_events() {
+	ReliableEventMessage event_message;
+	if (!reliable_events.make_event_message(get_network_time(), snapshot_rate.get_ack_timeout(), event_message))
+		return;
+
+	int event_message_length = encode_reliable_event(event_message, packet_buffer, MAX_PACKET_LENGTH);
+	connection_manager.send_data(packet_buffer, event_message_length);
+	snapshot_rate.note_sent_bytes(event_message_length);
+}
+
+// The client doesn't detect scoring on its own, it starts the new round (or ends the game) when the server says someone scored.
+void Game::apply_reliable_event(const ReliableEvent& event) {
+	if (has_ended) // Nothing can happen after the match is over.
+		return;
+
+	match.player_1_score = event.player_1_score;
+	match.player_2_score = event.player_2_score;
+	match.has_ended = (event.type == ReliableEventType::MATCH_END);
+
+	reset_positions(match);
+	play_if_sound_on(score_sfx.get());
+	start_new_round();
+}
+
+// Keeps the most important thing that happened to the ball this tick, it gets sent at the end of the tick.
+void Game::note_ball_event(BallEventType type) {
+	if (!has_pending_ball_event || type > pending_ball_event_type)
+		pending_ball_event_type = type;
+
+	has_pending_ball_event = true;
+}
+
+void Game::send_ball_event() {
+	latest_ball_event = make_ball_event(match, pending_ball_event_type);
+
+	int ball_event_length = encode_ball_event(latest_ball_event, packet_buffer, MAX_PACKET_LENGTH);
+	connection_manager.send_data(packet_buffer, ball_event_length);
+	snapshot_rate.note_sent_bytes(ball_event_length);
+
+	has_pending_ball_event = false;
+	ball_correction_timer = SDL_GetTicks();
+}
+
+// Sent as soon as lag_compensator rewinds the match. Snapshots carry where the ball is now instead, a rewind showing up in a late snapshot would throw away everything the client heard since.
+void Game::send_rewind_event(const BallEventMessage& rewind_event) {
+	int rewind_event_length = encode_ball_event(rewind_event, packet_buffer, MAX_PACKET_LENGTH);
+	connection_manager.send_data(packet_buffer, rewind_event_length);
+	snapshot_rate.note_sent_bytes(rewind_event_length);
+
+	latest_ball_event = make_ball_event(match, BallEventType::CORRECTION);
+	ball_correction_timer = SDL_GetTicks();
+}
+
+// Moves the server's paddle to where it was (snapshot_interpolator's delay) milliseconds ago, and the ball to where its trajectory had it on the server's tick at that time.
+void Game::apply_interpolated_state() {
+	RemoteState state;
+	if (!snapshot_interpolator.sample(get_network_time(), state)) // Same clock as the arrival times the network thread stamps on.
+		return;
+
+	match.player_1.y = static_cast<int>(std::lround(state.player_1_y * FIXED_ONE));
+
+	view_tick = state.server_tick;
+
+	const BallEventMessage* ball_event = ball_trajectory.find_event(state.server_tick);
+	if (ball_event == nullptr)
+		return;
+
+	// Play the sound for a bounce once we get to see it.
+	if (ball_event->tick > last_played_ball_event_tick) {
+		if (ball_event->type == BallEventType::PADDLE_BOUNCE || ball_event->type == BallEventType::SPEED_UP || ball_event->type == BallEventType::REWIND) {
+			if (!is_fast)
+				play_if_sound_on(ball_event->velocity_x > 0 ? ding_sfx.get() : dong_sfx.get()); // Moving right means it bounced off player 1.
 		}
+		else if (ball_event->type == BallEventType::WALL_BOUNCE)
+			play_if_sound_on(ball_event->velocity_y > 0 ? bounce_ymin_sfx.get() : bounce_ymax_sfx.get()); // Moving down means it bounced off the top.
+
+		last_played_ball_event_tick = ball_event->tick;
 	}
+
+	double ball_x = 0.0;
+	double ball_y = 0.0;
+	ball_trajectory.evaluate(*ball_event, state.server_tick, ball_x, ball_y);
+
+	match.ball.x = static_cast<int>(std::lround(ball_x));
+	match.ball.y = static_cast<int>(std::lround(ball_y));
+	match.ball_velocity_x = ball_event->velocity_x;
+	match.ball_velocity_y = ball_event->velocity_y;
 }
 
-std::vector<std::string> Game::split_string(const std::string& text, char seperator) {
-	std::vector<std::string> tokens;
+void Game::play_step_sounds() {
+	if (match.events & MATCH_EVENT_TOP_WALL_BOUNCE)
+		play_if_sound_on(bounce_ymin_sfx.get());
+
+	if (match.events & MATCH_EVENT_BOTTOM_WALL_BOUNCE)
+		play_if_sound_on(bounce_ymax_sfx.get());
+
+	if ((match.events & MATCH_EVENT_PLAYER_1_HIT) && !is_fast)
+		play_if_sound_on(ding_sfx.get());
+
+	if ((match.events & MATCH_EVENT_PLAYER_2_HIT) && !is_fast)
+		play_if_sound_on(dong_sfx.get());
+
+	if (match.events & (MATCH_EVENT_PLAYER_1_SCORED | MATCH_EVENT_PLAYER_2_SCORED))
+		play_if_sound_on(score_sfx.get());
+}
+
+// See if there's any data from the server/client and apply it to the current state if there is.
+void Game::receive_network_data() {
+	int received_length = 0;
+	double arrival_time = 0.0;
+
+	while (connection_manager.is_connected && (received_length = connection_manager.receive_data(packet_buffer, MAX_PACKET_LENGTH, &arrival_time)) != 0)
+		process_received_data(packet_buffer, received_length, arrival_time);
+}
 
-	std::size_t start = 0;
-	std::size_t end = 0;
+// A rollback game steps the match on both sides. What we render is the session's latest prediction, which a rollback can move around (or even take a point back from) until the other side's inputs confirm it.
+void Game::tick_rollback(const MatchInputs& inputs) {
+	PaddleInput local_input = (connection_manager.type == "server") ? inputs.player_1 : inputs.player_2;
 
-	while ((end = text.find(seperator, start)) != std::string::npos) {
-		tokens.push_back(text.substr(start, end - start));
-		start = end + 1;
+	bool had_ended = match.has_ended;
+	int previous_player_1_score = match.player_1_score;
+	int previous_player_2_score = match.player_2_score;
+
+	bool has_advanced = rollback_session.advance(local_input);
+	match = rollback_session.get_state(); // Even if we're waiting on the other side, a late input might have rolled things back.
+
+	// A finished match keeps the events of its last step, don't play them again.
+	if (has_advanced && !had_ended)
+		play_step_sounds();
+
+	send_rollback_messages();
+
+	// The match only ends for us once it has ended on a confirmed frame, a rollback could still take the last point back before that.
+	const MatchState& confirmed_state = rollback_session.get_confirmed_state(rollback_session.get_confirmed_frame());
+	if (confirmed_state.has_ended) {
+		match = confirmed_state;
+		start_new_round();
+	}
+	else if (has_advanced && !had_ended && !match.has_ended && (match.events & (MATCH_EVENT_PLAYER_1_SCORED | MATCH_EVENT_PLAYER_2_SCORED)))
+		start_new_round();
+	else if (match.player_1_score != previous_player_1_score || match.player_2_score != previous_player_2_score) { // A rollback changed the score.
+		update_scores(renderer_ptr.get());
+		center_scores();
 	}
-	tokens.push_back(text.substr(start));
-	return tokens;
 }
 
+// Every input of ours the other side doesn't have yet, and the hash of our latest confirmed frame. Every frame's hash goes into desync_detector on our side.
+void Game::send_rollback_messages() {
+	uint32_t confirmed_frame = rollback_session.get_confirmed_frame();
+
+	for (; hashed_frame_count <= confirmed_frame; hashed_frame_count++) {
+		if (desync_detector.store_local(hashed_frame_count, hash_match_state(rollback_session.get_confirmed_state(hashed_frame_count))))
+			report_desync();
+	}
+
+	StateHashMessage state_hash;
+	state_hash.tick = confirmed_frame;
+	state_hash.hash = hash_match_state(rollback_session.get_confirmed_state(confirmed_frame));
+
+	RollbackInputMessage rollback_input;
+	rollback_session.make_input_message(rollback_input);
+	connection_manager.send_data(packet_buffer, encode_rollback_input(rollback_input, packet_buffer, MAX_PACKET_LENGTH));
+	connection_manager.send_data(packet_buffer, encode_state_hash(state_hash, packet_buffer, MAX_PACKET_LENGTH));
+}
+
+// Runs one SIMULATION_STEP_MS step of the game, however many frames are rendered in between.
 void Game::tick() {
+	save_render_positions();
+
 	const Uint8* keyboard_state = SDL_GetKeyboardState(NULL); // Can't use smart pointers here - "The pointer returned is a pointer to an internal SDL array. It will be valid for the whole lifetime of the application and should not be freed by the caller." (from the SDL documentation for SDL_GetKeyboardState)
-	process_input(keyboard_state); // This is where we need to handle more precise keyboard input, that's why we're using SDL_GetKeyboardState() when we're in game for keyboard input handling.
+	MatchInputs inputs = process_input(keyboard_state); // This is where we need to handle more precise keyboard input, that's why we're using SDL_GetKeyboardState() when we're in game for keyboard input handling.
+
+	if (game_mode == GameMode::ONLINE_MULTIPLAYER && !connection_manager.is_connected) {
+		poll_connection();
+		return;
+	}
+
+	bool is_rollback = (game_mode == GameMode::ONLINE_MULTIPLAYER && netcode_mode == NetcodeMode::ROLLBACK);
+
+	if (has_ended) {
+		// The other side might still be missing some of our inputs to get to the end of the match, or the server's acknowledgement of the last point.
+		if (game_mode == GameMode::ONLINE_MULTIPLAYER && connection_manager.is_connected) {
+			receive_network_data();
+
+			if (is_rollback)
+				send_rollback_messages();
+			else if (connection_manager.type == "server")
+				send_reliable_events();
+		}
 
-	if ((game_mode == GameMode::ONLINE_MULTIPLAYER && !connection_manager.is_connected) || has_ended)
 		return;
+	}
+
+	// Send the client's inputs as soon as they're made, even during the countdown, so the server sees them in the same order they were predicted in.
+	if (game_mode == GameMode::ONLINE_MULTIPLAYER && connection_manager.type == "client" && !is_rollback) {
+		send_client_inputs();
 
-	// Does the countdown before the game starts.
+		if (clock_sync.should_send_request(get_network_time()))
+			send_time_request();
+	}
+
+	// Does the countdown before the game starts. The ball doesn't move yet, but the paddles can. Not in a rollback game though, everything there has to go through the session's frames.
 	if (game_start_time + countdown_time > SDL_GetTicks()) {
 		if (!has_played_countdown) {
 			play_if_sound_on(countdown_sfx.get());
 			has_played_countdown = true;
 		}
+
+		if (is_rollback)
+			return;
+
+		move_paddle(match.player_1, inputs.player_1);
+		move_paddle(match.player_2, inputs.player_2);
 		return;
 	}
 	
@@ -429,79 +832,58 @@ void Game::tick() {
 		is_fast = true;
 	}
 
-	// See if there's any data from the server/client and apply it to the current state if there is.
 	if (game_mode == GameMode::ONLINE_MULTIPLAYER && connection_manager.is_connected)
-		process_received_data(connection_manager.receive_data());
+		receive_network_data();
+
+	if (is_rollback) {
+		tick_rollback(inputs);
+		return;
+	}
 
-	ball.move();
+	if (game_mode == GameMode::ONLINE_MULTIPLAYER && connection_manager.type == "client") {
+		apply_interpolated_state();
+		return; // Everything below is the server's job.
+	}
 
 	if (game_mode == GameMode::SINGLE_PLAYER)
-		ai();
+		inputs.player_2 = lookahead_ai ? lookahead_ai->get_input(match) : ai.get_input(match);
 
-	if (game_mode == GameMode::PRACTICE)
-		player_2.sprite.rect.y = ball.sprite.rect.y;
+	match = step(match, inputs);
 
-	// Bounce the ball off of top and bottom sides of the screen.
-	if (ball.sprite.rect.y <= 0) { 
-		ball.velocity_y *= -1;
-		play_if_sound_on(bounce_ymin_sfx.get());
-	}
+	bool is_online_server = (game_mode == GameMode::ONLINE_MULTIPLAYER && connection_manager.type == "server" && connection_manager.is_connected);
+	if (is_online_server)
+		lag_compensator.record_step(inputs, match);
 
-	if (ball.sprite.rect.y + ball.sprite.rect.h >= screen_height) {
-		ball.velocity_y *= -1;
-		play_if_sound_on(bounce_ymax_sfx.get());
-	}
+	// Keep the server's clock ticking evenly, unless the steps have fallen too far behind (or gotten ahead of) it.
+	double now = get_network_time();
+	last_step_network_time += SIMULATION_STEP_MS;
+	if (std::abs(now - last_step_network_time) > SIMULATION_STEP_MS)
+		last_step_network_time = now;
 
-	// Bounce the ball off of player paddles.
-	if (SDL_HasIntersection(&ball.sprite.rect, &player_1.sprite.rect)) {
-		bounce_ball();
-		if (!is_fast)
-			play_if_sound_on(ding_sfx.get());
-	}
+	if (match.has_ball_event)
+		note_ball_event(match.ball_event_type);
 
-	if (SDL_HasIntersection(&ball.sprite.rect, &player_2.sprite.rect)) {
-		bounce_ball();
-		if (!is_fast)
-			play_if_sound_on(dong_sfx.get());
-	}
+	play_step_sounds();
 
-	// Check if player 1 scored.
-	if (ball.sprite.rect.x + ball.sprite.rect.w >= screen_width) {
-		player_1_score++;
-		play_if_sound_on(score_sfx.get());
-		start_new_round("player1");
-	}
+	if (match.events & (MATCH_EVENT_PLAYER_1_SCORED | MATCH_EVENT_PLAYER_2_SCORED))
+		start_new_round();
 
-	// Check if player 2 scored.
-	if (ball.sprite.rect.x <= 0) {
-		player_2_score++;
-		play_if_sound_on(score_sfx.get());
-		start_new_round("player2");
-	}
+	MatchState scored_match;
+	if (is_online_server && lag_compensator.pop_confirmed_score(match, scored_match))
+		push_score_event(scored_match);
 
-	// If server, send data about the game state to the client every server_send_interval milliseconds for synchronization.
-	if (server_send_interval + server_send_timer < SDL_GetTicks() && game_mode == GameMode::ONLINE_MULTIPLAYER && connection_manager.type == "server" && connection_manager.is_connected) {
-		std::string serialized_data = "bx:" + std::to_string(ball.sprite.rect.x) +
-									 " by:" + std::to_string(ball.sprite.rect.y) +
-									 " p1:" + std::to_string(player_1.sprite.rect.y) + 
-			                         " p1s:" + std::to_string(player_1_score) +
-									 " p2s:" + std::to_string(player_2_score) + 
-									 " bvx:" + std::to_string(ball.velocity_x) +
-									 " bvy:" + std::to_string(ball.velocity_y) +
-									 " endsc:" + std::to_string(end_score);
-	// todo - maybe use protobuf instead?
-
-		connection_manager.send_data(serialized_data);
-		server_send_timer = SDL_GetTicks();
-	}
+	// If server, let the client know about any change in the ball's trajectory right away, or where the ball is every once in a while if there hasn't been any.
+	if (is_online_server) {
+		if (!has_pending_ball_event && ball_correction_interval + ball_correction_timer < SDL_GetTicks())
+			note_ball_event(BallEventType::CORRECTION);
 
-	// If we moved in online play, let the other side know about that.
-	if (game_mode == GameMode::ONLINE_MULTIPLAYER && connection_manager.is_connected && online_has_moved) {
-		if (connection_manager.type == "client")
-			connection_manager.send_data("p2:" + std::to_string(player_2.sprite.rect.y));
-		else if (connection_manager.type == "server")
-			connection_manager.send_data("p1:" + std::to_string(player_1.sprite.rect.y));
+		if (has_pending_ball_event)
+			send_ball_event();
 
-		online_has_moved = false;
+		send_reliable_events();
 	}
+
+	// If server, send data about the game state to the client whenever snapshot_rate says it's time to, for synchronization.
+	if (is_online_server && snapshot_rate.should_send_snapshot(match, get_network_time()))
+		send_snapshot();
 }
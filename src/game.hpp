@@ -1,6 +1,7 @@
 #pragma once
 
 #include <cstdio>
+#include <cmath>
 #include <array>
 #include <string>
 #include <vector>
@@ -12,6 +13,17 @@
 #include "paddle.hpp"
 #include "ball.hpp"
 #include "text.hpp"
+#include "snapshot_interpolator.hpp"
+#include "ball_trajectory.hpp"
+#include "match_simulation.hpp"
+#include "desync_detector.hpp"
+#include "rollback_session.hpp"
+#include "snapshot_rate_controller.hpp"
+#include "reliable_event_channel.hpp"
+#include "clock_sync.hpp"
+#include "lag_compensator.hpp"
+#include "paddle_ai.hpp"
+#include "lookahead_ai.hpp"
 
 enum class GameMode {
 	DUMMY_VALUE,
@@ -21,11 +33,23 @@ enum class GameMode {
 	ONLINE_MULTIPLAYER
 };
 
+// How an online game is kept in sync. The server picks one and lets the client know during the handshake.
+enum class NetcodeMode {
+	SERVER_AUTHORITATIVE, // The server steps the match and streams it to the client, which only predicts its own paddle.
+	ROLLBACK // Both sides step the match and only send each other their inputs, see RollbackSession.
+};
+
 class Game {
 	public:
 		ConnectionManager connection_manager;
 
 		GameMode game_mode = GameMode::DUMMY_VALUE;
+		NetcodeMode netcode_mode = NetcodeMode::SERVER_AUTHORITATIVE;
+
+		// Plays player 2 in single player. Expert has a search thread of its own, so it only exists while it's playing.
+		AiDifficulty ai_difficulty = DEFAULT_AI_DIFFICULTY;
+		PaddleAi ai;
+		std::unique_ptr<LookaheadAi> lookahead_ai;
 
 		std::shared_ptr<SDL_Renderer> renderer_ptr = nullptr;
 
@@ -37,6 +61,15 @@ class Game {
 
 		Ball ball;
 
+		// Where everything is and the score. The rules that move it along are in step(), rendering and audio only ever read it.
+		// In a server authoritative game the client doesn't step it at all, it fills it in from what the server sends. In a rollback game it's rollback_session's latest state on both sides.
+		MatchState match;
+
+		// Where the paddles and the ball were before the latest step. Frames rendered in between two steps are drawn part of the way from here to where they are now.
+		MatchRect previous_player_1_rect;
+		MatchRect previous_player_2_rect;
+		MatchRect previous_ball_rect;
+
 		unsigned int game_start_time = 0;
 		unsigned int countdown_time = 1714;
 
@@ -61,12 +94,6 @@ class Game {
 		std::shared_ptr<Mix_Chunk> score_sfx = nullptr;
 		std::shared_ptr<Mix_Chunk> uwu_sfx = nullptr;
 
-		int player_1_score = 0;
-		int player_2_score = 0;
-		int end_score = 10;
-
-		int ball_hit_count = 0;
-
 		Sprite game_background;
 		Sprite you_won_screen;
 		Sprite you_lost_screen;
@@ -78,28 +105,91 @@ class Game {
 		Text server_awaiting_connection_text;
 		Text client_connecting_text;
 
-		bool online_has_moved = false;
-		uint32_t server_send_interval = 50;
-		uint32_t server_send_timer = 0;
+		// Instead of streaming where the ball is, the server only sends an event whenever its trajectory changes, and resends where it is every ball_correction_interval milliseconds just in case.
+		bool has_pending_ball_event = false;
+		BallEventType pending_ball_event_type = BallEventType::CORRECTION;
+		BallEventMessage latest_ball_event;
+		uint32_t ball_correction_interval = 1000;
+		uint32_t ball_correction_timer = 0;
+
+		BallTrajectory ball_trajectory;
+		uint32_t last_played_ball_event_tick = 0;
+
+		// The server encodes every snapshot as a delta against the latest one the client acknowledged, and the client drops any snapshot older than the one it already has.
+		uint16_t next_snapshot_sequence = 0;
+		SnapshotHistory sent_snapshots;
+		bool has_snapshot_ack = false;
+		uint16_t acked_snapshot_sequence = 0;
+
+		// Sends snapshots more often when the ball is fast or about to be hit, and less often when the client's link can't keep up.
+		SnapshotRateController snapshot_rate;
+
+		// Scores and the end of the match go to the client over this instead of with every snapshot, so they get there exactly once and in order.
+		ReliableEventChannel reliable_events;
+
+		SnapshotHistory received_snapshots;
+		bool has_received_snapshot = false;
+		uint16_t latest_snapshot_sequence = 0;
+
+		// The client moves its paddle as soon as a key is pressed, and replays the inputs the server hasn't applied yet on top of every paddle position the server sends.
+		uint8_t input_history[INPUT_HISTORY_SIZE] = { 0 }; // FRAME_INPUT_ flags, indexed by sequence number.
+		uint16_t next_input_sequence = 1; // 0 is reserved for "no input processed yet", see advance_input_sequence.
+		uint16_t last_acked_input = 0; // Only used by the client, the newest input the server said it has applied.
+		uint16_t last_processed_input = 0; // Only used by the server.
+
+		// The server checks the client's inputs against the ball the client was looking at when it made them, and rewinds the match if they hit it.
+		LagCompensator lag_compensator;
+
+		// The client doesn't simulate the ball or the server's paddle, it renders them slightly in the past from the snapshots and ball events it received.
+		SnapshotInterpolator snapshot_interpolator;
+		double view_tick = 0.0; // The server tick the client is rendering the server's side of the match at.
+
+		// The client keeps track of the server's clock to place what it sends on its own timeline. The server's clock counts ticks, and keeps running between them from when the latest one was stepped.
+		ClockSync clock_sync;
+		double last_step_network_time = 0.0; // Only used by the server.
+
+		RollbackSession rollback_session;
+		uint32_t hashed_frame_count = 0; // How many of rollback_session's confirmed frames went through desync_detector so far.
+
+		// In rollback mode both sides send the hash of their latest confirmed frame. Both start from the same seed and step the same inputs, so a mismatch means something isn't deterministic.
+		DesyncDetector desync_detector;
+
+		uint8_t packet_buffer[MAX_PACKET_LENGTH] = { 0 }; // Every message we send or receive during the game gets encoded to/decoded from here, so the network code doesn't allocate anything.
 
 		Game() {};
 		Game(int screen_width_param, int screen_height_param, GameMode game_mode, SDL_Renderer* renderer);
 		void init_game(GameMode init_mode, int screen_width, int screen_height, bool is_sound_on, int end_score_param);
-		void process_input(const Uint8* keyboard_state);
-		std::vector<std::string> split_string(const std::string& text, char seperator);
-		int generate_random_number(int range_begin, int range_end, int multiples = 1);
+		MatchInputs process_input(const Uint8* keyboard_state);
 		void push_event(std::string data1, std::string data2 = "none");
-		void process_received_data(std::string received_data);
-		void reset_paddle_positions();
-		void reset_ball_position();
+		void process_received_data(const uint8_t* received_data, int received_length, double arrival_time);
 		void update_scores(SDL_Renderer* renderer);
 		void center_scores();
-		void increase_ball_speed();
-		void bounce_ball();
-		void start_new_round(std::string winner);
-		void ai();
+		void start_new_round();
 		void tick();
+		void play_step_sounds();
+		void save_render_positions();
+		SDL_Rect get_render_rect(const MatchRect& previous_rect, const MatchRect& current_rect, double step_progress);
 		void reset_game();
+		void reset_network_state();
+		void record_client_input(bool up, bool down);
+		void send_client_inputs();
+		void reconcile_player_2(int authoritative_y, uint16_t last_processed_input_param);
+		void apply_interpolated_state();
+		void poll_connection();
+		void report_connection_error(int error_code);
+		void report_desync();
+		void send_snapshot();
+		void note_ball_event(BallEventType type);
+		void send_ball_event();
+		void send_rewind_event(const BallEventMessage& rewind_event);
+		double get_server_clock(double now);
+		void send_time_request();
+		void push_score_event(const MatchState& scored_match);
+		void send_reliable_events();
+		void apply_reliable_event(const ReliableEvent& event);
+		void receive_network_data();
+		void tick_rollback(const MatchInputs& inputs);
+		void send_rollback_messages();
 		void play_if_sound_on(Mix_Chunk* chunk, int loops = 0);
 		std::string get_nethelpmsgstr(int errcode);
 };
\ No newline at end of file
@@ -0,0 +1,15 @@
+#include "headless_modes.hpp"
+
+/*
+The entry point of dingdong-headless, the server and the command-line tools without the game around them.
+None of it touches SDL, and it only needs Winsock on Windows, so it builds anywhere with plain sockets. This is how the epoll and io_uring transports get to run on Linux.
+Takes the same arguments as the game does, see run_headless_mode. Only link one of this, main.cpp and arena_main.cpp into a build.
+*/
+int main(int argc, char* argv[]) {
+	int exit_code = 0;
+	if (run_headless_mode(argc, argv, exit_code))
+		return exit_code;
+
+	print_headless_usage();
+	return 1;
+}
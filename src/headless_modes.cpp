@@ -0,0 +1,80 @@
+#include "headless_modes.hpp"
+
+// "dingdong --server [port] [max matches] [threads] [transport] [snapshot kbps] [ai difficulty]" hosts matches without opening a window, loading any assets or touching the audio device.
+// Uses one thread per core and the platform's default transport unless told otherwise. Snapshots to each client are capped to snapshot kbps kilobits per second if given and not 0.
+// The AI the clients play against is easy, normal or hard, normal by default.
+int run_headless_server(int argc, char* argv[]) {
+	int port = (argc > 2) ? std::atoi(argv[2]) : DEFAULT_PORT;
+	int max_sessions = (argc > 3) ? std::atoi(argv[3]) : DEFAULT_MATCH_SESSIONS;
+	int shard_count = (argc > 4) ? std::atoi(argv[4]) : static_cast<int>(std::thread::hardware_concurrency());
+
+	TransportBackend backend = get_default_transport_backend();
+	if (argc > 5 && !parse_transport_backend(argv[5], backend)) {
+		std::cerr << "Unknown transport \"" << argv[5] << "\", expected select, epoll or io_uring." << "\n";
+		return 1;
+	}
+
+	double snapshot_bytes_per_second = (argc > 6) ? std::atof(argv[6]) * 1000.0 / 8.0 : DEFAULT_SNAPSHOT_BYTES_PER_SECOND;
+
+	AiDifficulty ai_difficulty = DEFAULT_AI_DIFFICULTY;
+	if (argc > 7 && !parse_ai_difficulty(argv[7], ai_difficulty)) {
+		std::cerr << "Unknown AI difficulty \"" << argv[7] << "\", expected easy, normal or hard." << "\n";
+		return 1;
+	}
+
+	// The lag compensator has to be able to replay what the AI did, and the expert's moves depend on how far its search got in time.
+	if (ai_difficulty == AiDifficulty::EXPERT) {
+		std::cerr << "The server can't use the expert AI, expected easy, normal or hard." << "\n";
+		return 1;
+	}
+
+	ShardedMatchServer server;
+	int result = server.init(port, max_sessions, shard_count, backend, snapshot_bytes_per_second, ai_difficulty);
+	if (result != 0)
+		return result;
+
+	server.run();
+	return 0;
+}
+
+bool run_headless_mode(int argc, char* argv[], int& exit_code) {
+	if (argc < 2)
+		return false;
+
+	std::string mode = argv[1];
+	if (mode == "--server")
+		exit_code = run_headless_server(argc, argv);
+	else if (mode == "--rollback-test")
+		exit_code = run_rollback_harness(argc, argv);
+	else if (mode == "--lookahead-bench")
+		exit_code = run_lookahead_benchmark(argc, argv);
+	else if (mode == "--arena")
+		exit_code = run_arena(argc, argv);
+	else if (mode == "--batch-bench")
+		exit_code = run_match_batch_benchmark(argc, argv);
+	else if (mode == "--protocol-bench")
+		exit_code = run_protocol_benchmark(argc, argv);
+	else if (mode == "--transport-bench")
+		exit_code = run_transport_benchmark(argc, argv);
+	else if (mode == "--shard-bench")
+		exit_code = run_shard_benchmark(argc, argv);
+	else if (mode == "--step-bench")
+		exit_code = run_step_benchmark(argc, argv);
+	else
+		return false;
+
+	return true;
+}
+
+void print_headless_usage() {
+	std::cout << "Usage:" << "\n";
+	std::cout << "  --server [port] [max matches] [threads] [transport] [snapshot kbps] [ai difficulty]" << "\n";
+	std::cout << "  --rollback-test [latency ms] [jitter ms] [loss percent] [seconds] [seed]" << "\n";
+	std::cout << "  --lookahead-bench [ticks]" << "\n";
+	std::cout << "  --arena [player 1 ai] [player 2 ai] [matches] [threads] [seed] [end score]" << "\n";
+	std::cout << "  --batch-bench [matches] [ticks] [seed]" << "\n";
+	std::cout << "  --protocol-bench [snapshots] [seed]" << "\n";
+	std::cout << "  --transport-bench [transport] [datagrams] [batch size]" << "\n";
+	std::cout << "  --shard-bench [matches per thread] [seconds] [max threads]" << "\n";
+	std::cout << "  --step-bench [steps] [seed]" << "\n";
+}
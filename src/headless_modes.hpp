@@ -0,0 +1,21 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <thread>
+#include "sharded_match_server.hpp"
+#include "rollback_harness.hpp"
+#include "lookahead_benchmark.hpp"
+#include "arena.hpp"
+#include "match_batch_benchmark.hpp"
+#include "protocol_benchmark.hpp"
+#include "transport_benchmark.hpp"
+#include "shard_benchmark.hpp"
+#include "step_benchmark.hpp"
+
+// Everything dingdong can do without a window, an audio device or SDL. Both the game and dingdong-headless start here, see headless_main.cpp.
+// Returns false if argv[1] isn't one of these, otherwise runs it and leaves what main should return in exit_code.
+bool run_headless_mode(int argc, char* argv[], int& exit_code);
+void print_headless_usage();
+
+int run_headless_server(int argc, char* argv[]);
@@ -0,0 +1,420 @@
+#include "io_uring_transport.hpp"
+
+#ifdef HAS_IO_URING
+#include <vector>
+#include <cstdio>
+#include <fcntl.h>
+
+// What a completion belongs to is kept in the upper half of its user_data, the slot in the lower half.
+#define IO_URING_RECEIVE_OPERATION 1ull
+#define IO_URING_SEND_OPERATION 2ull
+#define IO_URING_CANCEL_OPERATION 3ull
+#define IO_URING_PROVIDE_BUFFERS_OPERATION 4ull
+
+// How long the destructor waits for the kernel to let go of the slots.
+#define IO_URING_CLOSE_TIMEOUT_US 100000
+
+// Every receive is a multishot RECVMSG, which is 6.0 and up. It's a flag on an op older kernels already have, so probing for the op doesn't tell, and the kernel's version has to.
+static bool has_multishot_receive() {
+	utsname name;
+	int major = 0;
+	int minor = 0;
+	if (uname(&name) != 0 || sscanf(name.release, "%d.%d", &major, &minor) != 2)
+		return false;
+
+	return major >= 6;
+}
+
+IoUringTransport::~IoUringTransport() {
+	close_ring();
+}
+
+bool IoUringTransport::open(SOCKET sock_param) {
+	sock = sock_param;
+
+	if (!has_multishot_receive()) { // Receives would fail with EINVAL on every call otherwise, better to have the caller fall back to another transport.
+		last_error = EOPNOTSUPP;
+		return false;
+	}
+
+	// Handing back every receive buffer, every send, the receive and a cancel can all be queued at the same time, and every one of those (twice for a zero copy send, once more for every datagram received) can have a completion waiting.
+	io_uring_params params;
+	memset(&params, 0, sizeof(params));
+	params.flags = IORING_SETUP_CQSIZE;
+	params.cq_entries = 2 * (IO_URING_RECEIVE_BUFFERS + IO_URING_SEND_DEPTH) + 2;
+
+	ring_fd = static_cast<int>(syscall(__NR_io_uring_setup, IO_URING_RECEIVE_BUFFERS + IO_URING_SEND_DEPTH + 2, &params));
+	if (ring_fd < 0) {
+		last_error = errno;
+		ring_fd = -1;
+		return false;
+	}
+
+	if (!(params.features & IORING_FEAT_EXT_ARG)) { // Needed to wait with a timeout, 5.11 and up.
+		last_error = EOPNOTSUPP;
+		close_ring();
+		return false;
+	}
+
+	// Map the rings the kernel shares with us. Newer kernels put both rings in one mapping.
+	submission_ring_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	completion_ring_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+	if (params.features & IORING_FEAT_SINGLE_MMAP)
+		submission_ring_size = completion_ring_size = std::max(submission_ring_size, completion_ring_size);
+
+	submission_ring = mmap(nullptr, submission_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQ_RING);
+	if (submission_ring == MAP_FAILED) {
+		last_error = errno;
+		submission_ring = nullptr;
+		close_ring();
+		return false;
+	}
+
+	if (params.features & IORING_FEAT_SINGLE_MMAP)
+		completion_ring = submission_ring;
+	else {
+		completion_ring = mmap(nullptr, completion_ring_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_CQ_RING);
+		if (completion_ring == MAP_FAILED) {
+			last_error = errno;
+			completion_ring = nullptr;
+			close_ring();
+			return false;
+		}
+	}
+
+	submission_entries_size = params.sq_entries * sizeof(io_uring_sqe);
+	submission_entries = static_cast<io_uring_sqe*>(mmap(nullptr, submission_entries_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd, IORING_OFF_SQES));
+	if (submission_entries == MAP_FAILED) {
+		last_error = errno;
+		submission_entries = nullptr;
+		close_ring();
+		return false;
+	}
+
+	uint8_t* submission_base = static_cast<uint8_t*>(submission_ring);
+	submission_head = reinterpret_cast<unsigned*>(submission_base + params.sq_off.head);
+	submission_tail = reinterpret_cast<unsigned*>(submission_base + params.sq_off.tail);
+	submission_mask = reinterpret_cast<unsigned*>(submission_base + params.sq_off.ring_mask);
+	submission_array = reinterpret_cast<unsigned*>(submission_base + params.sq_off.array);
+
+	uint8_t* completion_base = static_cast<uint8_t*>(completion_ring);
+	completion_head = reinterpret_cast<unsigned*>(completion_base + params.cq_off.head);
+	completion_tail = reinterpret_cast<unsigned*>(completion_base + params.cq_off.tail);
+	completion_mask = reinterpret_cast<unsigned*>(completion_base + params.cq_off.ring_mask);
+	completion_entries = reinterpret_cast<io_uring_cqe*>(completion_base + params.cq_off.cqes);
+
+	local_submission_tail = *submission_tail;
+
+	// Register every send slot's buffer once.
+	iovec buffers[IO_URING_SEND_DEPTH];
+	for (int i = 0; i < IO_URING_SEND_DEPTH; i++)
+		buffers[i] = { send_slots[i].datagram.data, MAX_DATAGRAM_LENGTH };
+
+	if (syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_BUFFERS, buffers, IO_URING_SEND_DEPTH) < 0) {
+		last_error = errno;
+		close_ring();
+		return false;
+	}
+
+	// Zero copy sends with a destination address are 6.0 and up, ask the kernel whether it has them.
+	std::vector<uint8_t> probe_buffer(sizeof(io_uring_probe) + 256 * sizeof(io_uring_probe_op), 0);
+	io_uring_probe* probe = reinterpret_cast<io_uring_probe*>(probe_buffer.data());
+	if (syscall(__NR_io_uring_register, ring_fd, IORING_REGISTER_PROBE, probe, 256) == 0)
+		has_send_zc = probe->last_op >= IORING_OP_SEND_ZC && (probe->ops[IORING_OP_SEND_ZC].flags & IO_URING_OP_SUPPORTED);
+
+	provide_receive_buffers(0, IO_URING_RECEIVE_BUFFERS);
+
+	// Only the size of the address matters, the kernel puts everything else in the buffer it picks.
+	memset(&receive_header, 0, sizeof(receive_header));
+	receive_header.msg_namelen = sizeof(SOCKADDR_IN);
+
+	for (int i = 0; i < IO_URING_SEND_DEPTH; i++) {
+		SendSlot& slot = send_slots[i];
+		slot.vector = { slot.datagram.data, MAX_DATAGRAM_LENGTH };
+		memset(&slot.header, 0, sizeof(slot.header));
+		slot.header.msg_iov = &slot.vector;
+		slot.header.msg_iovlen = 1;
+		slot.header.msg_name = &slot.datagram.address;
+		slot.header.msg_namelen = sizeof(slot.datagram.address);
+
+		free_sends[free_send_count++] = i;
+	}
+
+	// The kernel fails operations on a non-blocking socket with EAGAIN right away instead of waiting for it to become ready, so the socket blocks for as long as we have it. Nothing but us calls into it in the meantime.
+	int socket_flags = fcntl(sock, F_GETFL, 0);
+	if (socket_flags == -1 || fcntl(sock, F_SETFL, socket_flags & ~O_NONBLOCK) == -1) {
+		last_error = errno;
+		close_ring();
+		return false;
+	}
+
+	has_cleared_non_blocking = (socket_flags & O_NONBLOCK) != 0;
+
+	queue_receive();
+	return submit(0, 0);
+}
+
+// Cancels whatever is still in flight and waits for the kernel to be done with the slots before unmapping everything, as they're about to be freed along with us.
+void IoUringTransport::close_ring() {
+	if (ring_fd != -1 && submission_entries != nullptr && outstanding_operations > 0) {
+		is_closing = true;
+
+		io_uring_sqe* entry = get_submission_entry();
+		entry->opcode = IORING_OP_ASYNC_CANCEL;
+		entry->fd = sock;
+		entry->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+		entry->user_data = IO_URING_CANCEL_OPERATION << 32;
+
+		int waited_us = 0;
+		while (outstanding_operations > 0 && waited_us < IO_URING_CLOSE_TIMEOUT_US) {
+			submit(1, 1000);
+			reap_completions();
+			waited_us += 1000;
+		}
+	}
+
+	if (has_cleared_non_blocking) {
+		set_non_blocking(sock);
+		has_cleared_non_blocking = false;
+	}
+
+	if (submission_entries != nullptr)
+		munmap(submission_entries, submission_entries_size);
+	if (completion_ring != nullptr && completion_ring != submission_ring)
+		munmap(completion_ring, completion_ring_size);
+	if (submission_ring != nullptr)
+		munmap(submission_ring, submission_ring_size);
+	if (ring_fd != -1)
+		close(ring_fd);
+
+	submission_entries = nullptr;
+	completion_ring = submission_ring = nullptr;
+	ring_fd = -1;
+}
+
+// The entry only goes to the kernel with the next submit. There's always room, as the ring is as large as every receive and send we can have in flight put together.
+io_uring_sqe* IoUringTransport::get_submission_entry() {
+	unsigned index = local_submission_tail & *submission_mask;
+	local_submission_tail++;
+	pending_submissions++;
+
+	io_uring_sqe* entry = &submission_entries[index];
+	memset(entry, 0, sizeof(*entry));
+	submission_array[index] = index;
+
+	return entry;
+}
+
+// Hands every queued entry to the kernel, and waits up to timeout_us for at least min_complete completions.
+bool IoUringTransport::submit(unsigned min_complete, int timeout_us) {
+	if (pending_submissions == 0 && min_complete == 0)
+		return true;
+
+	__atomic_store_n(submission_tail, local_submission_tail, __ATOMIC_RELEASE);
+
+	unsigned flags = 0;
+	io_uring_getevents_arg wait_arg;
+	__kernel_timespec timeout;
+	void* arg = nullptr;
+	size_t arg_size = 0;
+
+	if (min_complete > 0) {
+		timeout.tv_sec = timeout_us / 1000000;
+		timeout.tv_nsec = static_cast<long long>(timeout_us % 1000000) * 1000;
+
+		memset(&wait_arg, 0, sizeof(wait_arg));
+		wait_arg.ts = reinterpret_cast<uint64_t>(&timeout);
+
+		flags = IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG;
+		arg = &wait_arg;
+		arg_size = sizeof(wait_arg);
+	}
+
+	syscall_count++;
+	long result = syscall(__NR_io_uring_enter, ring_fd, pending_submissions, min_complete, flags, arg, arg_size);
+	if (result < 0 && errno != ETIME && errno != EINTR) {
+		last_error = errno;
+		return false;
+	}
+
+	pending_submissions = 0;
+	return true;
+}
+
+// Keeps receiving into the buffer ring until it's cancelled, fails or runs out of buffers.
+void IoUringTransport::queue_receive() {
+	io_uring_sqe* entry = get_submission_entry();
+	entry->opcode = IORING_OP_RECVMSG;
+	entry->fd = sock;
+	entry->addr = reinterpret_cast<uint64_t>(&receive_header);
+	entry->len = 1;
+	entry->ioprio = IORING_RECV_MULTISHOT;
+	entry->flags = IOSQE_BUFFER_SELECT;
+	entry->buf_group = IO_URING_RECEIVE_BUFFER_GROUP;
+	entry->user_data = IO_URING_RECEIVE_OPERATION << 32;
+
+	is_receiving = true;
+	outstanding_operations++;
+}
+
+// Hands count buffers, starting with first_buffer, to the kernel to receive into.
+void IoUringTransport::provide_receive_buffers(uint16_t first_buffer, int count) {
+	io_uring_sqe* entry = get_submission_entry();
+	entry->opcode = IORING_OP_PROVIDE_BUFFERS;
+	entry->fd = count;
+	entry->addr = reinterpret_cast<uint64_t>(receive_buffers[first_buffer]);
+	entry->len = IO_URING_RECEIVE_BUFFER_SIZE;
+	entry->off = first_buffer;
+	entry->buf_group = IO_URING_RECEIVE_BUFFER_GROUP;
+	entry->user_data = IO_URING_PROVIDE_BUFFERS_OPERATION << 32;
+
+	outstanding_operations++;
+}
+
+// Goes through everything the kernel has finished since the last call. Received datagrams wait in ready_receives until receive hands them over, finished sends free up their slot.
+void IoUringTransport::reap_completions() {
+	unsigned head = *completion_head;
+	unsigned tail = __atomic_load_n(completion_tail, __ATOMIC_ACQUIRE);
+
+	for (; head != tail; head++) {
+		const io_uring_cqe& completion = completion_entries[head & *completion_mask];
+		uint64_t operation = completion.user_data >> 32;
+		int slot = static_cast<int>(completion.user_data & 0xFFFFFFFF);
+
+		if (operation == IO_URING_RECEIVE_OPERATION) {
+			if (!(completion.flags & IORING_CQE_F_MORE)) { // The kernel is done with the receive, it gets queued again by the next call to receive.
+				outstanding_operations--;
+				is_receiving = false;
+			}
+
+			if (is_closing)
+				continue;
+
+			if (completion.res >= 0 && (completion.flags & IORING_CQE_F_BUFFER)) {
+				ready_receives[(ready_receive_head + ready_receive_count) % IO_URING_RECEIVE_BUFFERS] = static_cast<uint16_t>(completion.flags >> IORING_CQE_BUFFER_SHIFT);
+				ready_receive_count++;
+			}
+			else if (completion.res < 0 && completion.res != -ENOBUFS && pending_error == 0) // Running out of buffers only means we're behind, the kernel gets them back as receive hands the datagrams over.
+				pending_error = -completion.res;
+		}
+		else if (operation == IO_URING_PROVIDE_BUFFERS_OPERATION)
+			outstanding_operations--;
+		else if (operation == IO_URING_SEND_OPERATION) {
+			if (completion.res < 0 && !(completion.flags & IORING_CQE_F_NOTIF))
+				last_error = -completion.res;
+
+			// Zero copy sends complete twice, the slot is only free once the kernel says it's done with the buffer.
+			if (!(completion.flags & IORING_CQE_F_MORE)) {
+				outstanding_operations--;
+				free_sends[free_send_count++] = slot;
+			}
+		}
+	}
+
+	__atomic_store_n(completion_head, head, __ATOMIC_RELEASE);
+}
+
+int IoUringTransport::receive(Datagram* datagrams, int capacity, int timeout_us) {
+	reap_completions();
+
+	if (ready_receive_count == 0 && !is_receiving && !is_closing)
+		queue_receive();
+
+	if (ready_receive_count == 0 && pending_error == 0 && timeout_us > 0) {
+		submit(1, timeout_us);
+		reap_completions();
+	}
+
+	if (ready_receive_count == 0) {
+		if (pending_error != 0) {
+			last_error = pending_error;
+			pending_error = 0;
+			submit(0, 0);
+			return SOCKET_ERROR;
+		}
+
+		submit(0, 0);
+		return 0;
+	}
+
+	int count = 0;
+	while (count < capacity && ready_receive_count > 0) {
+		uint16_t buffer = ready_receives[ready_receive_head];
+		ready_receive_head = (ready_receive_head + 1) % IO_URING_RECEIVE_BUFFERS;
+		ready_receive_count--;
+
+		// The header, then the sender's address in as much room as receive_header asked for, then the datagram.
+		const io_uring_recvmsg_out* header = reinterpret_cast<const io_uring_recvmsg_out*>(receive_buffers[buffer]);
+		const uint8_t* name = receive_buffers[buffer] + sizeof(io_uring_recvmsg_out);
+		const uint8_t* payload = name + receive_header.msg_namelen;
+
+		Datagram& datagram = datagrams[count];
+		memset(&datagram.address, 0, sizeof(datagram.address));
+		memcpy(&datagram.address, name, std::min<size_t>(header->namelen, sizeof(datagram.address)));
+		datagram.length = static_cast<int>(std::min<uint32_t>(header->payloadlen, MAX_DATAGRAM_LENGTH)); // Anything longer was cut off, like recvfrom would have.
+		memcpy(datagram.data, payload, datagram.length);
+		count++;
+
+		provide_receive_buffers(buffer, 1);
+	}
+
+	if (!is_receiving && !is_closing) // Ran out of buffers, the kernel has some again now.
+		queue_receive();
+
+	submit(0, 0);
+	return count;
+}
+
+bool IoUringTransport::send(const Datagram* datagrams, int count) {
+	bool has_sent_all = true;
+
+	for (int i = 0; i < count; i++) {
+		if (free_send_count == 0) { // Everything's still in flight, give the kernel a moment to get through some of it.
+			submit(1, 1000);
+			reap_completions();
+
+			if (free_send_count == 0) {
+				last_error = EWOULDBLOCK;
+				has_sent_all = false;
+				continue;
+			}
+		}
+
+		int slot = free_sends[--free_send_count];
+		SendSlot& send_slot = send_slots[slot];
+
+		memcpy(send_slot.datagram.data, datagrams[i].data, datagrams[i].length);
+		send_slot.datagram.length = datagrams[i].length;
+		send_slot.datagram.address = datagrams[i].address;
+
+		io_uring_sqe* entry = get_submission_entry();
+		entry->fd = sock;
+		entry->user_data = (IO_URING_SEND_OPERATION << 32) | static_cast<uint64_t>(slot);
+
+		if (has_send_zc) {
+			entry->opcode = IORING_OP_SEND_ZC;
+			entry->addr = reinterpret_cast<uint64_t>(send_slot.datagram.data);
+			entry->len = send_slot.datagram.length;
+			entry->ioprio = IORING_RECVSEND_FIXED_BUF;
+			entry->buf_index = slot;
+			entry->addr2 = reinterpret_cast<uint64_t>(&send_slot.datagram.address);
+			entry->addr_len = sizeof(send_slot.datagram.address);
+		}
+		else {
+			send_slot.vector.iov_len = send_slot.datagram.length;
+
+			entry->opcode = IORING_OP_SENDMSG;
+			entry->addr = reinterpret_cast<uint64_t>(&send_slot.header);
+			entry->len = 1;
+		}
+
+		outstanding_operations++;
+	}
+
+	if (!submit(0, 0))
+		has_sent_all = false;
+
+	return has_sent_all;
+}
+#endif
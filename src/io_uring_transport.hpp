@@ -0,0 +1,88 @@
+#pragma once
+
+#include "transport.hpp"
+
+#ifdef HAS_IO_URING
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+
+// How many datagrams can be waiting for us in the receive buffers. The kernel stops receiving into them (and the socket starts buffering instead) once they're all full.
+#define IO_URING_RECEIVE_BUFFERS 256
+#define IO_URING_RECEIVE_BUFFER_GROUP 0
+
+// What the kernel puts in a receive buffer: a header, the sender's address and the datagram itself.
+#define IO_URING_RECEIVE_BUFFER_SIZE (sizeof(io_uring_recvmsg_out) + sizeof(SOCKADDR_IN) + MAX_DATAGRAM_LENGTH)
+
+// How many sends can be in flight at once.
+#define IO_URING_SEND_DEPTH 64
+
+/*
+Receives and sends through an io_uring, so datagrams land in our buffers without a call per datagram, and sends go out without waiting for them to.
+Receiving is a single multishot IORING_OP_RECVMSG (kernel 6.0 and up) that keeps going for as long as the kernel has free buffers left out of the ones we provided it with IORING_OP_PROVIDE_BUFFERS.
+Only one receive is ever waiting on the socket, as every queued receive would be woken up by every datagram that comes in.
+Sends go out of slots that are registered with the ring once, as fixed buffers with IORING_OP_SEND_ZC where the kernel has it (IORING_OP_SENDMSG otherwise).
+Talks to the kernel through the raw syscalls, so it doesn't need liburing. Puts the socket into blocking mode while it's open, the ring is what keeps it from blocking us.
+*/
+class IoUringTransport : public Transport {
+	private:
+		struct SendSlot {
+			Datagram datagram;
+			msghdr header;
+			iovec vector;
+		};
+
+		int ring_fd = -1;
+		SOCKET sock = INVALID_SOCKET;
+
+		void* submission_ring = nullptr;
+		size_t submission_ring_size = 0;
+		void* completion_ring = nullptr;
+		size_t completion_ring_size = 0;
+		io_uring_sqe* submission_entries = nullptr;
+		size_t submission_entries_size = 0;
+
+		unsigned* submission_head = nullptr;
+		unsigned* submission_tail = nullptr;
+		unsigned* submission_mask = nullptr;
+		unsigned* submission_array = nullptr;
+		unsigned* completion_head = nullptr;
+		unsigned* completion_tail = nullptr;
+		unsigned* completion_mask = nullptr;
+		io_uring_cqe* completion_entries = nullptr;
+
+		unsigned local_submission_tail = 0; // Entries up to here are filled in, the kernel gets to see them on the next submit.
+		unsigned pending_submissions = 0;
+		int outstanding_operations = 0; // Everything we queued that the kernel hasn't finished with yet.
+		bool has_send_zc = false;
+		bool is_closing = false;
+		bool has_cleared_non_blocking = false;
+
+		// The kernel picks a free one of these for every datagram it receives, and we hand it back once the datagram is copied out.
+		uint8_t receive_buffers[IO_URING_RECEIVE_BUFFERS][IO_URING_RECEIVE_BUFFER_SIZE];
+		msghdr receive_header;
+		bool is_receiving = false; // Whether the multishot receive is still queued. The kernel ends it when it runs out of buffers.
+
+		// Receive buffers that have a datagram in them that hasn't been handed over yet, in the order they came in.
+		uint16_t ready_receives[IO_URING_RECEIVE_BUFFERS];
+		int ready_receive_head = 0;
+		int ready_receive_count = 0;
+
+		SendSlot send_slots[IO_URING_SEND_DEPTH];
+		int free_sends[IO_URING_SEND_DEPTH];
+		int free_send_count = 0;
+
+		io_uring_sqe* get_submission_entry();
+		bool submit(unsigned min_complete, int timeout_us);
+		void queue_receive();
+		void provide_receive_buffers(uint16_t first_buffer, int count);
+		void reap_completions();
+		void close_ring();
+	public:
+		~IoUringTransport();
+		bool open(SOCKET sock_param) override;
+		int receive(Datagram* datagrams, int capacity, int timeout_us) override;
+		bool send(const Datagram* datagrams, int count) override;
+};
+#endif
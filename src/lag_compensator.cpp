@@ -0,0 +1,120 @@
+#include "lag_compensator.hpp"
+
+void LagCompensator::reset(const MatchState& match) {
+	*this = LagCompensator();
+	client_paddle = match.player_2;
+	states[match.tick % LAG_COMPENSATION_HISTORY_SIZE] = match;
+}
+
+// Called right after every step, with the inputs the match was just stepped with, and player 1's AI if it picked player 1's.
+void LagCompensator::record_step(const MatchInputs& step_inputs, const MatchState& stepped_match, const PaddleAi* player_1_ai) {
+	inputs[(stepped_match.tick - 1) % LAG_COMPENSATION_HISTORY_SIZE] = step_inputs;
+	if (player_1_ai)
+		player_1_ais[(stepped_match.tick - 1) % LAG_COMPENSATION_HISTORY_SIZE] = *player_1_ai;
+	states[stepped_match.tick % LAG_COMPENSATION_HISTORY_SIZE] = stepped_match;
+
+	if (stepped_match.events & (MATCH_EVENT_PLAYER_1_SCORED | MATCH_EVENT_PLAYER_2_SCORED)) {
+		has_unconfirmed_score = true;
+		unconfirmed_score_tick = stepped_match.tick;
+	}
+
+	if (!has_unconfirmed_score)
+		client_paddle = stepped_match.player_2;
+}
+
+// Moves the client's paddle with every input in the message that's newer than last_processed_input, oldest first, checking after each one if it hit the ball the client was looking at.
+// If the client is so far ahead that some of its inputs never made it into a message, those are skipped and its paddle gets corrected by the next snapshot.
+// Returns true if the match got rewound, rewind_event is then where the ball went off the client's paddle, for the client to replace everything it heard about the ball after that with.
+// player_1_ai has to be the same one that's passed to record_step, it's brought back up to the present with the match.
+bool LagCompensator::apply_client_inputs(MatchState& match, const InputMessage& message, uint16_t& last_processed_input, BallEventMessage& rewind_event, PaddleAi* player_1_ai) {
+	bool has_rewound = false;
+
+	for (int i = 0; i < message.input_count; i++) {
+		int age = message.input_count - 1 - i; // How many ticks before the newest input this one was made.
+		uint16_t sequence = advance_input_sequence(message.newest_sequence, -age);
+		if (!input_sequence_more_recent(sequence, last_processed_input)) // Already applied.
+			continue;
+
+		PaddleInput input = { (message.inputs[i] & FRAME_INPUT_UP) != 0, (message.inputs[i] & FRAME_INPUT_DOWN) != 0 };
+		move_paddle(match.player_2, input);
+		move_paddle(client_paddle, input);
+		last_processed_input = sequence;
+
+		// The client makes one input per tick while its view moves one tick along, so older inputs were made looking at older ticks.
+		if (message.view_tick >= static_cast<uint32_t>(age) && rewind_to_hit(match, message.view_tick - age, rewind_event, player_1_ai))
+			has_rewound = true;
+	}
+
+	return has_rewound;
+}
+
+bool LagCompensator::rewind_to_hit(MatchState& match, uint32_t view_tick, BallEventMessage& rewind_event, PaddleAi* player_1_ai) {
+	if (match.has_ended || view_tick >= match.tick || match.tick - view_tick > LAG_COMPENSATION_MAX_TICKS)
+		return false;
+
+	const MatchState& seen_match = states[view_tick % LAG_COMPENSATION_HISTORY_SIZE];
+	if (seen_match.tick != view_tick || seen_match.ball_velocity_x <= 0) // Not in the history anymore, or the ball wasn't even coming towards the client.
+		return false;
+
+	// Nothing to give back if the server saw the client hit the ball anyway, just a bit later.
+	for (uint32_t tick = view_tick + 1; tick <= match.tick; tick++) {
+		if (states[tick % LAG_COMPENSATION_HISTORY_SIZE].events & MATCH_EVENT_PLAYER_2_HIT)
+			return false;
+	}
+
+	MatchState rewound_match = seen_match;
+	rewound_match.player_2 = client_paddle;
+	rewound_match = step(rewound_match, inputs[view_tick % LAG_COMPENSATION_HISTORY_SIZE]);
+	if (!(rewound_match.events & MATCH_EVENT_PLAYER_2_HIT))
+		return false;
+
+	rewind_event = make_ball_event(rewound_match, BallEventType::REWIND);
+
+	if (has_unconfirmed_score && unconfirmed_score_tick > view_tick) // Whatever got past the client's paddle never happened.
+		has_unconfirmed_score = false;
+
+	// Step back up to the present. The client's paddle stays where it hit the ball, its inputs since then are already in there.
+	// The AI picked the input for the tick the client was looking at before anything changed, so it carries on from there.
+	PaddleAi rewound_ai;
+	if (player_1_ai)
+		rewound_ai = player_1_ais[view_tick % LAG_COMPENSATION_HISTORY_SIZE];
+
+	for (uint32_t tick = view_tick + 1; tick < match.tick; tick++) {
+		states[tick % LAG_COMPENSATION_HISTORY_SIZE] = rewound_match;
+
+		MatchInputs& tick_inputs = inputs[tick % LAG_COMPENSATION_HISTORY_SIZE];
+		if (player_1_ai) {
+			tick_inputs.player_1 = rewound_ai.get_input(rewound_match);
+			player_1_ais[tick % LAG_COMPENSATION_HISTORY_SIZE] = rewound_ai;
+		}
+
+		rewound_match = step(rewound_match, tick_inputs);
+
+		if (rewound_match.events & (MATCH_EVENT_PLAYER_1_SCORED | MATCH_EVENT_PLAYER_2_SCORED)) {
+			has_unconfirmed_score = true;
+			unconfirmed_score_tick = rewound_match.tick;
+		}
+	}
+
+	states[match.tick % LAG_COMPENSATION_HISTORY_SIZE] = rewound_match;
+
+	rewind_count++;
+	max_rewind_ticks = std::max(max_rewind_ticks, match.tick - view_tick);
+
+	match = rewound_match;
+	if (player_1_ai)
+		*player_1_ai = rewound_ai;
+
+	return true;
+}
+
+// Once the latest score is too old to be rewound, or the match is over, returns the match as it was right after it for the caller to let the client know.
+bool LagCompensator::pop_confirmed_score(const MatchState& match, MatchState& scored_match) {
+	if (!has_unconfirmed_score || (!match.has_ended && match.tick - unconfirmed_score_tick < LAG_COMPENSATION_MAX_TICKS))
+		return false;
+
+	scored_match = states[unconfirmed_score_tick % LAG_COMPENSATION_HISTORY_SIZE];
+	has_unconfirmed_score = false;
+	client_paddle = match.player_2;
+	return true;
+}
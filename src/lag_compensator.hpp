@@ -0,0 +1,48 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include "protocol.hpp"
+#include "match_simulation.hpp"
+#include "paddle_ai.hpp"
+
+// How far back the server is willing to rewind the match to give the client a hit it saw on its screen, about 300 ms worth.
+// That covers the client's interpolation delay plus a decent ping. Anyone further behind than this plays against what the server sees, like before.
+#define LAG_COMPENSATION_MAX_TICKS 18
+
+// States are kept around for this many ticks, has to be more than LAG_COMPENSATION_MAX_TICKS.
+#define LAG_COMPENSATION_HISTORY_SIZE 32
+
+static_assert(LAG_COMPENSATION_MAX_TICKS < LAG_COMPENSATION_HISTORY_SIZE, "LAG_COMPENSATION_HISTORY_SIZE is too small to rewind LAG_COMPENSATION_MAX_TICKS.");
+
+/*
+Server side lag compensation for the client's paddle.
+The client moves its paddle right away, but sees the ball where the server had it view_tick ticks ago. By the time its inputs get to the server the ball has moved on, so a ball it clearly hit on its screen can fly right past its paddle on the server.
+Every state the server steps is kept for a few ticks. When an input comes in, the step after the tick the client was looking at gets stepped again with the paddle where that input put it, and if that's a hit the server missed, the match is rewound to it and stepped back up to the present.
+Scores can be taken back by a rewind, so they're only final (and sent to the client) once they're further back than the server would ever rewind. The end of the match is final right away though, there's nothing to step up to after it.
+Until then, the client's paddle doesn't go back to the middle with the rest of the match either, as far as hits and snapshots are concerned. The client hasn't heard about the score yet, so that's not where it sees its paddle.
+Doesn't know about sockets or SDL, Game and MatchServer feed it every step and every input message from the client.
+*/
+class LagCompensator {
+	private:
+		MatchState states[LAG_COMPENSATION_HISTORY_SIZE]; // The match at the end of each tick, indexed by tick.
+		MatchInputs inputs[LAG_COMPENSATION_HISTORY_SIZE]; // What the match was stepped with after each tick.
+		PaddleAi player_1_ais[LAG_COMPENSATION_HISTORY_SIZE]; // Player 1's AI right after it picked each tick's input, if player 1 is an AI. Its inputs then get worked out again after a rewind instead of replayed.
+		MatchRect client_paddle; // Player 2's paddle as the client has it, the same as the match's unless a score that isn't final yet put that one back in the middle.
+
+		bool has_unconfirmed_score = false;
+		uint32_t unconfirmed_score_tick = 0;
+
+		bool rewind_to_hit(MatchState& match, uint32_t view_tick, BallEventMessage& rewind_event, PaddleAi* player_1_ai);
+	public:
+		// How the rewinds went so far, for logging.
+		uint32_t rewind_count = 0;
+		uint32_t max_rewind_ticks = 0;
+
+		void reset(const MatchState& match);
+		void record_step(const MatchInputs& step_inputs, const MatchState& stepped_match, const PaddleAi* player_1_ai = nullptr);
+		bool apply_client_inputs(MatchState& match, const InputMessage& message, uint16_t& last_processed_input, BallEventMessage& rewind_event, PaddleAi* player_1_ai = nullptr);
+		bool pop_confirmed_score(const MatchState& match, MatchState& scored_match);
+
+		const MatchRect& get_client_paddle() const { return client_paddle; }
+};
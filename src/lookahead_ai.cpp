@@ -0,0 +1,281 @@
+#include "lookahead_ai.hpp"
+
+// How a plan counts if the ball doesn't come back off of the paddle a second time, on top of how far off the middle of the paddle it took the first one.
+// All of them are more than a paddle is high, so the first ball alone never makes up for them.
+#define LOOKAHEAD_TIMED_OUT_PENALTY to_fixed(MATCH_HEIGHT)
+#define LOOKAHEAD_UNTRIED_PENALTY (2 * to_fixed(MATCH_HEIGHT))
+#define LOOKAHEAD_MISSED_PENALTY (3 * to_fixed(MATCH_HEIGHT))
+
+enum class RolloutResult {
+	RETURNED,
+	MISSED,
+	WON,
+	TIMED_OUT
+};
+
+static const MatchRect& get_paddle(const MatchState& state, int player) {
+	return (player == 1) ? state.player_1 : state.player_2;
+}
+
+static MatchRect& get_paddle(MatchState& state, int player) {
+	return (player == 1) ? state.player_1 : state.player_2;
+}
+
+// 0, step, -step, 2 * step, -2 * step and so on, in fixed-point. Candidates closest to what's predicted go first.
+static int get_candidate_offset(int index, int step_pixels) {
+	int distance = to_fixed(((index + 1) / 2) * step_pixels);
+	return (index % 2 == 1) ? distance : -distance;
+}
+
+// How far the middle of the paddle is from the middle of the ball.
+static int get_hit_offset(const MatchState& state, int player) {
+	const MatchRect& paddle = get_paddle(state, player);
+	return std::abs(paddle.y + paddle.h / 2 - (state.ball.y + state.ball.h / 2));
+}
+
+// The other side is played by a wall that's always centered on the ball, like practice mode. Whoever returns the ball, it comes back the same way, so all this leaves out is the points the other side loses.
+static MatchState step_rollout(const MatchState& state, const PaddleInput& input, int player) {
+	MatchState next = state;
+	MatchRect& opponent = get_paddle(next, 3 - player);
+	opponent.y = next.ball.y + next.ball.h / 2 - opponent.h / 2;
+
+	MatchInputs inputs;
+	if (player == 1)
+		inputs.player_1 = input;
+	else
+		inputs.player_2 = input;
+
+	return step(next, inputs);
+}
+
+// Plays the plan out until the ball comes off of the player's paddle going back the other way, or gets past it. end_state is the match right after that.
+static RolloutResult roll_out(const MatchState& state, const LookaheadPlan& plan, int player, MatchState& end_state) {
+	int hit_flag = (player == 1) ? MATCH_EVENT_PLAYER_1_HIT : MATCH_EVENT_PLAYER_2_HIT;
+	int missed_flag = (player == 1) ? MATCH_EVENT_PLAYER_2_SCORED : MATCH_EVENT_PLAYER_1_SCORED;
+	int won_flag = (player == 1) ? MATCH_EVENT_PLAYER_1_SCORED : MATCH_EVENT_PLAYER_2_SCORED;
+
+	end_state = state;
+	for (int i = 0; i < LOOKAHEAD_HORIZON_TICKS; i++) {
+		end_state = step_rollout(end_state, get_plan_input(plan, end_state, player), player);
+
+		if (end_state.events & missed_flag)
+			return RolloutResult::MISSED;
+		if (end_state.events & won_flag)
+			return RolloutResult::WON;
+		if ((end_state.events & hit_flag) && !is_ball_heading_for(end_state, player)) // Clipping the top or bottom of the paddle doesn't send it back.
+			return RolloutResult::RETURNED;
+	}
+
+	return RolloutResult::TIMED_OUT;
+}
+
+// Where the middle of the ball crosses the front of the player's paddle the next time. If it's going the other way, the match is played out with the paddle out of the way until it comes back.
+static bool find_next_crossing_y(const MatchState& state, int player, int& crossing_y) {
+	MatchState rollout = state;
+	get_paddle(rollout, player).y = -to_fixed(MATCH_HEIGHT);
+
+	for (int i = 0; i < LOOKAHEAD_HORIZON_TICKS && !is_ball_heading_for(rollout, player); i++) {
+		rollout = step_rollout(rollout, PaddleInput(), player);
+
+		if (rollout.events & (MATCH_EVENT_PLAYER_1_SCORED | MATCH_EVENT_PLAYER_2_SCORED))
+			return false;
+	}
+
+	if (!is_ball_heading_for(rollout, player))
+		return false;
+
+	crossing_y = predict_ball_crossing_y(rollout, player);
+	return true;
+}
+
+// Same as PaddleAi at full speed, heads for intercept_y until hit_tick and for wait_y after.
+PaddleInput get_plan_input(const LookaheadPlan& plan, const MatchState& state, int player) {
+	const MatchRect& paddle = get_paddle(state, player);
+	int target_y = (state.tick < plan.hit_tick) ? plan.intercept_y : plan.wait_y;
+	int distance = target_y - (paddle.y + paddle.h / 2);
+
+	PaddleInput input;
+	if (distance > to_fixed(MATCH_PADDLE_SPEED) / 2)
+		input.down = true;
+	else if (distance < -to_fixed(MATCH_PADDLE_SPEED) / 2)
+		input.up = true;
+
+	return input;
+}
+
+/*
+Picks where on the paddle to take the next ball and where to wait for the one after it, by playing every candidate out with step().
+In these rules a ball always goes back along the mirror image of the way it came in, whatever part of the paddle it hits, so there's no aiming it somewhere the other side can't reach.
+What's left is not getting caught out: the best plan takes both balls as close to the middle of the paddle as it can, and when it can't get there in time, takes the ball with the edge instead of missing it trying.
+Candidates closest to the predictions go first, and the search stops once the candidates left can't take the first ball any closer to the middle than the best plan takes both, or once the budget runs out.
+*/
+LookaheadPlan search_lookahead_plan(const MatchState& state, int player, double budget_ms) {
+	auto deadline = std::chrono::steady_clock::now() + std::chrono::duration<double, std::milli>(budget_ms);
+
+	LookaheadPlan best;
+	best.tick = state.tick;
+
+	int crossing_y = 0;
+	if (state.has_ended || !find_next_crossing_y(state, player, crossing_y)) {
+		best.is_complete = true;
+		return best;
+	}
+
+	best.intercept_y = crossing_y;
+
+	// Any further off than this and the ball misses the paddle.
+	const MatchRect& paddle = get_paddle(state, player);
+	int max_offset = (paddle.h + state.ball.h) / 2 - FIXED_ONE;
+	int offset_count = 2 * (max_offset / to_fixed(LOOKAHEAD_OFFSET_STEP)) + 1;
+	int wait_count = 2 * (MATCH_HEIGHT / LOOKAHEAD_WAIT_STEP) + 1;
+
+	uint32_t plans_evaluated = 0;
+	bool is_complete = true;
+	for (int i = 0; i < offset_count && is_complete; i++) {
+		int offset = get_candidate_offset(i, LOOKAHEAD_OFFSET_STEP);
+		if (best.score >= -std::abs(offset))
+			break;
+
+		if (std::chrono::steady_clock::now() >= deadline) {
+			is_complete = false;
+			break;
+		}
+
+		LookaheadPlan candidate;
+		candidate.tick = state.tick;
+		candidate.intercept_y = crossing_y + offset;
+
+		MatchState hit_state;
+		RolloutResult result = roll_out(state, candidate, player, hit_state);
+		plans_evaluated++;
+
+		if (result == RolloutResult::WON) { // Can't do any better than that.
+			candidate.score = INT_MAX;
+			best = candidate;
+			break;
+		}
+
+		if (result != RolloutResult::RETURNED)
+			continue;
+
+		candidate.hit_tick = hit_state.tick;
+		int first_offset = get_hit_offset(hit_state, player);
+
+		int next_crossing_y = 0;
+		if (!find_next_crossing_y(hit_state, player, next_crossing_y)) { // The other side can't get it back in time, nothing to wait for.
+			candidate.score = -first_offset;
+			if (candidate.score > best.score)
+				best = candidate;
+
+			continue;
+		}
+
+		// Taking the first ball like this is worth something even if the budget runs out before anything after it is tried.
+		candidate.wait_y = next_crossing_y;
+		candidate.score = -first_offset - LOOKAHEAD_UNTRIED_PENALTY;
+		if (candidate.score > best.score)
+			best = candidate;
+
+		for (int j = 0; j < wait_count; j++) {
+			if (std::chrono::steady_clock::now() >= deadline) {
+				is_complete = false;
+				break;
+			}
+
+			candidate.wait_y = std::clamp(next_crossing_y + get_candidate_offset(j, LOOKAHEAD_WAIT_STEP), paddle.h / 2, to_fixed(MATCH_HEIGHT) - paddle.h / 2);
+
+			MatchState second_hit_state;
+			RolloutResult second_result = roll_out(hit_state, candidate, player, second_hit_state);
+			plans_evaluated++;
+
+			int second_offset = get_hit_offset(second_hit_state, player);
+			switch (second_result) {
+				case RolloutResult::RETURNED:
+					candidate.score = -first_offset - second_offset;
+					break;
+				case RolloutResult::WON:
+					candidate.score = -first_offset;
+					break;
+				case RolloutResult::TIMED_OUT:
+					candidate.score = -first_offset - LOOKAHEAD_TIMED_OUT_PENALTY;
+					break;
+				default:
+					candidate.score = -first_offset - LOOKAHEAD_MISSED_PENALTY;
+					break;
+			}
+
+			if (candidate.score > best.score)
+				best = candidate;
+
+			// Waiting anywhere else can't take the second ball any closer to the middle.
+			if (second_result == RolloutResult::RETURNED && second_offset <= to_fixed(MATCH_PADDLE_SPEED) / 2)
+				break;
+		}
+	}
+
+	best.plans_evaluated = plans_evaluated;
+	best.is_complete = is_complete;
+	return best;
+}
+
+LookaheadAi::LookaheadAi(int player_param, uint32_t seed) {
+	player = player_param;
+	fallback.init(get_ai_settings(AiDifficulty::EXPERT), player, seed);
+
+	is_running = true;
+	thread = std::thread(&LookaheadAi::run, this);
+}
+
+LookaheadAi::~LookaheadAi() {
+	is_running = false;
+
+	if (thread.joinable())
+		thread.join();
+}
+
+void LookaheadAi::run() {
+	while (is_running) {
+		// Only the newest state is worth planning from, anything older is already in the past.
+		MatchState state;
+		bool has_state = false;
+		while (state_queue.pop(state))
+			has_state = true;
+
+		if (!has_state) {
+			std::this_thread::sleep_for(std::chrono::microseconds(LOOKAHEAD_IDLE_US));
+			continue;
+		}
+
+		plan_queue.push(search_lookahead_plan(state, player, LOOKAHEAD_BUDGET_MS)); // If the game hasn't picked up the last LOOKAHEAD_QUEUE_SIZE plans, it won't miss this one either.
+	}
+}
+
+// Called once per tick from the game's thread, never waits on the search.
+PaddleInput LookaheadAi::get_input(const MatchState& state) {
+	PaddleInput fallback_input = fallback.get_input(state); // Fed every tick either way, so it's ready to take over.
+
+	if (state.events & (MATCH_EVENT_PLAYER_1_SCORED | MATCH_EVENT_PLAYER_2_SCORED)) {
+		has_plan = false;
+		first_valid_tick = state.tick;
+	}
+
+	state_queue.push(state); // Only fails if the search thread hasn't run for LOOKAHEAD_QUEUE_SIZE ticks, and then the fallback takes over soon anyway.
+
+	LookaheadPlan newest_plan;
+	while (plan_queue.pop(newest_plan)) {
+		plan_count++;
+		plans_evaluated += newest_plan.plans_evaluated;
+
+		if (newest_plan.tick >= first_valid_tick) {
+			plan = newest_plan;
+			has_plan = true;
+		}
+	}
+
+	if (!has_plan || state.tick - plan.tick > LOOKAHEAD_MAX_PLAN_AGE_TICKS) {
+		fallback_tick_count++;
+		return fallback_input;
+	}
+
+	return get_plan_input(plan, state, player);
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cstdint>
+#include <climits>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include "match_simulation.hpp"
+#include "paddle_ai.hpp"
+#include "spsc_queue.hpp"
+
+// How long the search gets for each state it's handed, out of the SIMULATION_STEP_MS every frame has. It stops wherever it got to and publishes the best plan so far.
+#define LOOKAHEAD_BUDGET_MS 4.0
+
+// A rollout gives up after this many ticks, 10 seconds of play.
+#define LOOKAHEAD_HORIZON_TICKS 600
+
+// Candidate plans are spaced this many pixels apart, both for where on the paddle to take the ball and for where to wait for the next one.
+#define LOOKAHEAD_OFFSET_STEP 10
+#define LOOKAHEAD_WAIT_STEP 20
+
+// The AI goes back to reacting like PaddleAi if it hasn't had a plan for this many ticks, which means the search thread is starved for CPU.
+#define LOOKAHEAD_MAX_PLAN_AGE_TICKS 30
+
+// States going to the search thread and plans coming back. Both sides only ever care about the newest one, so these just have to cover a hiccup.
+#define LOOKAHEAD_QUEUE_SIZE 8
+
+// How long the search thread sleeps when it has no new state to plan from.
+#define LOOKAHEAD_IDLE_US 500
+
+// What the paddle does from a given tick on: head for intercept_y until the ball gets to it at hit_tick, then for wait_y until the ball comes back. Both are where the middle of the paddle goes, in fixed-point.
+struct LookaheadPlan {
+	uint32_t tick = 0; // The tick of the state it was planned from.
+	uint32_t hit_tick = UINT32_MAX;
+	int intercept_y = to_fixed(MATCH_HEIGHT / 2);
+	int wait_y = to_fixed(MATCH_HEIGHT / 2);
+
+	int score = INT_MIN; // Higher is better, see search_lookahead_plan.
+	uint32_t plans_evaluated = 0; // How many rollouts it took to pick this one.
+	bool is_complete = false; // False if the budget ran out before every candidate was tried.
+};
+
+LookaheadPlan search_lookahead_plan(const MatchState& state, int player, double budget_ms);
+PaddleInput get_plan_input(const LookaheadPlan& plan, const MatchState& state, int player);
+
+/*
+An AI that plans ahead by playing the match out with step() on a thread of its own, for single player.
+Every tick the game hands it the match and picks up the newest plan it came up with, so the game never waits on the search. Both go through SpscQueues, nothing is locked.
+A plan is only a few ticks stale by the time it's followed, and the ball's path doesn't change in between unless someone scores, so that's when plans from before get thrown away.
+Until the first plan comes in (or if plans stop coming), it plays like a hard PaddleAi.
+Not deterministic, as what it does depends on how far the search got in time. Nothing that has to replay a match can use it.
+*/
+class LookaheadAi {
+	private:
+		std::thread thread;
+		std::atomic<bool> is_running{ false };
+		int player = 2;
+
+		SpscQueue<MatchState, LOOKAHEAD_QUEUE_SIZE> state_queue; // The game's thread to the search thread.
+		SpscQueue<LookaheadPlan, LOOKAHEAD_QUEUE_SIZE> plan_queue; // And back.
+
+		// Only touched by the game's thread.
+		LookaheadPlan plan;
+		bool has_plan = false;
+		uint32_t first_valid_tick = 0; // Plans from before this tick are for a ball that's gone.
+		PaddleAi fallback;
+
+		void run();
+	public:
+		// How the search went so far, only touched by the game's thread.
+		uint32_t plan_count = 0;
+		uint64_t plans_evaluated = 0;
+		uint32_t fallback_tick_count = 0;
+
+		LookaheadAi(int player_param, uint32_t seed);
+		~LookaheadAi();
+		PaddleInput get_input(const MatchState& state);
+};
@@ -0,0 +1,62 @@
+#include "lookahead_benchmark.hpp"
+
+// "dingdong --lookahead-bench [ticks]" has the expert AI play player 2 against a hard PaddleAi for that many ticks, searching on every tick right here instead of on its own thread, and reports how fast the search is.
+// A search that runs out of budget is cut short, so what matters is how many plans fit into a millisecond and how many searches got through all of their candidates.
+int run_lookahead_benchmark(int argc, char* argv[]) {
+	int tick_count = (argc > 2) ? std::atoi(argv[2]) : LOOKAHEAD_BENCHMARK_DEFAULT_TICKS;
+
+	std::cout << "Running the lookahead AI against the hard AI for " << tick_count << " ticks, " << LOOKAHEAD_BUDGET_MS << " ms per search." << "\n";
+
+	uint64_t plans_evaluated = 0;
+	uint32_t search_count = 0;
+	uint32_t complete_count = 0;
+	double total_search_ms = 0.0;
+	double max_search_ms = 0.0;
+
+	uint32_t match_count = 0;
+	uint32_t lookahead_points = 0;
+	uint32_t hard_points = 0;
+
+	uint32_t seed = 1;
+	MatchState match = create_match(LOOKAHEAD_BENCHMARK_END_SCORE, seed);
+	PaddleAi hard_ai;
+	hard_ai.init(get_ai_settings(AiDifficulty::HARD), 1, seed);
+
+	for (int i = 0; i < tick_count; i++) {
+		if (match.has_ended || match.tick >= LOOKAHEAD_BENCHMARK_MAX_MATCH_TICKS) {
+			match_count++;
+			seed++;
+			match = create_match(LOOKAHEAD_BENCHMARK_END_SCORE, seed);
+			hard_ai.init(get_ai_settings(AiDifficulty::HARD), 1, seed);
+		}
+
+		auto search_start = std::chrono::steady_clock::now();
+		LookaheadPlan plan = search_lookahead_plan(match, 2, LOOKAHEAD_BUDGET_MS);
+		double search_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - search_start).count();
+
+		search_count++;
+		plans_evaluated += plan.plans_evaluated;
+		total_search_ms += search_ms;
+		max_search_ms = std::max(max_search_ms, search_ms);
+		if (plan.is_complete)
+			complete_count++;
+
+		MatchInputs inputs;
+		inputs.player_1 = hard_ai.get_input(match);
+		inputs.player_2 = get_plan_input(plan, match, 2);
+		match = step(match, inputs);
+
+		if (match.events & MATCH_EVENT_PLAYER_1_SCORED)
+			hard_points++;
+		if (match.events & MATCH_EVENT_PLAYER_2_SCORED)
+			lookahead_points++;
+	}
+
+	match_count++;
+
+	std::cout << "Plans evaluated: " << plans_evaluated << " in " << total_search_ms << " ms, " << plans_evaluated / std::max(total_search_ms, 0.001) << " per ms." << "\n";
+	std::cout << "Searches: " << search_count << ", " << total_search_ms / std::max(search_count, 1u) << " ms on average and " << max_search_ms << " ms at most, " << 100.0 * complete_count / std::max(search_count, 1u) << "% tried every candidate." << "\n";
+	std::cout << "Points over " << match_count << " matches: lookahead " << lookahead_points << ", hard " << hard_points << "." << "\n";
+
+	return 0;
+}
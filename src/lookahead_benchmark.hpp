@@ -0,0 +1,17 @@
+#pragma once
+
+#include <iostream>
+#include <cstdlib>
+#include <chrono>
+#include <algorithm>
+#include "lookahead_ai.hpp"
+
+// What "dingdong --lookahead-bench" runs with unless told otherwise.
+#define LOOKAHEAD_BENCHMARK_DEFAULT_TICKS 15000
+
+// Matches in the benchmark are cut short after this many ticks, two AIs that never miss could otherwise go on for a very long time.
+#define LOOKAHEAD_BENCHMARK_MAX_MATCH_TICKS 5000
+
+#define LOOKAHEAD_BENCHMARK_END_SCORE 5
+
+int run_lookahead_benchmark(int argc, char* argv[]);
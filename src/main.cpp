@@ -3,15 +3,29 @@
 #include "app.hpp"
 #include "ball.hpp"
 #include "connection_manager.hpp"
+#include "headless_modes.hpp"
 #include "paddle.hpp"
 #include "sdl_garbage_collector.hpp"
 #include "sprite.hpp"
 #include "text.hpp"
 
 int main(int argc, char* argv[]) {
+	// Anything that runs without a window, same as dingdong-headless.
+	int exit_code = 0;
+	if (run_headless_mode(argc, argv, exit_code))
+		return exit_code;
+
+	// "dingdong --ai [difficulty]" picks the AI single player is played against, easy, normal, hard or expert.
+	AiDifficulty ai_difficulty = DEFAULT_AI_DIFFICULTY;
+	if (argc > 2 && std::string(argv[1]) == "--ai" && !parse_ai_difficulty(argv[2], ai_difficulty)) {
+		std::cerr << "Unknown AI difficulty \"" << argv[2] << "\", expected easy, normal, hard or expert." << "\n";
+		return 1;
+	}
+
 	ShowWindow(GetConsoleWindow(), SW_HIDE); // Hides the console.
 
 	App dingdong;
+	dingdong.game.ai_difficulty = ai_difficulty;
 	dingdong.main_loop();
 
 	return 0;
@@ -24,6 +24,7 @@ MainMenu::MainMenu(int screen_width_param, int screen_height_param, SDL_Renderer
 	online_multiplayer_button = { 660, 440, "ONLINE MULTIPLAYER", "sprites/large_button_unhovered.png", "sprites/large_button_hovered.png", renderer_ptr.get(), show_multiplayer_options, 12 };
 	client_button = { 148, 330, "JOIN", "sprites/large_button_unhovered.png", "sprites/large_button_hovered.png", renderer_ptr.get(), get_ipaddr };
 	server_button = { 630, 330, "HOST", "sprites/large_button_unhovered.png", "sprites/large_button_hovered.png", renderer_ptr.get(), start_server };
+	rollback_server_button = { 630, 440, "HOST ROLLBACK", "sprites/large_button_unhovered.png", "sprites/large_button_hovered.png", renderer_ptr.get(), start_rollback_server, 13 };
 	back_to_main_menu_button = { 940, 740, "<-", "sprites/small_button_unhovered.png", "sprites/small_button_hovered.png", renderer_ptr.get(), init_main_menu, 15 };
 	textbox_ok_button = { (textbox.sprite.rect.x + textbox.sprite.rect.w / 2 - 25), (textbox.sprite.rect.y + textbox.sprite.rect.h) + 10, "OK", "sprites/small_button_unhovered.png", "sprites/small_button_hovered.png", renderer_ptr.get(), textbox_ok_button_func, 15 };
 	credits_inside_button = { 117, (screen_height / 2), " ", "sprites/credits_button_unhovered.png", "sprites/credits_button_unhovered.png", renderer_ptr.get(), open_ulasyt };
@@ -129,6 +130,12 @@ void MainMenu::start_server() {
 	push_event("main_menu", "get_end_score");
 }
 
+// Whoever joins plays by the rules of the host, so only hosting needs a button of its own.
+void MainMenu::start_rollback_server() {
+	game_mode_to_pass = "rollback_multiplayer_as_server";
+	push_event("main_menu", "get_end_score");
+}
+
 void MainMenu::toggle_sound() {
 	push_event("toggle_sound");
 }
@@ -139,4 +146,20 @@ void MainMenu::open_ulasyt() {
 
 void MainMenu::open_github_link() {
 	system("start https://github.com/emredesu/dingdong");
+}
+
+// Makes the city move in the main menu, one step at a time so it moves at the same speed no matter how fast we render.
+void MainMenu::scroll_city() {
+	current_frame_on_main_menu++;
+
+	city_front_current_rect.x++;
+	if (city_front_current_rect.x >= 3000)
+		city_front_current_rect.x = 0;
+
+	if (current_frame_on_main_menu % frames_to_city_back_swap == 0) {
+		city_back_current_rect.x++;
+
+		if (city_back_current_rect.x >= 3000)
+			city_back_current_rect.x = 0;
+	}
 }
\ No newline at end of file
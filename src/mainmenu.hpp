@@ -43,6 +43,7 @@ class MainMenu {
 		Button local_multiplayer_button;
 		Button online_multiplayer_button;
 		Button server_button;
+		Button rollback_server_button;
 		Button client_button;
 		Button credits_inside_button;
 		Button back_to_main_menu_button;
@@ -68,6 +69,7 @@ class MainMenu {
 		static void start_practice();
 		static void start_local_multiplayer();
 		static void start_server();
+		static void start_rollback_server();
 		static void start_client();
 		static void textbox_ok_button_func();
 		static void show_multiplayer_options();
@@ -78,6 +80,7 @@ class MainMenu {
 		static void init_main_menu();
 		static void open_ulasyt();
 		static void push_event(std::string data1, std::string data2 = "none");
+		void scroll_city();
 		MainMenu() {};
 		MainMenu(int screen_width_param, int screen_height_param, SDL_Renderer* renderer);
 };
\ No newline at end of file
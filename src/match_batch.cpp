@@ -0,0 +1,386 @@
+#include "match_batch.hpp"
+
+#include <bitset>
+
+#ifdef HAS_X86_SIMD
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+// GCC and Clang only let us use the instructions in functions that are marked for them, MSVC lets us use them anywhere.
+#if defined(__GNUC__)
+#define AVX2_TARGET __attribute__((target("avx2")))
+#define SSE41_TARGET __attribute__((target("sse4.1")))
+#else
+#define AVX2_TARGET
+#define SSE41_TARGET
+#endif
+#endif
+
+// Everything in the arrays is in fixed-point like in MatchState, so these are too.
+#define FIELD_WIDTH to_fixed(MATCH_WIDTH)
+#define FIELD_HEIGHT to_fixed(MATCH_HEIGHT)
+#define PADDLE_WIDTH to_fixed(MATCH_PADDLE_WIDTH)
+#define PADDLE_HEIGHT to_fixed(MATCH_PADDLE_HEIGHT)
+#define PADDLE_SPEED to_fixed(MATCH_PADDLE_SPEED)
+#define BALL_SIZE to_fixed(MATCH_BALL_SIZE)
+
+// Where the paddles' left sides are, they never move sideways.
+#define PLAYER_1_X to_fixed(MATCH_PADDLE_MARGIN)
+#define PLAYER_2_X to_fixed(MATCH_WIDTH - MATCH_PADDLE_WIDTH - MATCH_PADDLE_MARGIN)
+
+SimdLevel get_supported_simd_level() {
+#if defined(HAS_X86_SIMD) && defined(_MSC_VER)
+	int info[4];
+	__cpuid(info, 0);
+	int highest_leaf = info[0];
+
+	__cpuid(info, 1);
+	bool has_sse41 = (info[2] & (1 << 19)) != 0;
+	bool has_avx = (info[2] & (1 << 28)) != 0 && (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 6) == 6; // The OS has to save the YMM registers too.
+
+	bool has_avx2 = false;
+	if (highest_leaf >= 7) {
+		__cpuidex(info, 7, 0);
+		has_avx2 = has_avx && (info[1] & (1 << 5)) != 0;
+	}
+
+	if (has_avx2)
+		return SimdLevel::AVX2;
+	if (has_sse41)
+		return SimdLevel::SSE41;
+#elif defined(HAS_X86_SIMD)
+	__builtin_cpu_init();
+
+	if (__builtin_cpu_supports("avx2"))
+		return SimdLevel::AVX2;
+	if (__builtin_cpu_supports("sse4.1"))
+		return SimdLevel::SSE41;
+#endif
+	return SimdLevel::SCALAR;
+}
+
+const char* get_simd_level_name(SimdLevel level) {
+	switch (level) {
+		case SimdLevel::AVX2:
+			return "avx2";
+		case SimdLevel::SSE41:
+			return "sse4.1";
+		default:
+			return "scalar";
+	}
+}
+
+void MatchBatch::init(int match_count_param, int end_score_param, uint32_t seed) {
+	match_count = match_count_param;
+
+	for (std::vector<int32_t>* field : { &ball_x, &ball_y, &ball_velocity_x, &ball_velocity_y, &player_1_y, &player_2_y, &player_1_score, &player_2_score, &end_score, &ball_hit_count, &has_ended, &player_2_follows_ball, &ball_event, &events, &inputs })
+		field->assign(match_count, 0);
+
+	tick.assign(match_count, 0);
+	random_state.assign(match_count, 0);
+	fast_step_count = 0;
+
+	// Every match gets a seed of its own so they don't all play out the same.
+	for (int i = 0; i < match_count; i++)
+		set_match(i, create_match(end_score_param, seed + i));
+
+	simd_level = get_supported_simd_level();
+}
+
+// Only the positions, the sizes are always the MATCH_ ones.
+void MatchBatch::set_match(int index, const MatchState& state) {
+	ball_x[index] = state.ball.x;
+	ball_y[index] = state.ball.y;
+	ball_velocity_x[index] = state.ball_velocity_x;
+	ball_velocity_y[index] = state.ball_velocity_y;
+	player_1_y[index] = state.player_1.y;
+	player_2_y[index] = state.player_2.y;
+	player_1_score[index] = state.player_1_score;
+	player_2_score[index] = state.player_2_score;
+	end_score[index] = state.end_score;
+	ball_hit_count[index] = state.ball_hit_count;
+	tick[index] = state.tick;
+	random_state[index] = state.random_state;
+	has_ended[index] = state.has_ended ? 1 : 0;
+	player_2_follows_ball[index] = state.player_2_follows_ball ? 1 : 0;
+	ball_event[index] = state.has_ball_event ? static_cast<int32_t>(state.ball_event_type) : -1;
+	events[index] = state.events;
+}
+
+MatchState MatchBatch::get_match(int index) const {
+	MatchState state;
+	state.player_1 = { PLAYER_1_X, player_1_y[index], PADDLE_WIDTH, PADDLE_HEIGHT };
+	state.player_2 = { PLAYER_2_X, player_2_y[index], PADDLE_WIDTH, PADDLE_HEIGHT };
+	state.ball = { ball_x[index], ball_y[index], BALL_SIZE, BALL_SIZE };
+	state.ball_velocity_x = ball_velocity_x[index];
+	state.ball_velocity_y = ball_velocity_y[index];
+	state.player_1_score = player_1_score[index];
+	state.player_2_score = player_2_score[index];
+	state.end_score = end_score[index];
+	state.ball_hit_count = ball_hit_count[index];
+	state.tick = tick[index];
+	state.random_state = random_state[index];
+	state.has_ended = has_ended[index] != 0;
+	state.player_2_follows_ball = player_2_follows_ball[index] != 0;
+	state.has_ball_event = ball_event[index] >= 0;
+	state.ball_event_type = state.has_ball_event ? static_cast<BallEventType>(ball_event[index]) : BallEventType::CORRECTION;
+	state.events = static_cast<uint8_t>(events[index]);
+	return state;
+}
+
+void MatchBatch::set_inputs(int index, const MatchInputs& match_inputs) {
+	inputs[index] = (match_inputs.player_1.up ? MATCH_INPUT_PLAYER_1_UP : 0) | (match_inputs.player_1.down ? MATCH_INPUT_PLAYER_1_DOWN : 0) |
+		(match_inputs.player_2.up ? MATCH_INPUT_PLAYER_2_UP : 0) | (match_inputs.player_2.down ? MATCH_INPUT_PLAYER_2_DOWN : 0);
+}
+
+// Lets get_ai_input play both sides of every match. Written out over the arrays so the compiler can vectorize it on its own.
+void MatchBatch::set_ai_inputs() {
+	for (int i = 0; i < match_count; i++) {
+		int ball_middle = ball_y[i] + BALL_SIZE / 2;
+
+		int player_1_input = (ball_middle > player_1_y[i] + BALL_SIZE / 2) ? MATCH_INPUT_PLAYER_1_DOWN : ((ball_middle < player_1_y[i] + PADDLE_HEIGHT / 2) ? MATCH_INPUT_PLAYER_1_UP : 0);
+		int player_2_input = (ball_middle > player_2_y[i] + BALL_SIZE / 2) ? MATCH_INPUT_PLAYER_2_DOWN : ((ball_middle < player_2_y[i] + PADDLE_HEIGHT / 2) ? MATCH_INPUT_PLAYER_2_UP : 0);
+
+		inputs[i] = player_1_input | player_2_input;
+	}
+}
+
+void MatchBatch::step_scalar(int first_match, int last_match) {
+	for (int i = first_match; i < last_match; i++) {
+		MatchInputs match_inputs;
+		match_inputs.player_1 = { (inputs[i] & MATCH_INPUT_PLAYER_1_UP) != 0, (inputs[i] & MATCH_INPUT_PLAYER_1_DOWN) != 0 };
+		match_inputs.player_2 = { (inputs[i] & MATCH_INPUT_PLAYER_2_UP) != 0, (inputs[i] & MATCH_INPUT_PLAYER_2_DOWN) != 0 };
+
+		set_match(i, ::step(get_match(i), match_inputs));
+	}
+}
+
+#ifdef HAS_X86_SIMD
+/*
+The kernels below only do the part of step() that most steps are: the paddles move and the ball flies in a straight line, bouncing off of the top or bottom wall at most once.
+Every match where the ball might touch a paddle somewhere along the way, or score, or bounce more than once, or where player 2 follows the ball, is left alone and then goes through step() itself, which works out exactly where and when it hit.
+Paddle hits speed the ball up and scoring resets the match with the random number generator, so doing those in the kernels would mean most of step() in vector form for a few percent of the steps. --batch-bench shows how many steps still go through step().
+Every change is only applied where the fast path's mask is set, all ones or all zeroes per match. A match that has ended isn't touched at all, like step() does.
+*/
+
+// Same as note_ball_event in match_simulation.cpp, -1 is "nothing happened yet" so the most important event is just the biggest one.
+AVX2_TARGET static inline __m256i note_ball_event_avx2(__m256i ball_event_value, __m256i mask, BallEventType type) {
+	__m256i noted_event = _mm256_or_si256(_mm256_and_si256(mask, _mm256_set1_epi32(static_cast<int>(type))), _mm256_andnot_si256(mask, _mm256_set1_epi32(-1)));
+	return _mm256_max_epi32(ball_event_value, noted_event);
+}
+
+AVX2_TARGET static inline __m256i bits_where_avx2(__m256i mask, int bits) {
+	return _mm256_and_si256(mask, _mm256_set1_epi32(bits));
+}
+
+// Whether the box around everywhere the ball went this step touches the paddle, which is the only way it could have hit it. Touching counts, step() can bounce off of the very edge.
+AVX2_TARGET static inline __m256i may_hit_paddle_avx2(__m256i min_x, __m256i max_x, __m256i min_y, __m256i max_y, int paddle_x, __m256i paddle_y) {
+	__m256i mask = _mm256_cmpgt_epi32(_mm256_set1_epi32(paddle_x + PADDLE_WIDTH + 1), min_x);
+	mask = _mm256_and_si256(mask, _mm256_cmpgt_epi32(_mm256_add_epi32(max_x, _mm256_set1_epi32(BALL_SIZE + 1)), _mm256_set1_epi32(paddle_x)));
+	mask = _mm256_and_si256(mask, _mm256_cmpgt_epi32(_mm256_add_epi32(paddle_y, _mm256_set1_epi32(PADDLE_HEIGHT + 1)), min_y));
+	return _mm256_and_si256(mask, _mm256_cmpgt_epi32(_mm256_add_epi32(max_y, _mm256_set1_epi32(BALL_SIZE + 1)), paddle_y));
+}
+
+AVX2_TARGET static int step_avx2(MatchBatch& batch) {
+	const __m256i zero = _mm256_setzero_si256();
+	const __m256i one = _mm256_set1_epi32(1);
+	const __m256i paddle_speed = _mm256_set1_epi32(PADDLE_SPEED);
+	const __m256i paddle_y_limit = _mm256_set1_epi32(FIELD_HEIGHT - PADDLE_HEIGHT);
+	const __m256i bottom_wall = _mm256_set1_epi32(FIELD_HEIGHT - BALL_SIZE); // Where the ball's top is when it touches the bottom wall.
+
+	int vector_end = batch.size() - batch.size() % 8;
+	for (int i = 0; i < vector_end; i += 8) {
+		__m256i bx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&batch.ball_x[i]));
+		__m256i by = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&batch.ball_y[i]));
+		__m256i vx = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&batch.ball_velocity_x[i]));
+		__m256i vy = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&batch.ball_velocity_y[i]));
+		__m256i p1y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&batch.player_1_y[i]));
+		__m256i p2y = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&batch.player_2_y[i]));
+		__m256i ticks = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&batch.tick[i]));
+		__m256i ended = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&batch.has_ended[i]));
+		__m256i follows_ball = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&batch.player_2_follows_ball[i]));
+		__m256i input_flags = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(&batch.inputs[i]));
+
+		__m256i active = _mm256_cmpeq_epi32(ended, zero);
+
+		// Paddles, up first and then down like move_paddle.
+		__m256i mask = _mm256_cmpeq_epi32(bits_where_avx2(input_flags, MATCH_INPUT_PLAYER_1_UP), _mm256_set1_epi32(MATCH_INPUT_PLAYER_1_UP));
+		__m256i next_p1y = _mm256_sub_epi32(p1y, _mm256_and_si256(_mm256_and_si256(mask, _mm256_cmpgt_epi32(p1y, zero)), paddle_speed));
+		mask = _mm256_cmpeq_epi32(bits_where_avx2(input_flags, MATCH_INPUT_PLAYER_1_DOWN), _mm256_set1_epi32(MATCH_INPUT_PLAYER_1_DOWN));
+		next_p1y = _mm256_add_epi32(next_p1y, _mm256_and_si256(_mm256_and_si256(mask, _mm256_cmpgt_epi32(paddle_y_limit, next_p1y)), paddle_speed));
+		mask = _mm256_cmpeq_epi32(bits_where_avx2(input_flags, MATCH_INPUT_PLAYER_2_UP), _mm256_set1_epi32(MATCH_INPUT_PLAYER_2_UP));
+		__m256i next_p2y = _mm256_sub_epi32(p2y, _mm256_and_si256(_mm256_and_si256(mask, _mm256_cmpgt_epi32(p2y, zero)), paddle_speed));
+		mask = _mm256_cmpeq_epi32(bits_where_avx2(input_flags, MATCH_INPUT_PLAYER_2_DOWN), _mm256_set1_epi32(MATCH_INPUT_PLAYER_2_DOWN));
+		next_p2y = _mm256_add_epi32(next_p2y, _mm256_and_si256(_mm256_and_si256(mask, _mm256_cmpgt_epi32(paddle_y_limit, next_p2y)), paddle_speed));
+
+		__m256i next_bx = _mm256_add_epi32(bx, vx);
+		__m256i next_by = _mm256_add_epi32(by, vy);
+
+		// A ball that gets past the top or the bottom wall bounces off of it, the rest of the move mirrored back from the wall like move_ball does.
+		__m256i top_bounce = _mm256_cmpgt_epi32(zero, next_by);
+		__m256i bottom_bounce = _mm256_cmpgt_epi32(next_by, bottom_wall);
+		__m256i bounced = _mm256_or_si256(top_bounce, bottom_bounce);
+		__m256i bounced_by = _mm256_blendv_epi8(next_by, _mm256_sub_epi32(zero, next_by), top_bounce);
+		bounced_by = _mm256_blendv_epi8(bounced_by, _mm256_sub_epi32(_mm256_set1_epi32(2 * (FIELD_HEIGHT - BALL_SIZE)), next_by), bottom_bounce);
+		__m256i next_vy = _mm256_blendv_epi8(vy, _mm256_sub_epi32(zero, vy), bounced);
+
+		// The box around the line the ball would have gone on and where it ended up, which is a little bigger than where it actually went.
+		__m256i min_x = _mm256_min_epi32(bx, next_bx);
+		__m256i max_x = _mm256_max_epi32(bx, next_bx);
+		__m256i min_y = _mm256_min_epi32(_mm256_min_epi32(by, next_by), bounced_by);
+		__m256i max_y = _mm256_max_epi32(_mm256_max_epi32(by, next_by), bounced_by);
+
+		// Strictly between the walls at the end, which also rules out a second bounce, and strictly between the goal lines.
+		__m256i is_fast = _mm256_and_si256(active, _mm256_cmpeq_epi32(follows_ball, zero));
+		is_fast = _mm256_and_si256(is_fast, _mm256_cmpgt_epi32(bounced_by, zero));
+		is_fast = _mm256_and_si256(is_fast, _mm256_cmpgt_epi32(bottom_wall, bounced_by));
+		is_fast = _mm256_and_si256(is_fast, _mm256_cmpgt_epi32(next_bx, zero));
+		is_fast = _mm256_and_si256(is_fast, _mm256_cmpgt_epi32(_mm256_set1_epi32(FIELD_WIDTH - BALL_SIZE), next_bx));
+		is_fast = _mm256_andnot_si256(may_hit_paddle_avx2(min_x, max_x, min_y, max_y, PLAYER_1_X, next_p1y), is_fast);
+		is_fast = _mm256_andnot_si256(may_hit_paddle_avx2(min_x, max_x, min_y, max_y, PLAYER_2_X, next_p2y), is_fast);
+
+		__m256i next_ticks = _mm256_add_epi32(ticks, one);
+		__m256i ball_event_value = note_ball_event_avx2(_mm256_set1_epi32(-1), _mm256_cmpeq_epi32(next_ticks, one), BallEventType::SERVE);
+		ball_event_value = note_ball_event_avx2(ball_event_value, bounced, BallEventType::WALL_BOUNCE);
+		__m256i wall_events = _mm256_or_si256(bits_where_avx2(top_bounce, MATCH_EVENT_TOP_WALL_BOUNCE), bits_where_avx2(bottom_bounce, MATCH_EVENT_BOTTOM_WALL_BOUNCE));
+
+		// The scores and everything else stay as they are, the only events are the wall bounces.
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(&batch.ball_x[i]), _mm256_blendv_epi8(bx, next_bx, is_fast));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(&batch.ball_y[i]), _mm256_blendv_epi8(by, bounced_by, is_fast));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(&batch.ball_velocity_y[i]), _mm256_blendv_epi8(vy, next_vy, is_fast));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(&batch.player_1_y[i]), _mm256_blendv_epi8(p1y, next_p1y, is_fast));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(&batch.player_2_y[i]), _mm256_blendv_epi8(p2y, next_p2y, is_fast));
+		_mm256_storeu_si256(reinterpret_cast<__m256i*>(&batch.tick[i]), _mm256_blendv_epi8(ticks, next_ticks, is_fast));
+		_mm256_maskstore_epi32(&batch.ball_event[i], is_fast, ball_event_value);
+		_mm256_maskstore_epi32(&batch.events[i], is_fast, wall_events);
+
+		batch.fast_step_count += std::bitset<8>(_mm256_movemask_ps(_mm256_castsi256_ps(is_fast))).count();
+
+		int slow_matches = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_andnot_si256(is_fast, active)));
+		for (int lane = 0; lane < 8; lane++) {
+			if (slow_matches & (1 << lane))
+				batch.step_scalar(i + lane, i + lane + 1);
+		}
+	}
+
+	return vector_end;
+}
+
+SSE41_TARGET static inline __m128i note_ball_event_sse41(__m128i ball_event_value, __m128i mask, BallEventType type) {
+	__m128i noted_event = _mm_or_si128(_mm_and_si128(mask, _mm_set1_epi32(static_cast<int>(type))), _mm_andnot_si128(mask, _mm_set1_epi32(-1)));
+	return _mm_max_epi32(ball_event_value, noted_event);
+}
+
+SSE41_TARGET static inline __m128i bits_where_sse41(__m128i mask, int bits) {
+	return _mm_and_si128(mask, _mm_set1_epi32(bits));
+}
+
+SSE41_TARGET static inline __m128i may_hit_paddle_sse41(__m128i min_x, __m128i max_x, __m128i min_y, __m128i max_y, int paddle_x, __m128i paddle_y) {
+	__m128i mask = _mm_cmpgt_epi32(_mm_set1_epi32(paddle_x + PADDLE_WIDTH + 1), min_x);
+	mask = _mm_and_si128(mask, _mm_cmpgt_epi32(_mm_add_epi32(max_x, _mm_set1_epi32(BALL_SIZE + 1)), _mm_set1_epi32(paddle_x)));
+	mask = _mm_and_si128(mask, _mm_cmpgt_epi32(_mm_add_epi32(paddle_y, _mm_set1_epi32(PADDLE_HEIGHT + 1)), min_y));
+	return _mm_and_si128(mask, _mm_cmpgt_epi32(_mm_add_epi32(max_y, _mm_set1_epi32(BALL_SIZE + 1)), paddle_y));
+}
+
+SSE41_TARGET static int step_sse41(MatchBatch& batch) {
+	const __m128i zero = _mm_setzero_si128();
+	const __m128i one = _mm_set1_epi32(1);
+	const __m128i paddle_speed = _mm_set1_epi32(PADDLE_SPEED);
+	const __m128i paddle_y_limit = _mm_set1_epi32(FIELD_HEIGHT - PADDLE_HEIGHT);
+	const __m128i bottom_wall = _mm_set1_epi32(FIELD_HEIGHT - BALL_SIZE); // Where the ball's top is when it touches the bottom wall.
+
+	int vector_end = batch.size() - batch.size() % 4;
+	for (int i = 0; i < vector_end; i += 4) {
+		__m128i bx = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&batch.ball_x[i]));
+		__m128i by = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&batch.ball_y[i]));
+		__m128i vx = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&batch.ball_velocity_x[i]));
+		__m128i vy = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&batch.ball_velocity_y[i]));
+		__m128i p1y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&batch.player_1_y[i]));
+		__m128i p2y = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&batch.player_2_y[i]));
+		__m128i ticks = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&batch.tick[i]));
+		__m128i ended = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&batch.has_ended[i]));
+		__m128i follows_ball = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&batch.player_2_follows_ball[i]));
+		__m128i input_flags = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&batch.inputs[i]));
+
+		__m128i active = _mm_cmpeq_epi32(ended, zero);
+
+		// Paddles, up first and then down like move_paddle.
+		__m128i mask = _mm_cmpeq_epi32(bits_where_sse41(input_flags, MATCH_INPUT_PLAYER_1_UP), _mm_set1_epi32(MATCH_INPUT_PLAYER_1_UP));
+		__m128i next_p1y = _mm_sub_epi32(p1y, _mm_and_si128(_mm_and_si128(mask, _mm_cmpgt_epi32(p1y, zero)), paddle_speed));
+		mask = _mm_cmpeq_epi32(bits_where_sse41(input_flags, MATCH_INPUT_PLAYER_1_DOWN), _mm_set1_epi32(MATCH_INPUT_PLAYER_1_DOWN));
+		next_p1y = _mm_add_epi32(next_p1y, _mm_and_si128(_mm_and_si128(mask, _mm_cmpgt_epi32(paddle_y_limit, next_p1y)), paddle_speed));
+		mask = _mm_cmpeq_epi32(bits_where_sse41(input_flags, MATCH_INPUT_PLAYER_2_UP), _mm_set1_epi32(MATCH_INPUT_PLAYER_2_UP));
+		__m128i next_p2y = _mm_sub_epi32(p2y, _mm_and_si128(_mm_and_si128(mask, _mm_cmpgt_epi32(p2y, zero)), paddle_speed));
+		mask = _mm_cmpeq_epi32(bits_where_sse41(input_flags, MATCH_INPUT_PLAYER_2_DOWN), _mm_set1_epi32(MATCH_INPUT_PLAYER_2_DOWN));
+		next_p2y = _mm_add_epi32(next_p2y, _mm_and_si128(_mm_and_si128(mask, _mm_cmpgt_epi32(paddle_y_limit, next_p2y)), paddle_speed));
+
+		__m128i next_bx = _mm_add_epi32(bx, vx);
+		__m128i next_by = _mm_add_epi32(by, vy);
+
+		// A ball that gets past the top or the bottom wall bounces off of it, the rest of the move mirrored back from the wall like move_ball does.
+		__m128i top_bounce = _mm_cmpgt_epi32(zero, next_by);
+		__m128i bottom_bounce = _mm_cmpgt_epi32(next_by, bottom_wall);
+		__m128i bounced = _mm_or_si128(top_bounce, bottom_bounce);
+		__m128i bounced_by = _mm_blendv_epi8(next_by, _mm_sub_epi32(zero, next_by), top_bounce);
+		bounced_by = _mm_blendv_epi8(bounced_by, _mm_sub_epi32(_mm_set1_epi32(2 * (FIELD_HEIGHT - BALL_SIZE)), next_by), bottom_bounce);
+		__m128i next_vy = _mm_blendv_epi8(vy, _mm_sub_epi32(zero, vy), bounced);
+
+		// The box around the line the ball would have gone on and where it ended up, which is a little bigger than where it actually went.
+		__m128i min_x = _mm_min_epi32(bx, next_bx);
+		__m128i max_x = _mm_max_epi32(bx, next_bx);
+		__m128i min_y = _mm_min_epi32(_mm_min_epi32(by, next_by), bounced_by);
+		__m128i max_y = _mm_max_epi32(_mm_max_epi32(by, next_by), bounced_by);
+
+		// Strictly between the walls at the end, which also rules out a second bounce, and strictly between the goal lines.
+		__m128i is_fast = _mm_and_si128(active, _mm_cmpeq_epi32(follows_ball, zero));
+		is_fast = _mm_and_si128(is_fast, _mm_cmpgt_epi32(bounced_by, zero));
+		is_fast = _mm_and_si128(is_fast, _mm_cmpgt_epi32(bottom_wall, bounced_by));
+		is_fast = _mm_and_si128(is_fast, _mm_cmpgt_epi32(next_bx, zero));
+		is_fast = _mm_and_si128(is_fast, _mm_cmpgt_epi32(_mm_set1_epi32(FIELD_WIDTH - BALL_SIZE), next_bx));
+		is_fast = _mm_andnot_si128(may_hit_paddle_sse41(min_x, max_x, min_y, max_y, PLAYER_1_X, next_p1y), is_fast);
+		is_fast = _mm_andnot_si128(may_hit_paddle_sse41(min_x, max_x, min_y, max_y, PLAYER_2_X, next_p2y), is_fast);
+
+		__m128i next_ticks = _mm_add_epi32(ticks, one);
+		__m128i ball_event_value = note_ball_event_sse41(_mm_set1_epi32(-1), _mm_cmpeq_epi32(next_ticks, one), BallEventType::SERVE);
+		ball_event_value = note_ball_event_sse41(ball_event_value, bounced, BallEventType::WALL_BOUNCE);
+		__m128i wall_events = _mm_or_si128(bits_where_sse41(top_bounce, MATCH_EVENT_TOP_WALL_BOUNCE), bits_where_sse41(bottom_bounce, MATCH_EVENT_BOTTOM_WALL_BOUNCE));
+
+		// The scores and everything else stay as they are, the only events are the wall bounces.
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&batch.ball_x[i]), _mm_blendv_epi8(bx, next_bx, is_fast));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&batch.ball_y[i]), _mm_blendv_epi8(by, bounced_by, is_fast));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&batch.ball_velocity_y[i]), _mm_blendv_epi8(vy, next_vy, is_fast));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&batch.player_1_y[i]), _mm_blendv_epi8(p1y, next_p1y, is_fast));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&batch.player_2_y[i]), _mm_blendv_epi8(p2y, next_p2y, is_fast));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&batch.tick[i]), _mm_blendv_epi8(ticks, next_ticks, is_fast));
+		__m128i old_ball_event = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&batch.ball_event[i]));
+		__m128i old_events = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&batch.events[i]));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&batch.ball_event[i]), _mm_blendv_epi8(old_ball_event, ball_event_value, is_fast));
+		_mm_storeu_si128(reinterpret_cast<__m128i*>(&batch.events[i]), _mm_blendv_epi8(old_events, wall_events, is_fast));
+
+		batch.fast_step_count += std::bitset<4>(_mm_movemask_ps(_mm_castsi128_ps(is_fast))).count();
+
+		int slow_matches = _mm_movemask_ps(_mm_castsi128_ps(_mm_andnot_si128(is_fast, active)));
+		for (int lane = 0; lane < 4; lane++) {
+			if (slow_matches & (1 << lane))
+				batch.step_scalar(i + lane, i + lane + 1);
+		}
+	}
+
+	return vector_end;
+}
+#endif
+
+void MatchBatch::step() {
+	int stepped_matches = 0;
+
+#ifdef HAS_X86_SIMD
+	if (simd_level == SimdLevel::AVX2)
+		stepped_matches = step_avx2(*this);
+	else if (simd_level == SimdLevel::SSE41)
+		stepped_matches = step_sse41(*this);
+#endif
+
+	step_scalar(stepped_matches, match_count);
+}
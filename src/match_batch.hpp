@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include "match_simulation.hpp"
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define HAS_X86_SIMD
+#endif
+
+// Which paddles are being moved in a match, one int per match so the kernels can load them like everything else.
+#define MATCH_INPUT_PLAYER_1_UP 1
+#define MATCH_INPUT_PLAYER_1_DOWN 2
+#define MATCH_INPUT_PLAYER_2_UP 4
+#define MATCH_INPUT_PLAYER_2_DOWN 8
+
+enum class SimdLevel {
+	SCALAR,
+	SSE41,
+	AVX2
+};
+
+/*
+Steps a whole lot of matches at once, for bots and soak testing the server.
+Every field of MatchState gets an array of its own with one entry per match, so the same field of 4 (SSE4.1) or 8 (AVX2) matches can be loaded and stepped together.
+The kernels only step the matches where the ball flies straight, or bounces once off of the top or bottom wall, without getting near a paddle or a goal line, which is most of them on any given tick. Every other match goes through step() in match_simulation.cpp, so a match ends up exactly where step() would have taken it.
+Matches that don't fill up a whole vector at the end go through step() itself too, and so does everything on CPUs (or compilers) without the instructions.
+*/
+class MatchBatch {
+	private:
+		int match_count = 0;
+	public:
+		std::vector<int32_t> ball_x;
+		std::vector<int32_t> ball_y;
+		std::vector<int32_t> ball_velocity_x;
+		std::vector<int32_t> ball_velocity_y;
+		std::vector<int32_t> player_1_y;
+		std::vector<int32_t> player_2_y;
+		std::vector<int32_t> player_1_score;
+		std::vector<int32_t> player_2_score;
+		std::vector<int32_t> end_score;
+		std::vector<int32_t> ball_hit_count;
+		std::vector<uint32_t> tick;
+		std::vector<uint32_t> random_state;
+		std::vector<int32_t> has_ended;
+		std::vector<int32_t> player_2_follows_ball;
+		std::vector<int32_t> ball_event; // The BallEventType of the last step, -1 if nothing happened.
+		std::vector<int32_t> events;
+		std::vector<int32_t> inputs; // MATCH_INPUT_ flags for the next step.
+
+		SimdLevel simd_level = SimdLevel::SCALAR;
+		uint64_t fast_step_count = 0; // How many match steps the kernels took care of on their own, everything else went through step().
+
+		void init(int match_count_param, int end_score_param, uint32_t seed);
+		int size() const { return match_count; }
+		void set_match(int index, const MatchState& state);
+		MatchState get_match(int index) const;
+		void set_inputs(int index, const MatchInputs& match_inputs);
+		void set_ai_inputs();
+		void step();
+		void step_scalar(int first_match, int last_match); // The kernels' fallback, step() on each match in turn.
+};
+
+SimdLevel get_supported_simd_level();
+const char* get_simd_level_name(SimdLevel level);
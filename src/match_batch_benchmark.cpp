@@ -0,0 +1,102 @@
+#include "match_batch_benchmark.hpp"
+
+// Both have to be exactly the same, as far as hash_match_state and what the last step left for whoever's watching go.
+static bool is_same_match(const MatchState& a, const MatchState& b) {
+	return hash_match_state(a) == hash_match_state(b) && a.events == b.events && a.has_ball_event == b.has_ball_event && (!a.has_ball_event || a.ball_event_type == b.ball_event_type);
+}
+
+static MatchInputs get_reference_inputs(const MatchState& state) {
+	MatchInputs inputs;
+	inputs.player_1 = get_ai_input(state, state.player_1);
+	inputs.player_2 = get_ai_input(state, state.player_2);
+	return inputs;
+}
+
+// Steps the batch at the given level next to the same matches going through step() one by one, and compares every match after every tick.
+static bool validate_simd_level(SimdLevel level, int match_count, int tick_count, uint32_t seed) {
+	MatchBatch batch;
+	batch.init(match_count, MATCH_BATCH_BENCHMARK_END_SCORE, seed);
+	batch.simd_level = level;
+
+	std::vector<MatchState> reference(match_count);
+	for (int i = 0; i < match_count; i++)
+		reference[i] = create_match(MATCH_BATCH_BENCHMARK_END_SCORE, seed + i);
+
+	for (int tick = 1; tick <= tick_count; tick++) {
+		batch.set_ai_inputs();
+		batch.step();
+
+		for (int i = 0; i < match_count; i++) {
+			reference[i] = step(reference[i], get_reference_inputs(reference[i]));
+
+			if (!is_same_match(batch.get_match(i), reference[i])) {
+				std::cerr << get_simd_level_name(level) << ": match " << i << " is off from step() on tick " << tick << "." << "\n";
+				return false;
+			}
+		}
+	}
+
+	return true;
+}
+
+/*
+"dingdong --batch-bench [matches] [ticks] [seed]" checks every SIMD level this CPU has against step(), bit for bit on every match after every tick, and then times each of them.
+Both sides of every match are played by get_ai_input, like the batch's own bots. The plain step() loop over an array of MatchStates is timed too, as what the batch has to beat.
+*/
+int run_match_batch_benchmark(int argc, char* argv[]) {
+	int match_count = std::max((argc > 2) ? std::atoi(argv[2]) : MATCH_BATCH_BENCHMARK_DEFAULT_MATCHES, 1);
+	int tick_count = std::max((argc > 3) ? std::atoi(argv[3]) : MATCH_BATCH_BENCHMARK_DEFAULT_TICKS, 1);
+	uint32_t seed = (argc > 4) ? static_cast<uint32_t>(std::strtoul(argv[4], nullptr, 10)) : MATCH_BATCH_BENCHMARK_DEFAULT_SEED;
+
+	SimdLevel supported_level = get_supported_simd_level();
+	std::cout << "Stepping " << match_count << " matches for " << tick_count << " ticks, seeds " << seed << " and up. This CPU goes up to " << get_simd_level_name(supported_level) << "." << "\n";
+
+	double match_steps = static_cast<double>(match_count) * tick_count;
+
+	// The baseline, one match at a time with the same bots.
+	std::vector<MatchState> matches(match_count);
+	for (int i = 0; i < match_count; i++)
+		matches[i] = create_match(MATCH_BATCH_BENCHMARK_END_SCORE, seed + i);
+
+	auto start_time = std::chrono::steady_clock::now();
+	for (int tick = 0; tick < tick_count; tick++) {
+		for (MatchState& match : matches)
+			match = step(match, get_reference_inputs(match));
+	}
+	double step_seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+	std::cout << "step(): " << match_steps / std::max(step_seconds, 0.000001) << " match steps/sec." << "\n";
+
+	bool has_failed = false;
+	for (SimdLevel level : { SimdLevel::SCALAR, SimdLevel::SSE41, SimdLevel::AVX2 }) {
+		if (level > supported_level)
+			break;
+
+		if (!validate_simd_level(level, match_count, tick_count, seed)) {
+			has_failed = true;
+			continue;
+		}
+
+		MatchBatch batch;
+		batch.init(match_count, MATCH_BATCH_BENCHMARK_END_SCORE, seed);
+		batch.simd_level = level;
+
+		start_time = std::chrono::steady_clock::now();
+		for (int tick = 0; tick < tick_count; tick++) {
+			batch.set_ai_inputs();
+			batch.step();
+		}
+		double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+		std::cout << get_simd_level_name(level) << ": " << match_steps / std::max(seconds, 0.000001) << " match steps/sec, " << step_seconds / std::max(seconds, 0.000001) << "x step()";
+		std::cout << ", " << 100.0 * batch.fast_step_count / match_steps << "% of the steps never left the kernel. Matches step() bit for bit." << "\n";
+	}
+
+	if (has_failed) {
+		std::cout << "FAILED" << "\n";
+		return 1;
+	}
+
+	std::cout << "OK" << "\n";
+	return 0;
+}
@@ -0,0 +1,18 @@
+#pragma once
+
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include "match_batch.hpp"
+
+// What "dingdong --batch-bench" runs with unless told otherwise.
+#define MATCH_BATCH_BENCHMARK_DEFAULT_MATCHES 4096
+#define MATCH_BATCH_BENCHMARK_DEFAULT_TICKS 3000
+#define MATCH_BATCH_BENCHMARK_DEFAULT_SEED 1
+
+// High enough that no match ends during the benchmark, a match that has ended costs next to nothing to step.
+#define MATCH_BATCH_BENCHMARK_END_SCORE 1000
+
+int run_match_batch_benchmark(int argc, char* argv[]);
@@ -0,0 +1,484 @@
+#include "match_server.hpp"
+
+static uint64_t address_key(const SOCKADDR_IN& address) {
+	return (static_cast<uint64_t>(address.sin_addr.s_addr) << 16) | address.sin_port;
+}
+
+MatchServer::MatchServer() {
+#ifdef _WIN32
+	WSADATA wsadata;
+	int result = WSAStartup(MAKEWORD(2, 2), &wsadata);
+
+	if (result != 0)
+		std::cerr << "WSAStartup failed, error: " << result << "\n";
+	else
+		has_started_winsock = true;
+#endif
+
+	random_generator.seed(std::random_device()());
+}
+
+MatchServer::~MatchServer() {
+	transport.reset(); // Has to let go of the socket before it's closed.
+
+	if (sock != INVALID_SOCKET)
+		closesocket(sock);
+
+#ifdef _WIN32
+	if (has_started_winsock)
+		WSACleanup();
+#endif
+}
+
+// Returns last WSA error if there was an error setting up the socket, or 0 if the server is ready to run.
+// Every shard of a sharded server binds its own socket to the same port, shard_index has to match the order they're initialized in.
+int MatchServer::init(int port, int max_sessions, int shard_index_param, int shard_count_param, TransportBackend backend, double snapshot_bytes_per_second_param, AiDifficulty ai_difficulty_param) {
+	shard_index = shard_index_param;
+	shard_count = shard_count_param;
+	snapshot_bytes_per_second = snapshot_bytes_per_second_param;
+	ai_difficulty = ai_difficulty_param;
+
+	SOCKADDR_IN server_address;
+	memset(&server_address, 0, sizeof(server_address));
+	server_address.sin_family = AF_INET;
+	server_address.sin_port = htons(port);
+	server_address.sin_addr.s_addr = INADDR_ANY;
+
+	sock = socket(server_address.sin_family, SOCK_DGRAM, 0);
+	if (sock == INVALID_SOCKET) {
+		std::cerr << "Error occured while creating server socket: " << WSAGetLastError() << "\n";
+		return WSAGetLastError();
+	}
+
+#ifdef SO_REUSEPORT
+	if (shard_count > 1) {
+		int enable = 1;
+		if (setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, (const char*)&enable, sizeof(enable)) == SOCKET_ERROR) {
+			std::cerr << "Error while enabling SO_REUSEPORT on the server socket: " << WSAGetLastError() << "\n";
+			closesocket(sock);
+			sock = INVALID_SOCKET;
+			return WSAGetLastError();
+		}
+	}
+#endif
+
+	if (bind(sock, (SOCKADDR*)&server_address, sizeof(server_address)) == SOCKET_ERROR) {
+		std::cerr << "Server socket bind failed with error: " << WSAGetLastError() << "\n";
+		closesocket(sock);
+		sock = INVALID_SOCKET;
+		return WSAGetLastError();
+	}
+
+	if (!set_non_blocking(sock)) {
+		std::cerr << "Error while putting the socket into non-blocking mode: " << WSAGetLastError() << "\n";
+		closesocket(sock);
+		sock = INVALID_SOCKET;
+		return WSAGetLastError();
+	}
+
+	transport = create_transport(backend);
+	if (!transport || !transport->open(sock)) {
+		if (transport)
+			std::cerr << "Couldn't set up the requested transport, falling back to the default one. Last error: " << transport->last_error << "\n";
+
+		transport = create_transport(get_default_transport_backend());
+		if (!transport->open(sock)) {
+			std::cerr << "Couldn't set up a transport for the server socket: " << transport->last_error << "\n";
+			int error = transport->last_error;
+			transport.reset();
+			closesocket(sock);
+			sock = INVALID_SOCKET;
+			return error;
+		}
+	}
+
+	max_sessions = std::clamp(max_sessions, 1, MAX_MATCH_SESSIONS);
+	sessions.assign(max_sessions, MatchSession());
+	sessions_by_address.reserve(max_sessions);
+
+	// Hand out the lowest indices first.
+	free_sessions.clear();
+	for (int i = max_sessions - 1; i >= 0; i--)
+		free_sessions.push_back(i);
+
+	is_running = true;
+
+	if (is_verbose)
+		std::cout << "Shard " << shard_index << " hosting up to " << max_sessions << " matches on port " << port << " against the " << get_ai_difficulty_name(ai_difficulty) << " AI." << "\n";
+	return 0;
+}
+
+/*
+With SO_REUSEPORT, the kernel picks which shard's socket gets a datagram by hashing the sender's address. That keeps working as long as the client's address doesn't change, but the connection ID is what identifies a session.
+So on Linux, we hand the kernel a small classic BPF program that picks the socket from the connection ID instead: (salt % shard_count), which is the shard that opened the session.
+SYNs don't have a connection ID yet, for those the program returns an out of range index and the kernel falls back to the address hash.
+The program is shared by every socket on the port, so it only has to be attached to one of them, after all of them are bound.
+*/
+bool MatchServer::attach_shard_filter() {
+#ifdef HAS_REUSEPORT_FILTER
+	sock_filter code[] = {
+		{ BPF_LD | BPF_W | BPF_ABS, 0, 0, 0 }, // The connection ID, UDP payloads start at offset 0 here.
+		{ BPF_JMP | BPF_JEQ | BPF_K, 0, 1, NO_CONNECTION_ID },
+		{ BPF_RET | BPF_K, 0, 0, 0xFFFFFFFF },
+		{ BPF_ALU | BPF_RSH | BPF_K, 0, 0, SESSION_INDEX_BITS },
+		{ BPF_ALU | BPF_MOD | BPF_K, 0, 0, static_cast<uint32_t>(shard_count) },
+		{ BPF_RET | BPF_A, 0, 0, 0 }
+	};
+
+	sock_fprog program;
+	program.len = sizeof(code) / sizeof(code[0]);
+	program.filter = code;
+
+	if (setsockopt(sock, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &program, sizeof(program)) == SOCKET_ERROR) {
+		std::cerr << "Couldn't route datagrams to shards by connection ID, falling back to the sender's address: " << WSAGetLastError() << "\n";
+		return false;
+	}
+
+	return true;
+#else
+	return false;
+#endif
+}
+
+// The transport blocks until a datagram comes in or a millisecond passes, whichever comes first. Ticks are 16 milliseconds apart, so that's plenty accurate.
+void MatchServer::run() {
+	while (is_running) {
+		receive_all(get_network_time());
+
+		double now = get_network_time();
+		for (MatchSession& session : sessions) {
+			if (session.is_active)
+				update_session(session, now);
+		}
+
+		flush_sends();
+
+		if (is_timing_updates)
+			update_times_ms.push_back(static_cast<float>(get_network_time() - now));
+	}
+}
+
+int MatchServer::get_session_count() {
+	return session_count;
+}
+
+void MatchServer::receive_all(double now) {
+	int timeout_us = NETWORK_POLL_INTERVAL_US;
+
+	while (true) {
+		int count = transport->receive(receive_batch, TRANSPORT_BATCH_SIZE, timeout_us);
+
+		// Handle errors.
+		if (count == SOCKET_ERROR) {
+			if (transport->last_error == WSAECONNRESET) { // Only tells us that one of the clients went away, which the session timeout takes care of.
+				timeout_us = 0;
+				continue;
+			}
+
+			// Try again on the next pass, but a bit later every time it keeps failing, so every match still gets its ticks without this turning into a tight loop.
+			receive_errors.count(now, transport->last_error);
+			receive_error_streak++;
+			std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(get_receive_error_backoff_ms(receive_error_streak)));
+			return;
+		}
+
+		receive_error_streak = 0;
+
+		for (int i = 0; i < count; i++)
+			route_datagram(receive_batch[i], now);
+
+		if (count < TRANSPORT_BATCH_SIZE) // A short batch means the socket is empty, no need to spend another call finding that out.
+			return;
+
+		timeout_us = 0; // Only wait for the first batch, the rest is whatever is already waiting.
+	}
+}
+
+MatchSession* MatchServer::find_session(uint32_t connection_id) {
+	uint32_t index = connection_id & (MAX_MATCH_SESSIONS - 1);
+
+	if (index >= sessions.size() || !sessions[index].is_active || sessions[index].connection_id != connection_id)
+		return nullptr;
+
+	return &sessions[index];
+}
+
+void MatchServer::route_datagram(const Datagram& datagram, double now) {
+	if (datagram.length < CONNECTION_ID_LENGTH)
+		return;
+
+	const SOCKADDR_IN& sender = datagram.address;
+	uint32_t connection_id = read_connection_id(datagram.data);
+	const uint8_t* message = datagram.data + CONNECTION_ID_LENGTH;
+	int message_length = datagram.length - CONNECTION_ID_LENGTH;
+
+	// Someone new trying to connect, or someone whose SYN-ACK got lost.
+	if (connection_id == NO_CONNECTION_ID) {
+		if (!decode_handshake(message, message_length, MessageType::SYN))
+			return;
+
+		auto existing_session = sessions_by_address.find(address_key(sender));
+		if (existing_session != sessions_by_address.end()) {
+			MatchSession& session = sessions[existing_session->second];
+			send_message(session, encode_handshake(MessageType::SYN_ACK, begin_message(), MAX_PACKET_LENGTH, session.match_setup));
+		}
+		else
+			open_session(sender, now);
+
+		return;
+	}
+
+	MatchSession* session = find_session(connection_id);
+	if (session == nullptr) // Either a stray datagram or one from a session that timed out.
+		return;
+
+	// The connection ID is what identifies the client, so follow it if its address changes.
+	if (address_key(session->address) != address_key(sender)) {
+		sessions_by_address.erase(address_key(session->address));
+		sessions_by_address[address_key(sender)] = connection_id & (MAX_MATCH_SESSIONS - 1);
+		session->address = sender;
+	}
+
+	session->last_heard_time = now;
+	process_message(*session, message, message_length, now);
+}
+
+void MatchServer::open_session(const SOCKADDR_IN& sender, double now) {
+	if (free_sessions.empty()) { // The client will time out and show that it couldn't connect.
+		full_server_drops.count(now);
+		return;
+	}
+
+	uint32_t index = free_sessions.back();
+	free_sessions.pop_back();
+
+	// Any salt that leaves this shard's index when divided by shard_count, and isn't 0.
+	std::uniform_int_distribution<uint32_t> salt_distribution((shard_index == 0) ? 1 : 0, (SESSION_SALT_MAX - shard_index) / shard_count);
+	uint32_t salt = salt_distribution(random_generator) * shard_count + shard_index;
+
+	MatchSession& session = sessions[index];
+	session = MatchSession();
+	session.is_active = true;
+	session.connection_id = (salt << SESSION_INDEX_BITS) | index;
+	session.address = sender;
+	session.last_heard_time = now;
+	session.next_step_time = now + MATCH_COUNTDOWN_MS; // The client starts its countdown when it gets the SYN-ACK, and so do we.
+	session.last_ball_event_time = now;
+	session.match_setup.seed = random_generator();
+	session.match_setup.end_score = MATCH_END_SCORE;
+	session.match = create_match(session.match_setup.end_score, session.match_setup.seed);
+	session.lag_compensator.reset(session.match);
+	session.player_1_ai.init(get_ai_settings(ai_difficulty), 1, session.match_setup.seed);
+	session.snapshot_rate.max_bytes_per_second = snapshot_bytes_per_second;
+	session.snapshot_rate.reset(now);
+
+	sessions_by_address[address_key(sender)] = index;
+	session_count++;
+
+	send_message(session, encode_handshake(MessageType::SYN_ACK, begin_message(), MAX_PACKET_LENGTH, session.match_setup));
+	if (is_verbose)
+		std::cout << "Session " << session.connection_id << " opened, " << session_count << " active." << "\n";
+}
+
+void MatchServer::close_session(MatchSession& session) {
+	sessions_by_address.erase(address_key(session.address));
+	free_sessions.push_back(session.connection_id & (MAX_MATCH_SESSIONS - 1));
+	session_count--;
+
+	const SnapshotRateController& snapshot_rate = session.snapshot_rate;
+	if (is_verbose)
+		std::cout << "Session " << session.connection_id << " closed, " << session_count << " active. Round trip was " << snapshot_rate.smoothed_rtt << " ms with " << snapshot_rate.rtt_variation << " ms of jitter, "
+			<< snapshot_rate.lost_count << " of " << snapshot_rate.sent_count << " snapshots lost, " << session.lag_compensator.rewind_count << " hits given back by rewinding up to " << session.lag_compensator.max_rewind_ticks << " ticks." << "\n";
+	session.is_active = false;
+}
+
+// Same as the server side of Game::process_received_data.
+void MatchServer::process_message(MatchSession& session, const uint8_t* message, int length, double now) {
+	MessageType message_type;
+	if (!peek_message_type(message, length, message_type))
+		return;
+
+	switch (message_type) {
+		case MessageType::INPUT:
+		{
+			InputMessage input;
+			BallEventMessage rewind_event;
+			if (decode_input(message, length, input) && session.lag_compensator.apply_client_inputs(session.match, input, session.last_processed_input, rewind_event, &session.player_1_ai))
+				send_rewind_event(session, rewind_event, now);
+			break;
+		}
+		case MessageType::TIME_REQUEST:
+		{
+			TimeRequestMessage time_request;
+			if (!decode_time_request(message, length, time_request))
+				break;
+
+			// Answered right away, so it was received and sent on the same clock reading.
+			TimeResponseMessage time_response;
+			time_response.sequence = time_request.sequence;
+			time_response.receive_clock = time_response.send_clock = get_server_clock(session, now);
+
+			send_message(session, encode_time_response(time_response, begin_message(), MAX_PACKET_LENGTH));
+			break;
+		}
+		case MessageType::EVENT_ACK:
+		{
+			EventAckMessage event_ack;
+			if (decode_event_ack(message, length, event_ack))
+				session.reliable_events.on_event_ack(event_ack);
+			break;
+		}
+		case MessageType::SNAPSHOT_ACK:
+		{
+			SnapshotAckMessage snapshot_ack;
+			if (!decode_snapshot_ack(message, length, snapshot_ack))
+				break;
+
+			session.snapshot_rate.on_snapshot_acked(snapshot_ack.sequence, now);
+
+			if (!session.has_snapshot_ack || sequence_more_recent(snapshot_ack.sequence, session.acked_snapshot_sequence)) {
+				session.has_snapshot_ack = true;
+				session.acked_snapshot_sequence = snapshot_ack.sequence;
+			}
+			break;
+		}
+		default: // The client's ACK, nothing else is sent to the server.
+			break;
+	}
+}
+
+void MatchServer::update_session(MatchSession& session, double now) {
+	if (now - session.last_heard_time > SESSION_TIMEOUT_MS) {
+		close_session(session);
+		return;
+	}
+
+	// Step the match for however many ticks have passed since the last update, sending every change in the ball's trajectory as it happens.
+	int steps = 0;
+	while (now >= session.next_step_time && !session.match.has_ended) {
+		if (steps == MAX_STEPS_PER_UPDATE) { // Too far behind, give up on the missed ticks instead of stalling every other match.
+			session.next_step_time = now + SIMULATION_STEP_MS;
+			break;
+		}
+
+		// Player 1 is played by the same AI that Game uses in single player, player 2's inputs are applied as soon as they come in.
+		MatchInputs inputs;
+		inputs.player_1 = session.player_1_ai.get_input(session.match);
+		session.match = step(session.match, inputs);
+		session.lag_compensator.record_step(inputs, session.match, &session.player_1_ai);
+		session.next_step_time += SIMULATION_STEP_MS;
+		steps++;
+
+		if (session.match.has_ball_event)
+			send_ball_event(session, session.match.ball_event_type, now);
+
+		MatchState scored_match;
+		if (session.lag_compensator.pop_confirmed_score(session.match, scored_match))
+			push_score_event(session, scored_match);
+	}
+
+	if (session.match.tick > 0 && !session.match.has_ended && now - session.last_ball_event_time >= MATCH_BALL_CORRECTION_INTERVAL_MS)
+		send_ball_event(session, BallEventType::CORRECTION, now);
+
+	// Events and snapshots keep going after the match ends, the client might still be missing the last point.
+	send_reliable_events(session, now);
+	if (session.snapshot_rate.should_send_snapshot(session.match, now))
+		send_snapshot(session, now);
+}
+
+// Where the next message should be encoded, in the next free slot of send_batch after the connection ID. Sends the batch first if it's full.
+uint8_t* MatchServer::begin_message() {
+	if (send_count == TRANSPORT_BATCH_SIZE)
+		flush_sends();
+
+	return send_batch[send_count].data + CONNECTION_ID_LENGTH;
+}
+
+// Queues the message that's been encoded at begin_message() for sending to the session's client.
+void MatchServer::send_message(MatchSession& session, int message_length) {
+	if (message_length <= 0) {
+		std::cerr << "Tried to send a message that didn't fit in the packet buffer." << "\n";
+		return;
+	}
+
+	Datagram& datagram = send_batch[send_count];
+	write_connection_id(datagram.data, session.connection_id);
+	datagram.length = CONNECTION_ID_LENGTH + message_length;
+	datagram.address = session.address;
+	send_count++;
+
+	session.snapshot_rate.note_sent_bytes(message_length);
+}
+
+void MatchServer::flush_sends() {
+	if (send_count == 0)
+		return;
+
+	if (!transport->send(send_batch, send_count))
+		std::cerr << "Error while sending data: " << transport->last_error << "\n";
+
+	send_count = 0;
+}
+
+void MatchServer::send_ball_event(MatchSession& session, BallEventType type, double now) {
+	session.latest_ball_event = make_ball_event(session.match, type);
+	session.last_ball_event_time = now;
+
+	send_message(session, encode_ball_event(session.latest_ball_event, begin_message(), MAX_PACKET_LENGTH));
+}
+
+// Same as Game::send_rewind_event.
+void MatchServer::send_rewind_event(MatchSession& session, const BallEventMessage& rewind_event, double now) {
+	send_message(session, encode_ball_event(rewind_event, begin_message(), MAX_PACKET_LENGTH));
+
+	session.latest_ball_event = make_ball_event(session.match, BallEventType::CORRECTION);
+	session.last_ball_event_time = now;
+}
+
+// Same as Game::get_server_clock. Steps are SIMULATION_STEP_MS apart, so the latest one was taken one step before the next.
+double MatchServer::get_server_clock(const MatchSession& session, double now) {
+	return session.match.tick + (now - (session.next_step_time - SIMULATION_STEP_MS)) / SIMULATION_STEP_MS;
+}
+
+// Same as Game::push_score_event.
+void MatchServer::push_score_event(MatchSession& session, const MatchState& scored_match) {
+	ReliableEvent event;
+	event.type = scored_match.has_ended ? ReliableEventType::MATCH_END : ReliableEventType::SCORE;
+	event.tick = scored_match.tick;
+	event.player_1_score = scored_match.player_1_score;
+	event.player_2_score = scored_match.player_2_score;
+
+	session.reliable_events.push_event(event);
+}
+
+void MatchServer::send_reliable_events(MatchSession& session, double now) {
+	ReliableEventMessage event_message;
+	if (session.reliable_events.make_event_message(now, session.snapshot_rate.get_ack_timeout(), event_message))
+		send_message(session, encode_reliable_event(event_message, begin_message(), MAX_PACKET_LENGTH));
+}
+
+// Same as Game::send_snapshot, with player 1 being the AI.
+void MatchServer::send_snapshot(MatchSession& session, double now) {
+	const MatchState& match = session.match;
+
+	SnapshotMessage snapshot;
+	snapshot.sequence = session.next_snapshot_sequence++;
+	snapshot.server_tick = match.tick;
+	snapshot.ball_event_type = session.latest_ball_event.type;
+	snapshot.ball_tick = session.latest_ball_event.tick;
+	snapshot.ball_x = session.latest_ball_event.x;
+	snapshot.ball_y = session.latest_ball_event.y;
+	snapshot.ball_velocity_x = session.latest_ball_event.velocity_x;
+	snapshot.ball_velocity_y = session.latest_ball_event.velocity_y;
+	snapshot.player_1_y = to_pixels(match.player_1.y);
+	snapshot.player_2_y = to_pixels(session.lag_compensator.get_client_paddle().y);
+	snapshot.last_processed_input = session.last_processed_input;
+
+	const SnapshotMessage* baseline = session.has_snapshot_ack ? session.sent_snapshots.find(session.acked_snapshot_sequence) : nullptr;
+
+	int snapshot_length = encode_snapshot(snapshot, baseline, begin_message(), MAX_PACKET_LENGTH);
+
+	session.sent_snapshots.store(snapshot); // Has to be stored after encoding as it might take the baseline's place in the history.
+	send_message(session, snapshot_length);
+	session.snapshot_rate.on_snapshot_sent(snapshot.sequence, now);
+}
@@ -0,0 +1,124 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <unordered_map>
+#include <random>
+#include <atomic>
+#include "socket_platform.hpp"
+#include "protocol.hpp"
+#include "match_simulation.hpp"
+#include "network_thread.hpp"
+#include "transport.hpp"
+#include "snapshot_rate_controller.hpp"
+#include "reliable_event_channel.hpp"
+#include "lag_compensator.hpp"
+#include "paddle_ai.hpp"
+
+// The low bits of a connection ID are the index of its session in the session table, the rest are random so that IDs can't be guessed and a reused slot gets a new ID.
+// When the server is sharded, the random part is also picked so that it leaves the shard's index when divided by the number of shards, see attach_shard_filter.
+#define SESSION_INDEX_BITS 16
+#define SESSION_SALT_MAX ((1u << (32 - SESSION_INDEX_BITS)) - 1)
+#define MAX_MATCH_SESSIONS (1 << SESSION_INDEX_BITS)
+#define DEFAULT_MATCH_SESSIONS 1024
+
+// A session is dropped if its client hasn't sent anything for this long. Clients keep acknowledging snapshots during a match, so this only happens once they leave.
+#define SESSION_TIMEOUT_MS 10000.0
+
+// Same timings Game uses when a player hosts.
+#define MATCH_COUNTDOWN_MS 1714.0
+#define MATCH_BALL_CORRECTION_INTERVAL_MS 1000.0
+#define MATCH_END_SCORE 10
+
+// If the server falls behind, don't try to catch up on more than this many steps of a match at once.
+#define MAX_STEPS_PER_UPDATE 5
+
+struct MatchSession {
+	bool is_active = false;
+	uint32_t connection_id = NO_CONNECTION_ID;
+	SOCKADDR_IN address;
+
+	double last_heard_time = 0.0;
+	double next_step_time = 0.0;
+	double last_ball_event_time = 0.0;
+
+	MatchState match;
+	MatchSetup match_setup; // Sent with the SYN-ACK, so the client can start the exact same match.
+	BallEventMessage latest_ball_event;
+
+	uint16_t next_snapshot_sequence = 0;
+	SnapshotHistory sent_snapshots;
+	bool has_snapshot_ack = false;
+	uint16_t acked_snapshot_sequence = 0;
+	SnapshotRateController snapshot_rate;
+	ReliableEventChannel reliable_events; // Scores and the end of the match.
+
+	uint16_t last_processed_input = 0;
+	LagCompensator lag_compensator;
+	PaddleAi player_1_ai;
+};
+
+// Headless server that hosts many matches on one UDP port at once, each one a client playing against the server's AI.
+// Every datagram is routed to its match by the connection ID in front of it, which is also the index of the match in the session table.
+// Only ever touched by the thread that runs it. ShardedMatchServer runs several of these on the same port, one per thread.
+class MatchServer {
+	private:
+		SOCKET sock = INVALID_SOCKET;
+		std::unique_ptr<Transport> transport;
+
+		std::vector<MatchSession> sessions;
+		std::vector<uint32_t> free_sessions; // Indices of inactive sessions.
+		std::unordered_map<uint64_t, uint32_t> sessions_by_address; // Only used to answer a SYN that was sent again, as it doesn't have a connection ID yet.
+		int session_count = 0;
+
+		DropCounter full_server_drops{ "Server is full, ignoring SYNs." };
+		DropCounter receive_errors{ "Unhandled error while receiving data." };
+		int receive_error_streak = 0;
+
+		bool has_started_winsock = false; // Only ever set on Windows, the destructor cleans up after the constructor's WSAStartup if it worked.
+
+		std::mt19937 random_generator;
+
+		int shard_index = 0;
+		int shard_count = 1;
+
+		double snapshot_bytes_per_second = DEFAULT_SNAPSHOT_BYTES_PER_SECOND; // Every session's cap, see SnapshotRateController.
+		AiDifficulty ai_difficulty = DEFAULT_AI_DIFFICULTY; // How good player 1 is in every session.
+
+		// Messages are encoded straight into send_batch and go out together at the end of every loop, or as soon as the batch is full.
+		Datagram receive_batch[TRANSPORT_BATCH_SIZE];
+		Datagram send_batch[TRANSPORT_BATCH_SIZE];
+		int send_count = 0;
+
+		void receive_all(double now);
+		void route_datagram(const Datagram& datagram, double now);
+		MatchSession* find_session(uint32_t connection_id);
+		void open_session(const SOCKADDR_IN& sender, double now);
+		void close_session(MatchSession& session);
+		void process_message(MatchSession& session, const uint8_t* message, int length, double now);
+		void update_session(MatchSession& session, double now);
+		uint8_t* begin_message();
+		void send_message(MatchSession& session, int message_length);
+		void flush_sends();
+		void send_ball_event(MatchSession& session, BallEventType type, double now);
+		void send_rewind_event(MatchSession& session, const BallEventMessage& rewind_event, double now);
+		void send_snapshot(MatchSession& session, double now);
+		double get_server_clock(const MatchSession& session, double now);
+		void push_score_event(MatchSession& session, const MatchState& scored_match);
+		void send_reliable_events(MatchSession& session, double now);
+	public:
+		std::atomic<bool> is_running{ false }; // Set once init succeeds, run returns soon after it's cleared.
+		bool is_verbose = true; // Whether the server says so every time it starts or a session opens or closes. Has to be set before init.
+
+		// While is_timing_updates is set, run records how long every pass over the sessions takes in update_times_ms, for --shard-bench.
+		// update_times_ms is only safe to read once run has returned.
+		std::atomic<bool> is_timing_updates{ false };
+		std::vector<float> update_times_ms;
+
+		MatchServer();
+		~MatchServer();
+		int init(int port, int max_sessions, int shard_index_param = 0, int shard_count_param = 1, TransportBackend backend = get_default_transport_backend(), double snapshot_bytes_per_second_param = DEFAULT_SNAPSHOT_BYTES_PER_SECOND, AiDifficulty ai_difficulty_param = DEFAULT_AI_DIFFICULTY);
+		bool attach_shard_filter();
+		void run();
+		int get_session_count();
+};
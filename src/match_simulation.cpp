@@ -0,0 +1,404 @@
+#include "match_simulation.hpp"
+
+static uint32_t next_random(MatchState& state) {
+	uint32_t x = state.random_state;
+	x ^= x << 13;
+	x ^= x >> 17;
+	x ^= x << 5;
+	state.random_state = x;
+	return x;
+}
+
+static int random_direction(MatchState& state) {
+	return (next_random(state) & 1) == 0 ? -1 : 1;
+}
+
+static void note_ball_event(MatchState& state, BallEventType type) {
+	if (!state.has_ball_event || type > state.ball_event_type)
+		state.ball_event_type = type;
+
+	state.has_ball_event = true;
+}
+
+static void increase_ball_speed(MatchState& state) {
+	note_ball_event(state, BallEventType::SPEED_UP);
+
+	state.ball_velocity_x += (state.ball_velocity_x < 0) ? -MATCH_BALL_SPEED_UP : MATCH_BALL_SPEED_UP;
+	state.ball_velocity_y += (state.ball_velocity_y < 0) ? -MATCH_BALL_SPEED_UP : MATCH_BALL_SPEED_UP;
+}
+
+// A point in time during a step, as a fraction of it. Only ever compared by cross multiplying, so it never gets rounded.
+struct StepTime {
+	int64_t numerator = 0;
+	int64_t denominator = 1; // Always positive.
+};
+
+static bool is_earlier(const StepTime& a, const StepTime& b) {
+	return a.numerator * b.denominator < b.numerator * a.denominator;
+}
+
+// When something moving from start by delta over the step gets to position. delta can't be 0.
+static StepTime get_crossing_time(int start, int delta, int position) {
+	StepTime time;
+	time.numerator = (delta > 0) ? position - start : start - position;
+	time.denominator = std::abs(delta);
+	return time;
+}
+
+/*
+The ball goes in a straight line over a step, and every bounce mirrors the rest of that line over whatever it bounced off of.
+So instead of moving the ball, step() keeps the line it would have gone on if nothing was in the way, and for each axis how that line maps onto the screen after all the bounces so far: screen = sign * line + offset.
+Everything here is in fixed-point, so a ball that's between pixels bounces off of the exact same place on both sides of a connection.
+*/
+struct BallPath {
+	int start[2]; // x, y
+	int delta[2];
+	int sign[2] = { 1, 1 };
+	int offset[2] = { 0, 0 };
+
+	// Which way the ball is going on screen along the axis, -1 or 1.
+	int get_direction(int axis) const {
+		return (sign[axis] * delta[axis] < 0) ? -1 : 1;
+	}
+
+	// Where the line is when the ball is at the screen position.
+	int to_line(int axis, int screen_position) const {
+		return (screen_position - offset[axis]) * sign[axis];
+	}
+
+	void bounce(int axis, int screen_plane) {
+		sign[axis] = -sign[axis];
+		offset[axis] = 2 * screen_plane - offset[axis];
+	}
+
+	int get_end(int axis) const {
+		return sign[axis] * (start[axis] + delta[axis]) + offset[axis];
+	}
+};
+
+#define BALL_PATH_X 0
+#define BALL_PATH_Y 1
+
+// Anything that would take more bounces than this in one step would have to be going across the whole screen several times a step.
+#define MATCH_MAX_BOUNCES_PER_STEP 16
+
+// When the ball gets to the wall at screen_plane along the axis, if it's going towards it and gets there by the end of the step. A ball that's somehow already past the wall bounces right away.
+static bool find_wall_hit(const BallPath& path, int axis, int screen_plane, int direction, const StepTime& now, StepTime& hit_time) {
+	if (path.delta[axis] == 0 || path.get_direction(axis) != direction)
+		return false;
+
+	hit_time = get_crossing_time(path.start[axis], path.delta[axis], path.to_line(axis, screen_plane));
+	if (is_earlier(hit_time, now))
+		hit_time = now;
+
+	return hit_time.numerator <= hit_time.denominator;
+}
+
+// When the ball's top left corner is strictly inside (low, high) along the axis, on its line. Touching edges don't count, same as SDL_HasIntersection.
+static void find_slab_times(const BallPath& path, int axis, int screen_low, int screen_high, StepTime& enter, StepTime& exit) {
+	int line_low = path.to_line(axis, screen_low);
+	int line_high = path.to_line(axis, screen_high);
+	if (line_low > line_high)
+		std::swap(line_low, line_high);
+
+	if (path.delta[axis] == 0) { // Either always inside or never. Anything outside of 0 to 1 is as good as forever.
+		bool is_inside = line_low < path.start[axis] && path.start[axis] < line_high;
+		enter = { is_inside ? -2 : 2, 1 };
+		exit = { is_inside ? 2 : -2, 1 };
+		return;
+	}
+
+	enter = get_crossing_time(path.start[axis], path.delta[axis], (path.delta[axis] > 0) ? line_low : line_high);
+	exit = get_crossing_time(path.start[axis], path.delta[axis], (path.delta[axis] > 0) ? line_high : line_low);
+}
+
+/*
+When the ball runs into the paddle after now and by the end of the step, and which of the paddle's sides it hits.
+A ball that's already overlapping the paddle at the start of the step, because the paddle moved into it, goes back the other way if it was heading for the paddle's goal, like it always did. Otherwise it's let through, so it doesn't get stuck bouncing around inside.
+*/
+static bool find_paddle_hit(const BallPath& path, const MatchRect& paddle, const MatchRect& ball, int goal_direction, const StepTime& now, StepTime& hit_time, int& hit_axis, int& hit_plane) {
+	StepTime enter[2];
+	StepTime exit[2];
+	find_slab_times(path, BALL_PATH_X, paddle.x - ball.w, paddle.x + paddle.w, enter[BALL_PATH_X], exit[BALL_PATH_X]);
+	find_slab_times(path, BALL_PATH_Y, paddle.y - ball.h, paddle.y + paddle.h, enter[BALL_PATH_Y], exit[BALL_PATH_Y]);
+
+	hit_axis = is_earlier(enter[BALL_PATH_X], enter[BALL_PATH_Y]) ? BALL_PATH_Y : BALL_PATH_X; // Whichever side it got past last is the one it hit.
+	StepTime entry = enter[hit_axis];
+	StepTime leave = is_earlier(exit[BALL_PATH_X], exit[BALL_PATH_Y]) ? exit[BALL_PATH_X] : exit[BALL_PATH_Y];
+
+	if (!is_earlier(entry, leave)) // Never inside, or only touching it.
+		return false;
+
+	if (is_earlier(entry, now)) {
+		if (now.numerator != 0 || !is_earlier(now, leave) || path.get_direction(BALL_PATH_X) != goal_direction)
+			return false;
+
+		// Turn around right where it is.
+		hit_time = now;
+		hit_axis = BALL_PATH_X;
+		hit_plane = path.sign[BALL_PATH_X] * path.start[BALL_PATH_X] + path.offset[BALL_PATH_X];
+		return true;
+	}
+
+	if (entry.numerator > entry.denominator)
+		return false;
+
+	hit_time = entry;
+	if (hit_axis == BALL_PATH_X)
+		hit_plane = (path.get_direction(BALL_PATH_X) > 0) ? paddle.x - ball.w : paddle.x + paddle.w;
+	else
+		hit_plane = (path.get_direction(BALL_PATH_Y) > 0) ? paddle.y - ball.h : paddle.y + paddle.h;
+
+	return true;
+}
+
+/*
+Moves the ball for a step, bouncing it off of everything it runs into on the way in the order it gets to them, as many times as it takes.
+Nothing gets skipped however fast the ball is going, and a ball that clips the top or bottom of a paddle bounces off of that instead of going back the way it came.
+Speed ups from paddle hits only kick in from the next step, so that the ball goes in a straight line between bounces.
+*/
+static void move_ball(MatchState& state) {
+	BallPath path;
+	path.start[BALL_PATH_X] = state.ball.x;
+	path.start[BALL_PATH_Y] = state.ball.y;
+	path.delta[BALL_PATH_X] = state.ball_velocity_x;
+	path.delta[BALL_PATH_Y] = state.ball_velocity_y;
+
+	StepTime now;
+	int speed_up_count = 0;
+
+	for (int bounce = 0; bounce < MATCH_MAX_BOUNCES_PER_STEP; bounce++) {
+		// Ties go to whatever comes first here, the same order step() used to check them in.
+		int hit = -1;
+		StepTime hit_time = { 2, 1 }; // Later than anything that can happen during the step.
+		int hit_axis = BALL_PATH_Y;
+		int hit_plane = 0;
+
+		StepTime time;
+		if (find_wall_hit(path, BALL_PATH_Y, 0, -1, now, time) && is_earlier(time, hit_time)) {
+			hit = MATCH_EVENT_TOP_WALL_BOUNCE;
+			hit_time = time;
+			hit_axis = BALL_PATH_Y;
+			hit_plane = 0;
+		}
+
+		if (find_wall_hit(path, BALL_PATH_Y, to_fixed(MATCH_HEIGHT) - state.ball.h, 1, now, time) && is_earlier(time, hit_time)) {
+			hit = MATCH_EVENT_BOTTOM_WALL_BOUNCE;
+			hit_time = time;
+			hit_axis = BALL_PATH_Y;
+			hit_plane = to_fixed(MATCH_HEIGHT) - state.ball.h;
+		}
+
+		int paddle_axis = 0;
+		int paddle_plane = 0;
+		if (find_paddle_hit(path, state.player_1, state.ball, -1, now, time, paddle_axis, paddle_plane) && is_earlier(time, hit_time)) {
+			hit = MATCH_EVENT_PLAYER_1_HIT;
+			hit_time = time;
+			hit_axis = paddle_axis;
+			hit_plane = paddle_plane;
+		}
+
+		if (find_paddle_hit(path, state.player_2, state.ball, 1, now, time, paddle_axis, paddle_plane) && is_earlier(time, hit_time)) {
+			hit = MATCH_EVENT_PLAYER_2_HIT;
+			hit_time = time;
+			hit_axis = paddle_axis;
+			hit_plane = paddle_plane;
+		}
+
+		if (hit == -1)
+			break;
+
+		path.bounce(hit_axis, hit_plane);
+		now = hit_time;
+		state.events |= hit;
+
+		if (hit == MATCH_EVENT_TOP_WALL_BOUNCE || hit == MATCH_EVENT_BOTTOM_WALL_BOUNCE) {
+			note_ball_event(state, BallEventType::WALL_BOUNCE);
+			continue;
+		}
+
+		note_ball_event(state, BallEventType::PADDLE_BOUNCE);
+
+		// Only hits with the front (or back) of the paddle count towards speeding up, the ball can get stuck bouncing between the top of a paddle and the wall for a while.
+		if (hit_axis != BALL_PATH_X)
+			continue;
+
+		state.ball_hit_count++;
+		speed_up_count++;
+	}
+
+	// If it ran out of bounces, it's still on the screen at least.
+	state.ball.x = path.get_end(BALL_PATH_X);
+	state.ball.y = std::clamp(path.get_end(BALL_PATH_Y), 0, to_fixed(MATCH_HEIGHT) - state.ball.h);
+	state.ball_velocity_x *= path.sign[BALL_PATH_X];
+	state.ball_velocity_y *= path.sign[BALL_PATH_Y];
+
+	for (int i = 0; i < speed_up_count; i++)
+		increase_ball_speed(state);
+}
+
+static void start_new_round(MatchState& state, bool has_player_1_scored) {
+	note_ball_event(state, BallEventType::SCORE);
+	state.events |= has_player_1_scored ? MATCH_EVENT_PLAYER_1_SCORED : MATCH_EVENT_PLAYER_2_SCORED;
+
+	if (state.player_1_score == state.end_score || state.player_2_score == state.end_score) {
+		state.has_ended = true;
+		return;
+	}
+
+	// Make the ball go towards above or below in a random fashion, but towards whoever scored.
+	state.ball_velocity_x = has_player_1_scored ? -to_fixed(MATCH_BALL_START_SPEED) : to_fixed(MATCH_BALL_START_SPEED);
+	state.ball_velocity_y = to_fixed(MATCH_BALL_START_SPEED) * random_direction(state);
+
+	state.ball_hit_count = 0;
+	reset_positions(state);
+}
+
+MatchState create_match(int end_score, uint32_t seed, bool player_2_follows_ball) {
+	MatchState state;
+	state.end_score = end_score;
+	state.random_state = (seed != 0) ? seed : 0x9E3779B9; // xorshift gets stuck on 0.
+	state.player_2_follows_ball = player_2_follows_ball;
+
+	state.player_1 = { to_fixed(MATCH_PADDLE_MARGIN), 0, to_fixed(MATCH_PADDLE_WIDTH), to_fixed(MATCH_PADDLE_HEIGHT) };
+	state.player_2 = { to_fixed(MATCH_WIDTH - MATCH_PADDLE_WIDTH - MATCH_PADDLE_MARGIN), 0, to_fixed(MATCH_PADDLE_WIDTH), to_fixed(MATCH_PADDLE_HEIGHT) };
+	state.ball = { 0, 0, to_fixed(MATCH_BALL_SIZE), to_fixed(MATCH_BALL_SIZE) };
+	reset_positions(state);
+
+	// Make the ball go towards a random direction at the start of the match.
+	state.ball_velocity_x = to_fixed(MATCH_BALL_START_SPEED) * random_direction(state);
+	state.ball_velocity_y = to_fixed(MATCH_BALL_START_SPEED) * random_direction(state);
+
+	return state;
+}
+
+void reset_positions(MatchState& state) {
+	state.player_1.y = state.player_2.y = to_fixed((MATCH_HEIGHT / 2) - (MATCH_PADDLE_HEIGHT / 2));
+
+	state.ball.x = to_fixed(MATCH_WIDTH / 2) - (state.ball.w / 2);
+	state.ball.y = to_fixed(MATCH_HEIGHT / 2) - (state.ball.h / 2);
+}
+
+// Up first and then down, so the server and the client's replays of the same inputs end up at the exact same position.
+void move_paddle(MatchRect& paddle, const PaddleInput& input) {
+	if (input.up && paddle.y > 0)
+		paddle.y -= to_fixed(MATCH_PADDLE_SPEED);
+
+	if (input.down && paddle.y + paddle.h < to_fixed(MATCH_HEIGHT))
+		paddle.y += to_fixed(MATCH_PADDLE_SPEED);
+}
+
+// A simple AI that just follows the ball, works for either paddle. Only needs the state, so the rollback harness and MatchBatch use it for their bots. PaddleAi is the one people play against.
+PaddleInput get_ai_input(const MatchState& state, const MatchRect& paddle) {
+	PaddleInput input;
+
+	if (state.ball.y + state.ball.h / 2 > paddle.y + state.ball.h / 2) // Move down if the middle of the ball is below middle of the paddle.
+		input.down = true;
+	else if (state.ball.y + state.ball.h / 2 < paddle.y + paddle.h / 2) // Move up if the middle of the ball is above middle of the paddle.
+		input.up = true;
+
+	return input;
+}
+
+// One tick of the match. Doesn't touch anything but the state it returns, so the same state and inputs always give the same result.
+MatchState step(const MatchState& state, const MatchInputs& inputs) {
+	MatchState next = state;
+	if (next.has_ended)
+		return next;
+
+	next.has_ball_event = false;
+	next.events = 0;
+
+	move_paddle(next.player_1, inputs.player_1);
+	move_paddle(next.player_2, inputs.player_2);
+
+	next.tick++;
+
+	if (next.tick == 1)
+		note_ball_event(next, BallEventType::SERVE);
+
+	// Practice mode's wall is lined up with the ball before it moves, so it's in the way wherever the ball goes.
+	if (next.player_2_follows_ball)
+		next.player_2.y = next.ball.y;
+
+	move_ball(next);
+
+	if (next.ball.x + next.ball.w >= to_fixed(MATCH_WIDTH)) {
+		next.player_1_score++;
+		start_new_round(next, true);
+	}
+
+	if (next.ball.x <= 0) {
+		next.player_2_score++;
+		start_new_round(next, false);
+	}
+
+	return next;
+}
+
+// Where the ball is and where it's going at the end of the latest step, for sending to the client.
+BallEventMessage make_ball_event(const MatchState& state, BallEventType type) {
+	BallEventMessage event;
+	event.type = type;
+	event.tick = state.tick;
+	event.x = state.ball.x;
+	event.y = state.ball.y;
+	event.velocity_x = state.ball_velocity_x;
+	event.velocity_y = state.ball_velocity_y;
+	return event;
+}
+
+#define XXH32_PRIME_1 0x9E3779B1u
+#define XXH32_PRIME_2 0x85EBCA77u
+#define XXH32_PRIME_3 0xC2B2AE3Du
+#define XXH32_PRIME_4 0x27D4EB2Fu
+#define XXH32_PRIME_5 0x165667B1u
+
+static uint32_t rotate_left(uint32_t value, int bits) {
+	return (value << bits) | (value >> (32 - bits));
+}
+
+static uint32_t xxh32_round(uint32_t accumulator, uint32_t lane) {
+	return rotate_left(accumulator + lane * XXH32_PRIME_2, 13) * XXH32_PRIME_1;
+}
+
+// XXH32 of the words (as if they were laid out little endian), seed 0. Always gets a multiple of 4 words from hash_match_state, so there's no tail of single bytes to handle.
+static uint32_t xxh32(const uint32_t* words, int word_count) {
+	uint32_t accumulators[4] = { XXH32_PRIME_1 + XXH32_PRIME_2, XXH32_PRIME_2, 0, 0u - XXH32_PRIME_1 };
+
+	int i = 0;
+	for (; i + 4 <= word_count; i += 4) {
+		for (int lane = 0; lane < 4; lane++)
+			accumulators[lane] = xxh32_round(accumulators[lane], words[i + lane]);
+	}
+
+	uint32_t hash = (word_count >= 4) ? rotate_left(accumulators[0], 1) + rotate_left(accumulators[1], 7) + rotate_left(accumulators[2], 12) + rotate_left(accumulators[3], 18) : XXH32_PRIME_5;
+	hash += static_cast<uint32_t>(word_count) * 4;
+
+	for (; i < word_count; i++)
+		hash = rotate_left(hash + words[i] * XXH32_PRIME_3, 17) * XXH32_PRIME_4;
+
+	hash ^= hash >> 15;
+	hash *= XXH32_PRIME_2;
+	hash ^= hash >> 13;
+	hash *= XXH32_PRIME_3;
+	hash ^= hash >> 16;
+	return hash;
+}
+
+// Cheap enough to do every tick. Two sides that stepped the same match with the same inputs get the same hash, so comparing these is how a desync gets caught on the tick it happens.
+// Goes field by field instead of hashing the struct's memory, as the padding in between the fields could be anything.
+uint32_t hash_match_state(const MatchState& state) {
+	uint32_t words[16] = {
+		static_cast<uint32_t>(state.player_1.x), static_cast<uint32_t>(state.player_1.y),
+		static_cast<uint32_t>(state.player_2.x), static_cast<uint32_t>(state.player_2.y),
+		static_cast<uint32_t>(state.ball.x), static_cast<uint32_t>(state.ball.y),
+		static_cast<uint32_t>(state.ball_velocity_x), static_cast<uint32_t>(state.ball_velocity_y),
+		static_cast<uint32_t>(state.player_1_score), static_cast<uint32_t>(state.player_2_score),
+		static_cast<uint32_t>(state.end_score), static_cast<uint32_t>(state.ball_hit_count),
+		state.tick, state.random_state,
+		static_cast<uint32_t>(state.has_ended), static_cast<uint32_t>(state.player_2_follows_ball)
+	};
+
+	return xxh32(words, 16);
+}
@@ -0,0 +1,105 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <type_traits>
+#include "protocol.hpp"
+
+#define SIMULATION_STEP_MS (1000.0 / 60.0) // The server ticks 60 times per second.
+
+// The size of everything in a match, in pixels. These have to match App's window and the sprites in sprites/, Game draws the sprites at these sizes.
+#define MATCH_WIDTH 1000
+#define MATCH_HEIGHT 800
+#define MATCH_PADDLE_WIDTH 20
+#define MATCH_PADDLE_HEIGHT 120
+#define MATCH_PADDLE_MARGIN 5 // Gap between the paddles and the sides of the screen.
+#define MATCH_BALL_SIZE 20
+#define MATCH_BALL_START_SPEED 5
+#define MATCH_PADDLE_SPEED 5
+
+/*
+Positions and velocities in a match are fixed-point, with FIXED_ONE being a pixel, so nothing in step() ever touches a float and both sides of a connection end up with the same bits.
+The paddles move by whole pixels, but the ball speeds up by a fraction of one with every hit, so it ends up between pixels. The ball goes over the wire in fixed-point as it is, and the paddles in pixels.
+*/
+#define FIXED_SHIFT 8
+#define FIXED_ONE (1 << FIXED_SHIFT)
+
+static_assert(FIXED_SHIFT == BALL_FRACTION_BITS, "The ball goes over the wire with the match's own fixed-point.");
+
+#define MATCH_BALL_SPEED_UP (FIXED_ONE / 3) // How much faster the ball gets with every hit, both ways, in fixed-point. Adds up to about a pixel every three hits.
+
+constexpr int to_fixed(int pixels) {
+	return pixels * FIXED_ONE;
+}
+
+// Rounds to the closest pixel.
+constexpr int to_pixels(int fixed) {
+	return (fixed + FIXED_ONE / 2) >> FIXED_SHIFT;
+}
+
+// What happened during a step, so whoever is watching the match can play sounds for it. Cleared at the start of every step.
+#define MATCH_EVENT_TOP_WALL_BOUNCE 1
+#define MATCH_EVENT_BOTTOM_WALL_BOUNCE 2
+#define MATCH_EVENT_PLAYER_1_HIT 4
+#define MATCH_EVENT_PLAYER_2_HIT 8
+#define MATCH_EVENT_PLAYER_1_SCORED 16
+#define MATCH_EVENT_PLAYER_2_SCORED 32
+
+// In fixed-point, see FIXED_ONE.
+struct MatchRect {
+	int x = 0;
+	int y = 0;
+	int w = 0;
+	int h = 0;
+};
+
+struct PaddleInput {
+	bool up = false;
+	bool down = false;
+};
+
+struct MatchInputs {
+	PaddleInput player_1;
+	PaddleInput player_2;
+};
+
+/*
+Everything the rules of a match need, without any rendering, audio, networking or OS stuff in it.
+Trivially copyable on purpose, so it can be copied around, saved and compared as plain memory. The random number generator lives in here too for that reason.
+Game renders and plays sounds from one of these, and the headless server runs one per match.
+*/
+struct MatchState {
+	MatchRect player_1;
+	MatchRect player_2;
+	MatchRect ball;
+
+	int ball_velocity_x = to_fixed(MATCH_BALL_START_SPEED);
+	int ball_velocity_y = to_fixed(MATCH_BALL_START_SPEED);
+
+	int player_1_score = 0;
+	int player_2_score = 0;
+	int end_score = 10;
+
+	int ball_hit_count = 0;
+	uint32_t tick = 0; // How many times the ball has moved since the match started.
+	uint32_t random_state = 1; // xorshift32, never 0.
+	bool has_ended = false;
+	bool player_2_follows_ball = false; // Practice mode, player 2 is a wall that's always wherever the ball is.
+
+	// The most important thing that happened to the ball during the last step, what the server lets the client know about.
+	bool has_ball_event = false;
+	BallEventType ball_event_type = BallEventType::CORRECTION;
+
+	uint8_t events = 0; // MATCH_EVENT_ flags for the last step.
+};
+
+static_assert(std::is_trivially_copyable<MatchState>::value, "MatchState has to stay trivially copyable.");
+
+MatchState create_match(int end_score, uint32_t seed, bool player_2_follows_ball = false);
+MatchState step(const MatchState& state, const MatchInputs& inputs);
+void move_paddle(MatchRect& paddle, const PaddleInput& input);
+void reset_positions(MatchState& state);
+PaddleInput get_ai_input(const MatchState& state, const MatchRect& paddle);
+BallEventMessage make_ball_event(const MatchState& state, BallEventType type);
+uint32_t hash_match_state(const MatchState& state);
@@ -0,0 +1,294 @@
+#include "network_thread.hpp"
+
+double get_network_time() {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+double get_receive_error_backoff_ms(int error_streak) {
+	double backoff_ms = RECEIVE_ERROR_BACKOFF_MIN_MS;
+	for (int i = 1; i < error_streak && backoff_ms < RECEIVE_ERROR_BACKOFF_MAX_MS; i++)
+		backoff_ms *= 2.0;
+
+	return std::min(backoff_ms, RECEIVE_ERROR_BACKOFF_MAX_MS);
+}
+
+DropCounter::DropCounter(const char* reason_param) {
+	reason = reason_param;
+}
+
+void DropCounter::count(double now, int error_code) {
+	total_count++;
+	unlogged_count++;
+
+	if (has_logged && now - last_log_time < DROP_LOG_INTERVAL_MS)
+		return;
+
+	std::cerr << reason << " " << unlogged_count << " times since the last warning, " << total_count << " in total";
+	if (error_code != 0)
+		std::cerr << ", last error: " << error_code;
+	std::cerr << "." << "\n";
+	unlogged_count = 0;
+	last_log_time = now;
+	has_logged = true;
+}
+
+// The socket has to be non-blocking and already set up (bound for the server) by the time it gets here.
+NetworkThread::NetworkThread(SOCKET sock_param, const SOCKADDR_IN& connection_data_param, std::string type_param, const MatchSetup& match_setup_param, TransportBackend backend) {
+	sock = sock_param;
+	connection_data = connection_data_param;
+	type = type_param;
+	match_setup = match_setup_param;
+
+	auto now = std::chrono::steady_clock::now();
+
+	if (type == "server") {
+		handshake_state = HandshakeState::AWAITING_SYN;
+		handshake_deadline = now + std::chrono::milliseconds(SERVER_HANDSHAKE_TIMEOUT_MS);
+	}
+	else if (type == "client") {
+		handshake_state = HandshakeState::AWAITING_SYN_ACK;
+		handshake_deadline = now + std::chrono::milliseconds(CLIENT_HANDSHAKE_TIMEOUT_MS);
+		next_syn_time = now;
+	}
+
+	transport = create_transport(backend);
+	if (!transport || !transport->open(sock)) {
+		if (transport)
+			std::cerr << "Couldn't set up the requested transport, falling back to the default one. Last error: " << transport->last_error << "\n";
+
+		transport = create_transport(get_default_transport_backend());
+		if (!transport->open(sock)) {
+			std::cerr << "Couldn't set up a transport for the socket: " << transport->last_error << "\n";
+			fail_handshake(transport->last_error);
+		}
+	}
+
+	is_running = true;
+	thread = std::thread(&NetworkThread::run, this);
+}
+
+// Joins the thread and closes the transport, the socket still belongs to ConnectionManager and has to be closed there afterwards.
+NetworkThread::~NetworkThread() {
+	is_running = false;
+
+	if (thread.joinable())
+		thread.join();
+
+	transport.reset();
+}
+
+// Only safe to call once handshake_state is CONNECTED. The network thread doesn't touch match_setup after that, and setting handshake_state is what publishes it to the game's thread.
+MatchSetup NetworkThread::get_match_setup() {
+	return match_setup;
+}
+
+// The transport blocks for at most NETWORK_POLL_INTERVAL_US, so outgoing datagrams never wait much longer than that before they're sent.
+void NetworkThread::run() {
+	while (is_running) {
+		HandshakeState state = handshake_state;
+
+		if (state == HandshakeState::FAILED) { // Nothing left to do but wait for ConnectionManager to stop us.
+			std::this_thread::sleep_for(std::chrono::microseconds(NETWORK_POLL_INTERVAL_US));
+			continue;
+		}
+
+		if (state == HandshakeState::AWAITING_SYN_ACK)
+			send_syn_if_due();
+
+		int count = transport->receive(receive_batch, TRANSPORT_BATCH_SIZE, NETWORK_POLL_INTERVAL_US);
+
+		if (count == SOCKET_ERROR)
+			handle_receive_error(transport->last_error);
+		else {
+			receive_error_streak = 0;
+			double arrival_time = get_network_time();
+
+			for (int i = 0; i < count; i++) {
+				receive_batch[i].arrival_time = arrival_time;
+				handle_datagram(receive_batch[i]);
+			}
+		}
+
+		state = handshake_state;
+		if (state == HandshakeState::CONNECTED)
+			send_all();
+		else if ((state == HandshakeState::AWAITING_SYN || state == HandshakeState::AWAITING_SYN_ACK) && std::chrono::steady_clock::now() >= handshake_deadline) {
+			std::cout << "Handshake timeout." << "\n";
+			fail_handshake((state == HandshakeState::AWAITING_SYN) ? 9999 : 8888);
+		}
+	}
+}
+
+void NetworkThread::handle_receive_error(int error_code) {
+	if (error_code == WSAECONNRESET) {
+		// During the handshake this just means that the server isn't up yet and our SYN bounced, we'll try again.
+		if (handshake_state != HandshakeState::CONNECTED)
+			return;
+
+		Datagram reset;
+		reset.length = RECEIVE_CONNRESET;
+		reset.arrival_time = get_network_time();
+		incoming_queue.push(reset);
+		return;
+	}
+
+	receive_errors.count(get_network_time(), error_code);
+
+	receive_error_streak++;
+	std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(get_receive_error_backoff_ms(receive_error_streak)));
+}
+
+// Datagrams are stamped with the time they came in before they get here, so the game's jitter estimates don't include however long the frame took.
+void NetworkThread::handle_datagram(Datagram& datagram) {
+	switch (handshake_state) {
+		case HandshakeState::AWAITING_SYN:
+			handle_syn(datagram);
+			break;
+		case HandshakeState::AWAITING_SYN_ACK:
+			handle_syn_ack(datagram);
+			break;
+		case HandshakeState::CONNECTED:
+			if (!accept_datagram(datagram))
+				break;
+
+			if (!incoming_queue.push(datagram)) // The game isn't keeping up. Dropping is fine, it's what the network would have done anyway.
+				incoming_drops.count(datagram.arrival_time);
+			break;
+		default:
+			break;
+	}
+}
+
+void NetworkThread::fail_handshake(int error_code) {
+	handshake_error = error_code;
+	handshake_state = HandshakeState::FAILED;
+}
+
+/*
+The handshake does something that's quite similar to the three-way handshake method of a TCP connection: the client sends a SYN, the server answers with a SYN-ACK and the client acknowledges that with an ACK.
+It runs on the network thread, the game only looks at handshake_state once per frame so it keeps rendering (and can be cancelled) in the meantime.
+*/
+
+void NetworkThread::handle_syn(const Datagram& datagram) { // This will be used by the server.
+	if (datagram.length < CONNECTION_ID_LENGTH || !decode_handshake(datagram.data + CONNECTION_ID_LENGTH, datagram.length - CONNECTION_ID_LENGTH, MessageType::SYN)) { // Keep waiting, a stray datagram shouldn't take the server down.
+		stray_datagrams.count(datagram.arrival_time);
+		return;
+	}
+
+	connection_data = datagram.address; // We set the first connected client as the only suitable connector from now on here.
+
+	// Anything random and non-zero will do, it only has to be hard to guess for someone who isn't the client.
+	std::random_device random_device;
+	do {
+		connection_id = random_device();
+	} while (connection_id == NO_CONNECTION_ID);
+
+	match_setup.seed = random_device();
+
+	// Let the client know that we received their message. If this gets lost, the client will send its SYN again and accept_datagram will answer it.
+	if (!send_handshake(MessageType::SYN_ACK)) {
+		std::cerr << "Error occured while sending SYN-ACK to client: " << transport->last_error << "\n";
+		fail_handshake(transport->last_error);
+		return;
+	}
+
+	std::cout << "Connected successfully!" << "\n";
+	handshake_state = HandshakeState::CONNECTED;
+}
+
+void NetworkThread::handle_syn_ack(const Datagram& datagram) { // This will be used by the client.
+	MatchSetup decoded_setup;
+	if (datagram.length < CONNECTION_ID_LENGTH)
+		return;
+
+	const uint8_t* message = datagram.data + CONNECTION_ID_LENGTH;
+	int message_length = datagram.length - CONNECTION_ID_LENGTH;
+
+	// Only a server that answers with a different version of the protocol is worth giving up on. Anything else we can't make sense of (stray traffic, something mangled on the way) is ignored, and the SYN keeps being resent until the right SYN-ACK comes in or the handshake times out.
+	uint32_t version = PROTOCOL_VERSION;
+	if (read_handshake_version(message, message_length, version) && version != PROTOCOL_VERSION) {
+		std::cerr << "Server runs dingdong protocol v" << version << ", we need v" << PROTOCOL_VERSION << "." << "\n";
+		fail_handshake(7777);
+		return;
+	}
+
+	if (read_connection_id(datagram.data) == NO_CONNECTION_ID || !decode_handshake(message, message_length, MessageType::SYN_ACK, &decoded_setup))
+		return;
+
+	connection_id = read_connection_id(datagram.data);
+	connection_data = datagram.address;
+	match_setup = decoded_setup;
+	send_handshake(MessageType::ACK);
+
+	std::cout << "Successfully connected to the server!" << "\n";
+	handshake_state = HandshakeState::CONNECTED;
+}
+
+// (Re)sends the SYN with exponential backoff until the server answers.
+void NetworkThread::send_syn_if_due() {
+	auto now = std::chrono::steady_clock::now();
+	if (now < next_syn_time)
+		return;
+
+	if (!send_handshake(MessageType::SYN) && transport->last_error != WSAECONNRESET) {
+		std::cerr << "Error occured while attempting to send SYN to server: " << transport->last_error << "\n";
+		fail_handshake(transport->last_error);
+		return;
+	}
+
+	next_syn_time = now + syn_retransmit_interval;
+	syn_retransmit_interval = std::min(syn_retransmit_interval * 2, std::chrono::milliseconds(SYN_MAX_RETRANSMIT_MS));
+}
+
+bool NetworkThread::send_handshake(MessageType message_type) {
+	Datagram datagram;
+	write_connection_id(datagram.data, connection_id);
+	datagram.length = CONNECTION_ID_LENGTH + encode_handshake(message_type, datagram.data + CONNECTION_ID_LENGTH, MAX_PACKET_LENGTH, match_setup);
+	datagram.address = connection_data;
+
+	return transport->send(&datagram, 1);
+}
+
+static bool is_same_address(const SOCKADDR_IN& a, const SOCKADDR_IN& b) {
+	return a.sin_addr.s_addr == b.sin_addr.s_addr && a.sin_port == b.sin_port;
+}
+
+// Drops every datagram that doesn't carry this connection's ID. Whoever sends one that does becomes who we answer from then on, so the game keeps going if the other side's address changes (a NAT giving it a new port, for example).
+bool NetworkThread::accept_datagram(const Datagram& datagram) {
+	if (datagram.length < CONNECTION_ID_LENGTH)
+		return false;
+
+	uint32_t datagram_connection_id = read_connection_id(datagram.data);
+
+	if (datagram_connection_id == connection_id) {
+		connection_data = datagram.address;
+		return true;
+	}
+
+	// The client didn't get our SYN-ACK and is trying again.
+	if (type == "server" && datagram_connection_id == NO_CONNECTION_ID && is_same_address(datagram.address, connection_data) && decode_handshake(datagram.data + CONNECTION_ID_LENGTH, datagram.length - CONNECTION_ID_LENGTH, MessageType::SYN))
+		send_handshake(MessageType::SYN_ACK);
+
+	return false;
+}
+
+// Sends everything the game pushed into outgoing_queue, TRANSPORT_BATCH_SIZE datagrams per call into the transport.
+void NetworkThread::send_all() {
+	while (true) {
+		int count = 0;
+		while (count < TRANSPORT_BATCH_SIZE && outgoing_queue.pop(send_batch[count])) {
+			write_connection_id(send_batch[count].data, connection_id); // ConnectionManager leaves room for it in front of the message.
+			send_batch[count].address = connection_data;
+			count++;
+		}
+
+		if (count == 0)
+			return;
+
+		if (!transport->send(send_batch, count))
+			std::cerr << "Error while sending data: " << transport->last_error << "\n";
+
+		if (count < TRANSPORT_BATCH_SIZE)
+			return;
+	}
+}
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <random>
+#include "socket_platform.hpp"
+#include "protocol.hpp"
+#include "spsc_queue.hpp"
+#include "transport.hpp"
+
+// The server waits this long for someone to connect, the client this long for the server to answer.
+#define SERVER_HANDSHAKE_TIMEOUT_MS 60000
+#define CLIENT_HANDSHAKE_TIMEOUT_MS 10000
+
+// Something that can go wrong on every single datagram (a full queue, a full server, a receive error) is only written out this often, with how many times it happened since.
+#define DROP_LOG_INTERVAL_MS 5000.0
+
+// A receive that fails with anything but a reset makes whoever owns the socket wait this long before the next one, twice as long for every failure in a row after that up to the maximum, so a socket that's gone bad isn't retried in a tight loop.
+#define RECEIVE_ERROR_BACKOFF_MIN_MS 1.0
+#define RECEIVE_ERROR_BACKOFF_MAX_MS 250.0
+
+// The client resends its SYN if the server doesn't answer in time, waiting twice as long every time up to the maximum.
+#define SYN_INITIAL_RETRANSMIT_MS 250
+#define SYN_MAX_RETRANSMIT_MS 2000
+
+// How many datagrams can be waiting in each direction between the network thread and the game.
+#define NETWORK_QUEUE_SIZE 256
+
+// How long the network thread waits for datagrams to come in before checking for outgoing datagrams again.
+#define NETWORK_POLL_INTERVAL_US 1000
+
+enum class HandshakeState {
+	IDLE,
+	AWAITING_SYN, // Server, waiting for someone to connect.
+	AWAITING_SYN_ACK, // Client, waiting for the server to answer.
+	CONNECTED,
+	FAILED
+};
+
+// Milliseconds on a steady clock. Arrival times of datagrams are on this clock, so anything that compares against them should be too.
+double get_network_time();
+
+// How long to wait before receiving again after error_streak failed receives in a row.
+double get_receive_error_backoff_ms(int error_streak);
+
+// Counts how many datagrams got dropped (or receives failed) for one reason, and only logs it every DROP_LOG_INTERVAL_MS so that a flood of them doesn't turn into a flood of std::cerr writes on a hot path.
+// Only ever touched by one thread, like whatever owns it.
+class DropCounter {
+	private:
+		const char* reason = "";
+		uint64_t unlogged_count = 0;
+		double last_log_time = 0.0;
+		bool has_logged = false;
+	public:
+		uint64_t total_count = 0;
+
+		DropCounter(const char* reason_param);
+		void count(double now, int error_code = 0); // The error code, if there is one, is logged with the count.
+};
+
+// Opens a transport for a socket that's already set up and owns all the I/O on it from then on: runs the handshake, then drains the socket into incoming_queue and sends whatever gets pushed into outgoing_queue, all on its own thread.
+// Falls back to the default transport backend if the one it was asked for isn't available.
+class NetworkThread {
+	private:
+		std::thread thread;
+		std::atomic<bool> is_running{ false };
+
+		SOCKET sock = INVALID_SOCKET;
+		std::string type;
+		std::unique_ptr<Transport> transport;
+
+		// This is where we'll be storing the parameters for the connection that's made.
+		SOCKADDR_IN connection_data;
+
+		uint32_t connection_id = NO_CONNECTION_ID; // Picked by the server when it gets the SYN, and learned by the client from the SYN-ACK.
+		MatchSetup match_setup; // Same as connection_id, except that the server only picks the seed and gets the rest from the game.
+
+		std::chrono::steady_clock::time_point handshake_deadline;
+		std::chrono::steady_clock::time_point next_syn_time;
+		std::chrono::milliseconds syn_retransmit_interval{ SYN_INITIAL_RETRANSMIT_MS };
+
+		// Preallocated once, the transport receives straight into receive_batch and sends straight out of send_batch.
+		Datagram receive_batch[TRANSPORT_BATCH_SIZE];
+		Datagram send_batch[TRANSPORT_BATCH_SIZE];
+
+		DropCounter incoming_drops{ "Incoming queue is full, dropping datagrams." };
+		DropCounter receive_errors{ "Unhandled error while receiving data." };
+		DropCounter stray_datagrams{ "Someone sent something that isn't a dingdong SYN, ignoring it." };
+		int receive_error_streak = 0;
+
+		void run();
+		void handle_receive_error(int error_code);
+		void handle_datagram(Datagram& datagram);
+		void handle_syn(const Datagram& datagram);
+		void handle_syn_ack(const Datagram& datagram);
+		void send_syn_if_due();
+		bool send_handshake(MessageType message_type);
+		bool accept_datagram(const Datagram& datagram);
+		void fail_handshake(int error_code);
+		void send_all();
+	public:
+		std::atomic<HandshakeState> handshake_state{ HandshakeState::IDLE };
+		std::atomic<int> handshake_error{ 0 }; // Set when the handshake fails, same codes as ConnectionManager::init returns.
+
+		SpscQueue<Datagram, NETWORK_QUEUE_SIZE> incoming_queue;
+		SpscQueue<Datagram, NETWORK_QUEUE_SIZE> outgoing_queue;
+
+		NetworkThread(SOCKET sock_param, const SOCKADDR_IN& connection_data_param, std::string type_param, const MatchSetup& match_setup_param = MatchSetup(), TransportBackend backend = get_default_transport_backend());
+		~NetworkThread();
+		MatchSetup get_match_setup();
+};
@@ -4,20 +4,11 @@
 #include <string>
 #include "sprite.hpp"
 
-enum class MoveDirection {
-	UP,
-	DOWN
-};
-
+// Only what a paddle looks like. Where it is and how it moves is up to MatchState.
 class Paddle {
 	public:
 		Sprite sprite;
-
-		int screen_height = 0;
-
-		const static int paddle_speed = 5;
 		
 		Paddle() {};
-		Paddle(int screen_height_param, std::string image_path, SDL_Renderer* renderer);
-		void move(MoveDirection direction, int pixels = paddle_speed);
+		Paddle(std::string image_path, SDL_Renderer* renderer);
 };
\ No newline at end of file
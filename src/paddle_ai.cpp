@@ -0,0 +1,151 @@
+#include "paddle_ai.hpp"
+
+AiSettings get_ai_settings(AiDifficulty difficulty) {
+	AiSettings settings;
+
+	switch (difficulty) {
+		case AiDifficulty::EASY: // A third of a second behind, a bit slower than it could be, and misses about one in seven balls it could have reached.
+			settings.reaction_ticks = 20;
+			settings.max_error = 100;
+			settings.max_speed = 4;
+			break;
+		case AiDifficulty::HARD: // Never misses, until the ball gets faster than a paddle can move.
+		case AiDifficulty::EXPERT: // LookaheadAi plays like this while it has no plan.
+			settings.reaction_ticks = 2;
+			settings.max_error = 10;
+			settings.max_speed = MATCH_PADDLE_SPEED;
+			break;
+		default: // Only misses a ball it could have reached once in a while.
+			settings.reaction_ticks = 8;
+			settings.max_error = 75;
+			settings.max_speed = MATCH_PADDLE_SPEED;
+			break;
+	}
+
+	return settings;
+}
+
+bool parse_ai_difficulty(const std::string& name, AiDifficulty& difficulty) {
+	if (name == "easy")
+		difficulty = AiDifficulty::EASY;
+	else if (name == "normal")
+		difficulty = AiDifficulty::NORMAL;
+	else if (name == "hard")
+		difficulty = AiDifficulty::HARD;
+	else if (name == "expert")
+		difficulty = AiDifficulty::EXPERT;
+	else
+		return false;
+
+	return true;
+}
+
+const char* get_ai_difficulty_name(AiDifficulty difficulty) {
+	switch (difficulty) {
+		case AiDifficulty::EASY:
+			return "easy";
+		case AiDifficulty::HARD:
+			return "hard";
+		case AiDifficulty::EXPERT:
+			return "expert";
+		default:
+			return "normal";
+	}
+}
+
+void PaddleAi::init(const AiSettings& settings_param, int player_param, uint32_t seed) {
+	*this = PaddleAi();
+	settings = settings_param;
+	player = player_param;
+	random_state = (seed == 0) ? 1 : seed;
+	move_budget = to_fixed(MATCH_PADDLE_SPEED);
+}
+
+// Somewhere in -max_error to max_error pixels, in fixed-point.
+int PaddleAi::get_error() {
+	if (settings.max_error <= 0)
+		return 0;
+
+	// xorshift32, same as next_random in match_simulation.cpp.
+	random_state ^= random_state << 13;
+	random_state ^= random_state >> 17;
+	random_state ^= random_state << 5;
+
+	return to_fixed(static_cast<int>(random_state % static_cast<uint32_t>(2 * settings.max_error + 1)) - settings.max_error);
+}
+
+bool is_ball_heading_for(const MatchState& state, int player) {
+	return (player == 1) ? state.ball_velocity_x < 0 : state.ball_velocity_x > 0;
+}
+
+// Where the middle of the ball will be when it gets to the front of the player's paddle, if nothing but the walls gets in its way. Only makes sense while the ball is heading for that paddle.
+int predict_ball_crossing_y(const MatchState& state, int player) {
+	const MatchRect& paddle = (player == 1) ? state.player_1 : state.player_2;
+	int goal_direction = (player == 1) ? -1 : 1;
+
+	// How far the ball has to go sideways, and so how far it goes up or down on the way there if there were no walls. Already past the front of the paddle counts as there.
+	int front_x = (player == 1) ? paddle.x + paddle.w : paddle.x - state.ball.w;
+	int64_t distance_x = std::max<int64_t>(static_cast<int64_t>(front_x - state.ball.x) * goal_direction, 0);
+	int64_t unfolded_y = state.ball.y + distance_x * std::abs(state.ball_velocity_y) / std::abs(state.ball_velocity_x) * ((state.ball_velocity_y < 0) ? -1 : 1);
+
+	// Every wall bounce mirrors the rest of the way, so the walls repeat every two field heights and the second one is upside down.
+	int64_t range = to_fixed(MATCH_HEIGHT) - state.ball.h;
+	int64_t folded_y = unfolded_y % (2 * range);
+	if (folded_y < 0)
+		folded_y += 2 * range;
+	if (folded_y > range)
+		folded_y = 2 * range - folded_y;
+
+	return static_cast<int>(folded_y) + state.ball.h / 2;
+}
+
+// Where the middle of the ball will be when it gets to the paddle, give or take the error, or the middle of the field if it's going the other way.
+int PaddleAi::predict_target_y(const MatchState& state) {
+	prediction_count++;
+
+	if (!is_ball_heading_for(state, player))
+		return to_fixed(MATCH_HEIGHT / 2);
+
+	return predict_ball_crossing_y(state, player) + get_error();
+}
+
+PaddleInput PaddleAi::get_input(const MatchState& state) {
+	const MatchRect& paddle = (player == 1) ? state.player_1 : state.player_2;
+
+	// Wall bounces are already part of the prediction, anything else that happened to the ball sends it somewhere new.
+	bool has_trajectory_changed = !has_last_tick || state.tick != last_tick + 1 || (state.has_ball_event && state.ball_event_type != BallEventType::WALL_BOUNCE);
+	has_last_tick = true;
+	last_tick = state.tick;
+
+	if (has_trajectory_changed) {
+		pending_target_y = predict_target_y(state);
+
+		// A change it hasn't reacted to yet doesn't push the reaction back, it just reacts to the newer one.
+		if (!has_pending_target)
+			reaction_tick = state.tick + settings.reaction_ticks;
+
+		has_pending_target = true;
+	}
+
+	if (has_pending_target && state.tick >= reaction_tick) {
+		target_y = pending_target_y;
+		has_pending_target = false;
+	}
+
+	// Whatever's left over after a move carries on to the next one, but sitting still doesn't save up for more than one move.
+	move_budget = std::min(move_budget + to_fixed(settings.max_speed), to_fixed(MATCH_PADDLE_SPEED + settings.max_speed));
+
+	// Close enough is within half a move, otherwise it would keep going back and forth past the target.
+	PaddleInput input;
+	int distance = target_y - (paddle.y + paddle.h / 2);
+	if (std::abs(distance) <= to_fixed(MATCH_PADDLE_SPEED) / 2 || move_budget < to_fixed(MATCH_PADDLE_SPEED))
+		return input;
+
+	if (distance > 0)
+		input.down = true;
+	else
+		input.up = true;
+
+	move_budget -= to_fixed(MATCH_PADDLE_SPEED);
+	return input;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <algorithm>
+#include <string>
+#include "match_simulation.hpp"
+
+enum class AiDifficulty {
+	EASY,
+	NORMAL,
+	HARD,
+	EXPERT // Single player only, see LookaheadAi.
+};
+
+#define DEFAULT_AI_DIFFICULTY AiDifficulty::NORMAL
+
+// What makes one AI harder to beat than another. Any mix of these works, get_ai_settings has the ones the difficulties use.
+struct AiSettings {
+	int reaction_ticks = 0; // How long it takes to notice that the ball's going somewhere else.
+	int max_error = 0; // The furthest off its guess of where the ball will be can get, in pixels.
+	int max_speed = MATCH_PADDLE_SPEED; // Pixels per tick on average, anything below MATCH_PADDLE_SPEED makes it skip some ticks.
+};
+
+/*
+A computer player that works out where the ball will cross its paddle instead of chasing wherever the ball is right now.
+The ball flies in a straight line between bounces and the walls just mirror it, so where it gets to the paddle is one division and one fold away, no matter how far it has to go.
+That's only worked out again when the ball's trajectory changes (a paddle hit, a speed up, a serve), not on every tick, so each tick is a handful of comparisons. Wall bounces are already part of the prediction.
+Only ever fed one state per tick in order, like step() makes them. Anything else (a new match, a rewind that didn't bring the AI along) just counts as the trajectory changing.
+Trivially copyable and has its own random number generator, so the same states always give the same inputs and it can be saved alongside the match, see LagCompensator.
+*/
+class PaddleAi {
+	private:
+		AiSettings settings;
+		int player = 1; // Which paddle it plays.
+		uint32_t random_state = 1; // xorshift32, never 0.
+
+		bool has_last_tick = false;
+		uint32_t last_tick = 0;
+
+		int target_y = to_fixed(MATCH_HEIGHT / 2); // Where it's moving the middle of its paddle to.
+		bool has_pending_target = false; // A new prediction it hasn't reacted to yet.
+		int pending_target_y = 0;
+		uint32_t reaction_tick = 0; // When it reacts to the pending one.
+
+		int move_budget = 0; // Fixed-point pixels it's allowed to move, see AiSettings::max_speed.
+
+		int get_error();
+		int predict_target_y(const MatchState& state);
+	public:
+		uint32_t prediction_count = 0; // How many times it had to work out the trajectory again, for benchmarking.
+
+		void init(const AiSettings& settings_param, int player_param, uint32_t seed);
+		PaddleInput get_input(const MatchState& state);
+};
+
+bool is_ball_heading_for(const MatchState& state, int player);
+int predict_ball_crossing_y(const MatchState& state, int player);
+AiSettings get_ai_settings(AiDifficulty difficulty);
+bool parse_ai_difficulty(const std::string& name, AiDifficulty& difficulty);
+const char* get_ai_difficulty_name(AiDifficulty difficulty);
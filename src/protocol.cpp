@@ -0,0 +1,693 @@
+#include "protocol.hpp"
+
+BitWriter::BitWriter(uint8_t* buffer_param, int capacity_param) {
+	buffer = buffer_param;
+	capacity = capacity_param;
+}
+
+void BitWriter::write_bits(uint32_t value, int bits) {
+	if (bits < 32)
+		value &= (1u << bits) - 1;
+
+	scratch = (scratch << bits) | value;
+	scratch_bits += bits;
+
+	// Move every complete byte from the scratch into the buffer.
+	while (scratch_bits >= 8) {
+		scratch_bits -= 8;
+
+		if (bytes_written < capacity)
+			buffer[bytes_written++] = static_cast<uint8_t>(scratch >> scratch_bits);
+		else
+			overflowed = true;
+	}
+}
+
+void BitWriter::write_signed(int value, int bits) {
+	write_bits(static_cast<uint32_t>(value), bits); // Two's complement, the upper bits get masked off in write_bits.
+}
+
+// Pads the last byte with zeros and returns the length of the message in bytes.
+int BitWriter::finish() {
+	if (scratch_bits > 0) {
+		if (bytes_written < capacity)
+			buffer[bytes_written++] = static_cast<uint8_t>(scratch << (8 - scratch_bits));
+		else
+			overflowed = true;
+
+		scratch_bits = 0;
+	}
+
+	return overflowed ? -1 : bytes_written;
+}
+
+BitReader::BitReader(const uint8_t* buffer_param, int length_param) {
+	buffer = buffer_param;
+	length = length_param;
+}
+
+uint32_t BitReader::read_bits(int bits) {
+	while (scratch_bits < bits) {
+		if (bytes_read >= length) {
+			overflowed = true;
+			return 0;
+		}
+
+		scratch = (scratch << 8) | buffer[bytes_read++];
+		scratch_bits += 8;
+	}
+
+	scratch_bits -= bits;
+
+	uint64_t mask = (bits == 32) ? 0xFFFFFFFFull : ((1ull << bits) - 1);
+	return static_cast<uint32_t>((scratch >> scratch_bits) & mask);
+}
+
+int BitReader::read_signed(int bits) {
+	uint32_t value = read_bits(bits);
+
+	if (bits < 32 && (value & (1u << (bits - 1)))) // Sign extend.
+		value |= ~((1u << bits) - 1);
+
+	return static_cast<int32_t>(value);
+}
+
+bool BitReader::has_failed() {
+	return overflowed;
+}
+
+// fraction_bits is 0 for the paddles, which only move by whole pixels, and BALL_FRACTION_BITS for the ball.
+static uint32_t quantize_position(int position, int fraction_bits) {
+	return static_cast<uint32_t>(std::clamp(position + (POSITION_BIAS << fraction_bits), 0, (1 << (POSITION_BITS + fraction_bits)) - 1));
+}
+
+static int dequantize_position(uint32_t quantized_position, int fraction_bits) {
+	return static_cast<int>(quantized_position) - (POSITION_BIAS << fraction_bits);
+}
+
+static int clamp_position(int position, int fraction_bits) {
+	return dequantize_position(quantize_position(position, fraction_bits), fraction_bits);
+}
+
+static int clamp_velocity(int velocity) {
+	int bits = VELOCITY_BITS + BALL_FRACTION_BITS;
+	return std::clamp(velocity, -(1 << (bits - 1)), (1 << (bits - 1)) - 1);
+}
+
+static uint32_t clamp_score(int score) {
+	return static_cast<uint32_t>(std::clamp(score, 0, (1 << SCORE_BITS) - 1));
+}
+
+// Server clock readings go over the wire as signed fixed-point ticks, as the clock is below 0 during the countdown.
+static int32_t quantize_server_clock(double clock) {
+	double limit = static_cast<double>(1u << (SERVER_CLOCK_BITS - SERVER_CLOCK_FRACTION_BITS - 1));
+	return static_cast<int32_t>(std::lround(std::clamp(clock, -limit, limit - 1.0) * (1 << SERVER_CLOCK_FRACTION_BITS)));
+}
+
+static double dequantize_server_clock(int32_t quantized_clock) {
+	return static_cast<double>(quantized_clock) / (1 << SERVER_CLOCK_FRACTION_BITS);
+}
+
+static void write_header(BitWriter& writer, MessageType type) {
+	writer.write_bits(PROTOCOL_VERSION, VERSION_BITS);
+	writer.write_bits(static_cast<uint32_t>(type), MESSAGE_TYPE_BITS);
+}
+
+// Returns false if the header is from a different version of the protocol or isn't the type we expected.
+static bool read_header(BitReader& reader, MessageType expected_type) {
+	uint32_t version = reader.read_bits(VERSION_BITS);
+	uint32_t type = reader.read_bits(MESSAGE_TYPE_BITS);
+
+	return !reader.has_failed() && version == PROTOCOL_VERSION && type == static_cast<uint32_t>(expected_type);
+}
+
+void write_connection_id(uint8_t* datagram, uint32_t connection_id) {
+	datagram[0] = static_cast<uint8_t>(connection_id >> 24);
+	datagram[1] = static_cast<uint8_t>(connection_id >> 16);
+	datagram[2] = static_cast<uint8_t>(connection_id >> 8);
+	datagram[3] = static_cast<uint8_t>(connection_id);
+}
+
+uint32_t read_connection_id(const uint8_t* datagram) {
+	return (static_cast<uint32_t>(datagram[0]) << 24) | (static_cast<uint32_t>(datagram[1]) << 16) | (static_cast<uint32_t>(datagram[2]) << 8) | datagram[3];
+}
+
+bool peek_message_type(const uint8_t* buffer, int length, MessageType& type) {
+	BitReader reader(buffer, length);
+
+	uint32_t version = reader.read_bits(VERSION_BITS);
+	uint32_t raw_type = reader.read_bits(MESSAGE_TYPE_BITS);
+
+	if (reader.has_failed() || version != PROTOCOL_VERSION)
+		return false;
+
+	type = static_cast<MessageType>(raw_type);
+	return true;
+}
+
+int encode_handshake(MessageType type, uint8_t* buffer, int capacity, const MatchSetup& match_setup) {
+	BitWriter writer(buffer, capacity);
+
+	write_header(writer, type);
+	writer.write_bits(PROTOCOL_MAGIC, 16);
+
+	if (type == MessageType::SYN_ACK) {
+		writer.write_bits(match_setup.seed, MATCH_SEED_BITS);
+		writer.write_bits(clamp_score(match_setup.end_score), SCORE_BITS);
+		writer.write_bits(match_setup.is_rollback, 1);
+	}
+
+	return writer.finish();
+}
+
+bool decode_handshake(const uint8_t* buffer, int length, MessageType expected_type, MatchSetup* match_setup) {
+	BitReader reader(buffer, length);
+
+	if (!read_header(reader, expected_type))
+		return false;
+
+	uint32_t magic = reader.read_bits(16);
+
+	MatchSetup decoded;
+	if (expected_type == MessageType::SYN_ACK) {
+		decoded.seed = reader.read_bits(MATCH_SEED_BITS);
+		decoded.end_score = static_cast<int>(reader.read_bits(SCORE_BITS));
+		decoded.is_rollback = reader.read_bits(1);
+	}
+
+	if (reader.has_failed() || magic != PROTOCOL_MAGIC)
+		return false;
+
+	if (match_setup != nullptr)
+		*match_setup = decoded;
+
+	return true;
+}
+
+// Every version starts its handshake messages with the version, the type and PROTOCOL_MAGIC, so this can tell a dingdong of another version apart from a datagram that isn't from dingdong at all.
+bool read_handshake_version(const uint8_t* buffer, int length, uint32_t& version) {
+	BitReader reader(buffer, length);
+
+	uint32_t decoded_version = reader.read_bits(VERSION_BITS);
+	reader.read_bits(MESSAGE_TYPE_BITS);
+	uint32_t magic = reader.read_bits(16);
+
+	if (reader.has_failed() || magic != PROTOCOL_MAGIC)
+		return false;
+
+	version = decoded_version;
+	return true;
+}
+
+// A changed position is sent as a small delta if it can be, and in full otherwise.
+static void write_position_delta(BitWriter& writer, int position, int baseline_position, int fraction_bits) {
+	// Compare what the other side will actually end up with, not what we have.
+	position = clamp_position(position, fraction_bits);
+	baseline_position = clamp_position(baseline_position, fraction_bits);
+
+	int delta = position - baseline_position;
+	int small_delta_limit = 1 << (SMALL_DELTA_BITS - 1);
+
+	writer.write_bits(delta != 0, 1);
+	if (delta == 0)
+		return;
+
+	if (delta >= -small_delta_limit && delta < small_delta_limit) {
+		writer.write_bits(1, 1);
+		writer.write_signed(delta, SMALL_DELTA_BITS);
+	}
+	else {
+		writer.write_bits(0, 1);
+		writer.write_bits(quantize_position(position, fraction_bits), POSITION_BITS + fraction_bits);
+	}
+}
+
+static int read_position_delta(BitReader& reader, int baseline_position, int fraction_bits) {
+	if (!reader.read_bits(1))
+		return baseline_position;
+
+	if (reader.read_bits(1))
+		return baseline_position + reader.read_signed(SMALL_DELTA_BITS);
+	else
+		return dequantize_position(reader.read_bits(POSITION_BITS + fraction_bits), fraction_bits);
+}
+
+// Ticks only ever go forward, so a tick that advanced by less than 128 is sent as a small unsigned delta.
+static void write_tick_delta(BitWriter& writer, uint32_t tick, uint32_t baseline_tick) {
+	uint32_t delta = tick - baseline_tick;
+
+	writer.write_bits(delta != 0, 1);
+	if (delta == 0)
+		return;
+
+	if (delta < (1u << SMALL_DELTA_BITS)) {
+		writer.write_bits(1, 1);
+		writer.write_bits(delta, SMALL_DELTA_BITS);
+	}
+	else {
+		writer.write_bits(0, 1);
+		writer.write_bits(tick, TICK_BITS);
+	}
+}
+
+static uint32_t read_tick_delta(BitReader& reader, uint32_t baseline_tick) {
+	if (!reader.read_bits(1))
+		return baseline_tick;
+
+	if (reader.read_bits(1))
+		return baseline_tick + reader.read_bits(SMALL_DELTA_BITS);
+	else
+		return reader.read_bits(TICK_BITS);
+}
+
+// Everything else is either the same as in the baseline, or sent in full.
+static void write_field_delta(BitWriter& writer, int value, int baseline_value, int bits) {
+	writer.write_bits(value != baseline_value, 1);
+	if (value != baseline_value)
+		writer.write_signed(value, bits);
+}
+
+static int read_field_delta(BitReader& reader, int baseline_value, int bits, bool is_signed) {
+	if (!reader.read_bits(1))
+		return baseline_value;
+
+	return is_signed ? reader.read_signed(bits) : static_cast<int>(reader.read_bits(bits));
+}
+
+bool sequence_more_recent(uint16_t a, uint16_t b) {
+	return a != b && static_cast<uint16_t>(a - b) < 0x8000;
+}
+
+// count can be negative too. Going back from 1 ends up at 65535, never at 0.
+uint16_t advance_input_sequence(uint16_t sequence, int count) {
+	int index = (static_cast<int>(sequence) - 1 + count) % 0xFFFF;
+	if (index < 0)
+		index += 0xFFFF;
+
+	return static_cast<uint16_t>(index + 1);
+}
+
+// How many inputs after older newer is. 0, the input before the first one, is in the same place as 65535.
+int input_sequence_distance(uint16_t newer, uint16_t older) {
+	int distance = (static_cast<int>(newer) - static_cast<int>(older)) % 0xFFFF;
+	return (distance < 0) ? distance + 0xFFFF : distance;
+}
+
+bool input_sequence_more_recent(uint16_t a, uint16_t b) {
+	int distance = input_sequence_distance(a, b);
+	return distance != 0 && distance < 0x8000;
+}
+
+void SnapshotHistory::store(const SnapshotMessage& snapshot) {
+	snapshots[snapshot.sequence % SNAPSHOT_HISTORY_SIZE] = snapshot;
+	is_valid[snapshot.sequence % SNAPSHOT_HISTORY_SIZE] = true;
+}
+
+const SnapshotMessage* SnapshotHistory::find(uint16_t sequence) const {
+	int index = sequence % SNAPSHOT_HISTORY_SIZE;
+
+	if (!is_valid[index] || snapshots[index].sequence != sequence) // Slot was overwritten by a newer snapshot.
+		return nullptr;
+
+	return &snapshots[index];
+}
+
+void SnapshotHistory::clear() {
+	std::fill(std::begin(is_valid), std::end(is_valid), false);
+}
+
+int encode_snapshot(const SnapshotMessage& message, const SnapshotMessage* baseline, uint8_t* buffer, int capacity) {
+	BitWriter writer(buffer, capacity);
+
+	// The baseline is referred to by how many snapshots ago it was sent, 0 meaning that there's no baseline and every field is compared against zero.
+	uint16_t baseline_offset = baseline ? static_cast<uint16_t>(message.sequence - baseline->sequence) : 0;
+	if (baseline_offset >= SNAPSHOT_HISTORY_SIZE) {
+		baseline = nullptr;
+		baseline_offset = 0;
+	}
+
+	SnapshotMessage empty_snapshot;
+	const SnapshotMessage& reference = baseline ? *baseline : empty_snapshot;
+
+	write_header(writer, MessageType::SNAPSHOT);
+	writer.write_bits(message.sequence, SEQUENCE_BITS);
+	writer.write_bits(baseline_offset, BASELINE_OFFSET_BITS);
+
+	write_tick_delta(writer, message.server_tick, reference.server_tick);
+	write_field_delta(writer, static_cast<int>(message.ball_event_type), static_cast<int>(reference.ball_event_type), BALL_EVENT_TYPE_BITS);
+	write_tick_delta(writer, message.ball_tick, reference.ball_tick);
+	write_position_delta(writer, message.ball_x, reference.ball_x, BALL_FRACTION_BITS);
+	write_position_delta(writer, message.ball_y, reference.ball_y, BALL_FRACTION_BITS);
+	write_field_delta(writer, clamp_velocity(message.ball_velocity_x), clamp_velocity(reference.ball_velocity_x), VELOCITY_BITS + BALL_FRACTION_BITS);
+	write_field_delta(writer, clamp_velocity(message.ball_velocity_y), clamp_velocity(reference.ball_velocity_y), VELOCITY_BITS + BALL_FRACTION_BITS);
+	write_position_delta(writer, message.player_1_y, reference.player_1_y, 0);
+	write_position_delta(writer, message.player_2_y, reference.player_2_y, 0);
+	write_field_delta(writer, message.last_processed_input, reference.last_processed_input, SEQUENCE_BITS);
+
+	return writer.finish();
+}
+
+bool decode_snapshot(const uint8_t* buffer, int length, const SnapshotHistory& received_snapshots, SnapshotMessage& message) {
+	BitReader reader(buffer, length);
+
+	if (!read_header(reader, MessageType::SNAPSHOT))
+		return false;
+
+	SnapshotMessage decoded;
+	decoded.sequence = static_cast<uint16_t>(reader.read_bits(SEQUENCE_BITS));
+	uint16_t baseline_offset = static_cast<uint16_t>(reader.read_bits(BASELINE_OFFSET_BITS));
+
+	SnapshotMessage empty_snapshot;
+	const SnapshotMessage* baseline = &empty_snapshot;
+
+	if (baseline_offset != 0) {
+		baseline = received_snapshots.find(static_cast<uint16_t>(decoded.sequence - baseline_offset));
+		if (baseline == nullptr)
+			return false;
+	}
+
+	decoded.server_tick = read_tick_delta(reader, baseline->server_tick);
+	decoded.ball_event_type = static_cast<BallEventType>(read_field_delta(reader, static_cast<int>(baseline->ball_event_type), BALL_EVENT_TYPE_BITS, false));
+	decoded.ball_tick = read_tick_delta(reader, baseline->ball_tick);
+	decoded.ball_x = read_position_delta(reader, baseline->ball_x, BALL_FRACTION_BITS);
+	decoded.ball_y = read_position_delta(reader, baseline->ball_y, BALL_FRACTION_BITS);
+	decoded.ball_velocity_x = read_field_delta(reader, baseline->ball_velocity_x, VELOCITY_BITS + BALL_FRACTION_BITS, true);
+	decoded.ball_velocity_y = read_field_delta(reader, baseline->ball_velocity_y, VELOCITY_BITS + BALL_FRACTION_BITS, true);
+	decoded.player_1_y = read_position_delta(reader, baseline->player_1_y, 0);
+	decoded.player_2_y = read_position_delta(reader, baseline->player_2_y, 0);
+	decoded.last_processed_input = static_cast<uint16_t>(read_field_delta(reader, baseline->last_processed_input, SEQUENCE_BITS, false));
+
+	if (reader.has_failed())
+		return false;
+
+	message = decoded;
+	return true;
+}
+
+// Writes the input count and then the inputs as runs of the same input.
+static void write_inputs(BitWriter& writer, const uint8_t* inputs, int input_count) {
+	writer.write_bits(static_cast<uint32_t>(input_count), INPUT_COUNT_BITS);
+
+	int run_start = 0;
+	while (run_start < input_count) {
+		int run_length = 1;
+		while (run_start + run_length < input_count && inputs[run_start + run_length] == inputs[run_start])
+			run_length++;
+
+		writer.write_bits(inputs[run_start], 2);
+		writer.write_bits(static_cast<uint32_t>(run_length - 1), INPUT_RUN_LENGTH_BITS);
+		run_start += run_length;
+	}
+}
+
+// Returns false if there are more inputs than MAX_INPUTS_PER_MESSAGE, or the runs don't add up to the input count.
+static bool read_inputs(BitReader& reader, uint8_t* inputs, int& input_count) {
+	input_count = static_cast<int>(reader.read_bits(INPUT_COUNT_BITS));
+	if (input_count > MAX_INPUTS_PER_MESSAGE)
+		return false;
+
+	int read_count = 0;
+	while (read_count < input_count && !reader.has_failed()) {
+		uint8_t input = static_cast<uint8_t>(reader.read_bits(2));
+		int run_length = static_cast<int>(reader.read_bits(INPUT_RUN_LENGTH_BITS)) + 1;
+
+		if (read_count + run_length > input_count)
+			return false;
+
+		std::fill(inputs + read_count, inputs + read_count + run_length, input);
+		read_count += run_length;
+	}
+
+	return !reader.has_failed();
+}
+
+int encode_input(const InputMessage& message, uint8_t* buffer, int capacity) {
+	BitWriter writer(buffer, capacity);
+
+	write_header(writer, MessageType::INPUT);
+	writer.write_bits(message.newest_sequence, SEQUENCE_BITS);
+	writer.write_bits(message.view_tick, TICK_BITS);
+	write_inputs(writer, message.inputs, std::clamp(message.input_count, 0, MAX_INPUTS_PER_MESSAGE));
+
+	return writer.finish();
+}
+
+bool decode_input(const uint8_t* buffer, int length, InputMessage& message) {
+	BitReader reader(buffer, length);
+
+	if (!read_header(reader, MessageType::INPUT))
+		return false;
+
+	InputMessage decoded;
+	decoded.newest_sequence = static_cast<uint16_t>(reader.read_bits(SEQUENCE_BITS));
+	decoded.view_tick = reader.read_bits(TICK_BITS);
+
+	if (!read_inputs(reader, decoded.inputs, decoded.input_count))
+		return false;
+
+	message = decoded;
+	return true;
+}
+
+int encode_ball_event(const BallEventMessage& message, uint8_t* buffer, int capacity) {
+	BitWriter writer(buffer, capacity);
+
+	write_header(writer, MessageType::BALL_EVENT);
+	writer.write_bits(static_cast<uint32_t>(message.type), BALL_EVENT_TYPE_BITS);
+	writer.write_bits(message.tick, TICK_BITS);
+	writer.write_bits(quantize_position(message.x, BALL_FRACTION_BITS), POSITION_BITS + BALL_FRACTION_BITS);
+	writer.write_bits(quantize_position(message.y, BALL_FRACTION_BITS), POSITION_BITS + BALL_FRACTION_BITS);
+	writer.write_signed(clamp_velocity(message.velocity_x), VELOCITY_BITS + BALL_FRACTION_BITS);
+	writer.write_signed(clamp_velocity(message.velocity_y), VELOCITY_BITS + BALL_FRACTION_BITS);
+
+	return writer.finish();
+}
+
+bool decode_ball_event(const uint8_t* buffer, int length, BallEventMessage& message) {
+	BitReader reader(buffer, length);
+
+	if (!read_header(reader, MessageType::BALL_EVENT))
+		return false;
+
+	BallEventMessage decoded;
+	decoded.type = static_cast<BallEventType>(reader.read_bits(BALL_EVENT_TYPE_BITS));
+	decoded.tick = reader.read_bits(TICK_BITS);
+	decoded.x = dequantize_position(reader.read_bits(POSITION_BITS + BALL_FRACTION_BITS), BALL_FRACTION_BITS);
+	decoded.y = dequantize_position(reader.read_bits(POSITION_BITS + BALL_FRACTION_BITS), BALL_FRACTION_BITS);
+	decoded.velocity_x = reader.read_signed(VELOCITY_BITS + BALL_FRACTION_BITS);
+	decoded.velocity_y = reader.read_signed(VELOCITY_BITS + BALL_FRACTION_BITS);
+
+	if (reader.has_failed())
+		return false;
+
+	message = decoded;
+	return true;
+}
+
+int encode_state_hash(const StateHashMessage& message, uint8_t* buffer, int capacity) {
+	BitWriter writer(buffer, capacity);
+
+	write_header(writer, MessageType::STATE_HASH);
+	writer.write_bits(message.tick, TICK_BITS);
+	writer.write_bits(message.hash, STATE_HASH_BITS);
+
+	return writer.finish();
+}
+
+bool decode_state_hash(const uint8_t* buffer, int length, StateHashMessage& message) {
+	BitReader reader(buffer, length);
+
+	if (!read_header(reader, MessageType::STATE_HASH))
+		return false;
+
+	StateHashMessage decoded;
+	decoded.tick = reader.read_bits(TICK_BITS);
+	decoded.hash = reader.read_bits(STATE_HASH_BITS);
+
+	if (reader.has_failed())
+		return false;
+
+	message = decoded;
+	return true;
+}
+
+int encode_rollback_input(const RollbackInputMessage& message, uint8_t* buffer, int capacity) {
+	BitWriter writer(buffer, capacity);
+
+	write_header(writer, MessageType::ROLLBACK_INPUT);
+	writer.write_bits(message.first_frame, TICK_BITS);
+	writer.write_bits(message.received_frame_count, TICK_BITS);
+	write_inputs(writer, message.inputs, std::clamp(message.input_count, 0, MAX_INPUTS_PER_MESSAGE));
+
+	return writer.finish();
+}
+
+bool decode_rollback_input(const uint8_t* buffer, int length, RollbackInputMessage& message) {
+	BitReader reader(buffer, length);
+
+	if (!read_header(reader, MessageType::ROLLBACK_INPUT))
+		return false;
+
+	RollbackInputMessage decoded;
+	decoded.first_frame = reader.read_bits(TICK_BITS);
+	decoded.received_frame_count = reader.read_bits(TICK_BITS);
+
+	if (!read_inputs(reader, decoded.inputs, decoded.input_count))
+		return false;
+
+	message = decoded;
+	return true;
+}
+
+int encode_snapshot_ack(const SnapshotAckMessage& message, uint8_t* buffer, int capacity) {
+	BitWriter writer(buffer, capacity);
+
+	write_header(writer, MessageType::SNAPSHOT_ACK);
+	writer.write_bits(message.sequence, SEQUENCE_BITS);
+
+	return writer.finish();
+}
+
+bool decode_snapshot_ack(const uint8_t* buffer, int length, SnapshotAckMessage& message) {
+	BitReader reader(buffer, length);
+
+	if (!read_header(reader, MessageType::SNAPSHOT_ACK))
+		return false;
+
+	SnapshotAckMessage decoded;
+	decoded.sequence = static_cast<uint16_t>(reader.read_bits(SEQUENCE_BITS));
+
+	if (reader.has_failed())
+		return false;
+
+	message = decoded;
+	return true;
+}
+
+int encode_reliable_event(const ReliableEventMessage& message, uint8_t* buffer, int capacity) {
+	BitWriter writer(buffer, capacity);
+
+	int event_count = std::clamp(message.event_count, 0, MAX_RELIABLE_EVENTS_PER_MESSAGE);
+
+	write_header(writer, MessageType::RELIABLE_EVENT);
+	writer.write_bits(static_cast<uint32_t>(event_count), RELIABLE_EVENT_COUNT_BITS);
+
+	for (int i = 0; i < event_count; i++) {
+		const ReliableEvent& event = message.events[i];
+		writer.write_bits(event.sequence, SEQUENCE_BITS);
+		writer.write_bits(static_cast<uint32_t>(event.type), RELIABLE_EVENT_TYPE_BITS);
+		writer.write_bits(event.tick, TICK_BITS);
+		writer.write_bits(clamp_score(event.player_1_score), SCORE_BITS);
+		writer.write_bits(clamp_score(event.player_2_score), SCORE_BITS);
+	}
+
+	return writer.finish();
+}
+
+bool decode_reliable_event(const uint8_t* buffer, int length, ReliableEventMessage& message) {
+	BitReader reader(buffer, length);
+
+	if (!read_header(reader, MessageType::RELIABLE_EVENT))
+		return false;
+
+	ReliableEventMessage decoded;
+	decoded.event_count = static_cast<int>(reader.read_bits(RELIABLE_EVENT_COUNT_BITS));
+	if (decoded.event_count > MAX_RELIABLE_EVENTS_PER_MESSAGE)
+		return false;
+
+	for (int i = 0; i < decoded.event_count; i++) {
+		ReliableEvent& event = decoded.events[i];
+		event.sequence = static_cast<uint16_t>(reader.read_bits(SEQUENCE_BITS));
+		event.type = static_cast<ReliableEventType>(reader.read_bits(RELIABLE_EVENT_TYPE_BITS));
+		event.tick = reader.read_bits(TICK_BITS);
+		event.player_1_score = static_cast<int>(reader.read_bits(SCORE_BITS));
+		event.player_2_score = static_cast<int>(reader.read_bits(SCORE_BITS));
+	}
+
+	if (reader.has_failed())
+		return false;
+
+	message = decoded;
+	return true;
+}
+
+int encode_event_ack(const EventAckMessage& message, uint8_t* buffer, int capacity) {
+	BitWriter writer(buffer, capacity);
+
+	write_header(writer, MessageType::EVENT_ACK);
+	writer.write_bits(message.next_sequence, SEQUENCE_BITS);
+	writer.write_bits(message.received_mask, RELIABLE_WINDOW_SIZE);
+
+	return writer.finish();
+}
+
+bool decode_event_ack(const uint8_t* buffer, int length, EventAckMessage& message) {
+	BitReader reader(buffer, length);
+
+	if (!read_header(reader, MessageType::EVENT_ACK))
+		return false;
+
+	EventAckMessage decoded;
+	decoded.next_sequence = static_cast<uint16_t>(reader.read_bits(SEQUENCE_BITS));
+	decoded.received_mask = reader.read_bits(RELIABLE_WINDOW_SIZE);
+
+	if (reader.has_failed())
+		return false;
+
+	message = decoded;
+	return true;
+}
+
+int encode_time_request(const TimeRequestMessage& message, uint8_t* buffer, int capacity) {
+	BitWriter writer(buffer, capacity);
+
+	write_header(writer, MessageType::TIME_REQUEST);
+	writer.write_bits(message.sequence, SEQUENCE_BITS);
+
+	return writer.finish();
+}
+
+bool decode_time_request(const uint8_t* buffer, int length, TimeRequestMessage& message) {
+	BitReader reader(buffer, length);
+
+	if (!read_header(reader, MessageType::TIME_REQUEST))
+		return false;
+
+	TimeRequestMessage decoded;
+	decoded.sequence = static_cast<uint16_t>(reader.read_bits(SEQUENCE_BITS));
+
+	if (reader.has_failed())
+		return false;
+
+	message = decoded;
+	return true;
+}
+
+int encode_time_response(const TimeResponseMessage& message, uint8_t* buffer, int capacity) {
+	BitWriter writer(buffer, capacity);
+
+	write_header(writer, MessageType::TIME_RESPONSE);
+	writer.write_bits(message.sequence, SEQUENCE_BITS);
+	writer.write_signed(quantize_server_clock(message.receive_clock), SERVER_CLOCK_BITS);
+	writer.write_signed(quantize_server_clock(message.send_clock), SERVER_CLOCK_BITS);
+
+	return writer.finish();
+}
+
+bool decode_time_response(const uint8_t* buffer, int length, TimeResponseMessage& message) {
+	BitReader reader(buffer, length);
+
+	if (!read_header(reader, MessageType::TIME_RESPONSE))
+		return false;
+
+	TimeResponseMessage decoded;
+	decoded.sequence = static_cast<uint16_t>(reader.read_bits(SEQUENCE_BITS));
+	decoded.receive_clock = dequantize_server_clock(reader.read_signed(SERVER_CLOCK_BITS));
+	decoded.send_clock = dequantize_server_clock(reader.read_signed(SERVER_CLOCK_BITS));
+
+	if (reader.has_failed())
+		return false;
+
+	message = decoded;
+	return true;
+}
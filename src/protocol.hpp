@@ -0,0 +1,292 @@
+#pragma once
+
+#include <cstdint>
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+
+#define PROTOCOL_VERSION 10
+#define PROTOCOL_MAGIC 0xD1D0 // Sent with the handshake so that we don't mistake a random datagram for someone trying to connect.
+#define MAX_PACKET_LENGTH 64
+#define DEFAULT_PORT 27015 // Where servers listen and clients connect to unless told otherwise.
+
+// Every datagram starts with the connection ID the server handed out with its SYN-ACK, followed by the message itself. The client's SYN carries 0 as it doesn't have one yet.
+// The server finds the session a datagram belongs to from this alone, so a datagram from some other address can't end up in someone else's match.
+#define CONNECTION_ID_LENGTH 4
+#define NO_CONNECTION_ID 0
+#define MAX_DATAGRAM_LENGTH (CONNECTION_ID_LENGTH + MAX_PACKET_LENGTH)
+
+// How many bits each field takes up on the wire. Positions are in pixels and get shifted up by POSITION_BIAS so that a ball that's slightly off-screen still fits in an unsigned field.
+// The ball moves by fractions of a pixel, so its position and velocity carry BALL_FRACTION_BITS more bits below the pixel. That's the match's own fixed-point, see FIXED_SHIFT.
+#define VERSION_BITS 4
+#define MESSAGE_TYPE_BITS 4
+#define POSITION_BITS 11
+#define POSITION_BIAS 256
+#define VELOCITY_BITS 8
+#define BALL_FRACTION_BITS 8
+#define SCORE_BITS 16
+#define SEQUENCE_BITS 16
+#define SMALL_DELTA_BITS 7 // Positions that moved less than 64 pixels (or 64 steps of the ball's fixed-point) and ticks that advanced less than 128 since the baseline are sent as a delta instead of in full.
+#define TICK_BITS 32
+#define BALL_EVENT_TYPE_BITS 3
+#define MATCH_SEED_BITS 32
+#define STATE_HASH_BITS 32
+#define RELIABLE_EVENT_TYPE_BITS 2
+#define SERVER_CLOCK_BITS 32
+#define SERVER_CLOCK_FRACTION_BITS 8 // Server clock readings are in ticks, with this many bits of fraction. That's about 65 microseconds, and it runs out after about 38 hours.
+
+// How many inputs an INPUT or ROLLBACK_INPUT message can carry at most, and the bits their input count takes up.
+// The inputs themselves are sent as runs of the same input, as someone holding a key (or none) for a while is by far the most common case.
+#define MAX_INPUTS_PER_MESSAGE 32
+#define INPUT_COUNT_BITS 6
+#define INPUT_RUN_LENGTH_BITS 5 // Run length minus one, so a run of all MAX_INPUTS_PER_MESSAGE inputs fits.
+
+// How many events a RELIABLE_EVENT message can carry at most, and the bits their count takes up.
+#define MAX_RELIABLE_EVENTS_PER_MESSAGE 4
+#define RELIABLE_EVENT_COUNT_BITS 3
+
+// How many reliable events can be waiting to be acknowledged at once, which is also how many the EVENT_ACK's mask covers.
+#define RELIABLE_WINDOW_SIZE 32
+static_assert(RELIABLE_WINDOW_SIZE <= 32, "The EVENT_ACK mask has to fit in 32 bits.");
+
+// How many sent/received snapshots we remember to delta against. A baseline older than this is treated as lost and the next snapshot is sent in full.
+#define SNAPSHOT_HISTORY_SIZE 32
+#define BASELINE_OFFSET_BITS 5
+
+// How many of its own inputs the client remembers for replaying on top of the server's paddle position.
+#define INPUT_HISTORY_SIZE 128
+
+enum class MessageType : uint8_t {
+	SYN,
+	SYN_ACK,
+	ACK,
+	SNAPSHOT,
+	SNAPSHOT_ACK,
+	INPUT,
+	BALL_EVENT,
+	STATE_HASH,
+	ROLLBACK_INPUT,
+	RELIABLE_EVENT,
+	EVENT_ACK,
+	TIME_REQUEST,
+	TIME_RESPONSE
+};
+
+// Everything that changes the ball's trajectory. Between two of these, the ball only moves in a straight line and bounces off the top and bottom of the screen.
+enum class BallEventType : uint8_t {
+	CORRECTION, // Nothing happened, the server is just resending where the ball is in case the client drifted off.
+	WALL_BOUNCE,
+	PADDLE_BOUNCE,
+	SPEED_UP,
+	SERVE,
+	SCORE,
+	REWIND // The server rewound the match to give the client a hit it saw on its screen, see LagCompensator. Replaces every event after it.
+};
+
+// The ball's position and velocity at the end of the given server tick.
+struct BallEventMessage {
+	BallEventType type = BallEventType::CORRECTION;
+	uint32_t tick = 0;
+
+	// In fixed-point, with BALL_FRACTION_BITS of fraction.
+	int x = 0;
+	int y = 0;
+	int velocity_x = 0;
+	int velocity_y = 0;
+};
+
+// Game state the server sends to the client whenever its SnapshotRateController says it's time to.
+struct SnapshotMessage {
+	uint16_t sequence = 0;
+	uint32_t server_tick = 0;
+
+	// The latest ball event rather than where the ball is right now, so it only changes when the trajectory does. Also makes sure the client gets every trajectory change eventually even if the BALL_EVENT message was lost.
+	BallEventType ball_event_type = BallEventType::CORRECTION;
+	uint32_t ball_tick = 0;
+	int ball_x = 0;
+	int ball_y = 0;
+	int ball_velocity_x = 0;
+	int ball_velocity_y = 0;
+
+	int player_1_y = 0; // In pixels.
+	int player_2_y = 0;
+	uint16_t last_processed_input = 0; // The client's paddle position above is the result of its inputs up to and including this one.
+};
+
+// Which way a paddle is being moved on a tick, packed for INPUT and ROLLBACK_INPUT messages.
+#define FRAME_INPUT_UP 1
+#define FRAME_INPUT_DOWN 2
+
+// The client's keyboard input of every tick (even the ones with no keys down) is numbered so the server can tell which ones it has already applied.
+// Every message carries all of them from the first one the server hasn't acknowledged yet, up to MAX_INPUTS_PER_MESSAGE. So a lost message costs nothing as long as the next one makes it.
+struct InputMessage {
+	uint16_t newest_sequence = 0; // The sequence number of inputs[input_count - 1].
+	uint32_t view_tick = 0; // The server tick the client was rendering the server's side of the match at when it made the newest input.
+	int input_count = 0;
+	uint8_t inputs[MAX_INPUTS_PER_MESSAGE] = { 0 }; // FRAME_INPUT_ flags, oldest first.
+};
+
+// What the server tells the client about the match with its SYN-ACK, so that both sides start the exact same match.
+struct MatchSetup {
+	uint32_t seed = 0; // For the match's random number generator.
+	int end_score = 0;
+	bool is_rollback = false; // Both sides simulate the match and only send each other their inputs, see RollbackSession.
+};
+
+// Rollback games only ever send these. Same as InputMessage, from first_frame on, which is the first one the receiver hasn't let the sender know it has yet.
+struct RollbackInputMessage {
+	uint32_t first_frame = 0;
+	uint32_t received_frame_count = 0; // How many of the receiver's inputs the sender has, counting from frame 0. The acknowledgement mentioned above.
+	int input_count = 0;
+	uint8_t inputs[MAX_INPUTS_PER_MESSAGE] = { 0 }; // FRAME_INPUT_ flags.
+};
+
+// Hash of the sender's match state at the end of the given tick, for the other side to compare against its own. See hash_match_state.
+// Rollback games send the state at the start of the given frame instead, as frames keep going after the match (and its ticks) have ended.
+struct StateHashMessage {
+	uint32_t tick = 0;
+	uint32_t hash = 0;
+};
+
+// Things that happen to the match once, which the client has to find out about exactly once and in order. See ReliableEventChannel.
+// The end score doesn't need one, it comes with the SYN-ACK and never changes.
+enum class ReliableEventType : uint8_t {
+	SCORE,
+	MATCH_END // The point that ended the match, sent instead of a SCORE.
+};
+
+struct ReliableEvent {
+	uint16_t sequence = 0;
+	ReliableEventType type = ReliableEventType::SCORE;
+	uint32_t tick = 0; // The server tick it happened on.
+	int player_1_score = 0; // The score after the event.
+	int player_2_score = 0;
+};
+
+// Every event that's due to be sent, or sent again, oldest first.
+struct ReliableEventMessage {
+	int event_count = 0;
+	ReliableEvent events[MAX_RELIABLE_EVENTS_PER_MESSAGE];
+};
+
+// Sent back for every RELIABLE_EVENT message. The receiver has every event before next_sequence, and bit i of received_mask is set if it also has next_sequence + 1 + i.
+struct EventAckMessage {
+	uint16_t next_sequence = 0;
+	uint32_t received_mask = 0;
+};
+
+// NTP style clock sync, see ClockSync. The client sends these every now and then, and the server answers each one right away.
+// The client remembers when it sent each request itself, so only the sequence number goes over the wire.
+struct TimeRequestMessage {
+	uint16_t sequence = 0;
+};
+
+// The server's clock counts ticks, as that's what everything it sends is stamped with. It keeps running between ticks, before the first one and after the match has ended.
+struct TimeResponseMessage {
+	uint16_t sequence = 0; // Of the request this answers.
+	double receive_clock = 0.0; // The server's clock when the request arrived.
+	double send_clock = 0.0; // And when this response was sent.
+};
+
+// Sent by the client for every snapshot it accepts, the server uses the latest one as the baseline for the following snapshots.
+struct SnapshotAckMessage {
+	uint16_t sequence = 0;
+};
+
+// Ring of the last SNAPSHOT_HISTORY_SIZE snapshots, indexed by sequence number.
+class SnapshotHistory {
+	private:
+		SnapshotMessage snapshots[SNAPSHOT_HISTORY_SIZE];
+		bool is_valid[SNAPSHOT_HISTORY_SIZE] = { false };
+	public:
+		void store(const SnapshotMessage& snapshot);
+		const SnapshotMessage* find(uint16_t sequence) const;
+		void clear();
+};
+
+// Whether sequence "a" is newer than "b", taking wrapping around 65535 into account.
+bool sequence_more_recent(uint16_t a, uint16_t b);
+
+// Input sequence numbers go from 1 to 65535 and then start over at 1, so 0 always means that there hasn't been an input yet, even after they've wrapped around.
+uint16_t advance_input_sequence(uint16_t sequence, int count);
+int input_sequence_distance(uint16_t newer, uint16_t older);
+bool input_sequence_more_recent(uint16_t a, uint16_t b);
+
+// Packs values MSB first into a buffer owned by the caller, so nothing gets allocated while encoding.
+class BitWriter {
+	private:
+		uint8_t* buffer = nullptr;
+		int capacity = 0;
+		int bytes_written = 0;
+
+		uint64_t scratch = 0;
+		int scratch_bits = 0;
+
+		bool overflowed = false;
+	public:
+		BitWriter(uint8_t* buffer_param, int capacity_param);
+		void write_bits(uint32_t value, int bits);
+		void write_signed(int value, int bits);
+		int finish();
+};
+
+class BitReader {
+	private:
+		const uint8_t* buffer = nullptr;
+		int length = 0;
+		int bytes_read = 0;
+
+		uint64_t scratch = 0;
+		int scratch_bits = 0;
+
+		bool overflowed = false;
+	public:
+		BitReader(const uint8_t* buffer_param, int length_param);
+		uint32_t read_bits(int bits);
+		int read_signed(int bits);
+		bool has_failed();
+};
+
+// Connection IDs are written in network byte order in front of the message.
+void write_connection_id(uint8_t* datagram, uint32_t connection_id);
+uint32_t read_connection_id(const uint8_t* datagram);
+
+// All encode functions return the length of the encoded message in bytes, or -1 if it didn't fit in the buffer.
+// All decode functions return false if the message was malformed, of the wrong type or from a different protocol version.
+bool peek_message_type(const uint8_t* buffer, int length, MessageType& type);
+
+// Only the SYN-ACK carries the match setup, it's ignored for the other handshake messages.
+int encode_handshake(MessageType type, uint8_t* buffer, int capacity, const MatchSetup& match_setup = MatchSetup());
+bool decode_handshake(const uint8_t* buffer, int length, MessageType expected_type, MatchSetup* match_setup = nullptr);
+bool read_handshake_version(const uint8_t* buffer, int length, uint32_t& version);
+
+// Snapshots are encoded as a delta against the baseline, or in full if baseline is nullptr. Decoding fails if the baseline the snapshot refers to isn't in received_snapshots anymore.
+int encode_snapshot(const SnapshotMessage& message, const SnapshotMessage* baseline, uint8_t* buffer, int capacity);
+bool decode_snapshot(const uint8_t* buffer, int length, const SnapshotHistory& received_snapshots, SnapshotMessage& message);
+
+int encode_input(const InputMessage& message, uint8_t* buffer, int capacity);
+bool decode_input(const uint8_t* buffer, int length, InputMessage& message);
+
+int encode_ball_event(const BallEventMessage& message, uint8_t* buffer, int capacity);
+bool decode_ball_event(const uint8_t* buffer, int length, BallEventMessage& message);
+
+int encode_state_hash(const StateHashMessage& message, uint8_t* buffer, int capacity);
+bool decode_state_hash(const uint8_t* buffer, int length, StateHashMessage& message);
+
+int encode_rollback_input(const RollbackInputMessage& message, uint8_t* buffer, int capacity);
+bool decode_rollback_input(const uint8_t* buffer, int length, RollbackInputMessage& message);
+
+int encode_snapshot_ack(const SnapshotAckMessage& message, uint8_t* buffer, int capacity);
+bool decode_snapshot_ack(const uint8_t* buffer, int length, SnapshotAckMessage& message);
+
+int encode_reliable_event(const ReliableEventMessage& message, uint8_t* buffer, int capacity);
+bool decode_reliable_event(const uint8_t* buffer, int length, ReliableEventMessage& message);
+
+int encode_event_ack(const EventAckMessage& message, uint8_t* buffer, int capacity);
+bool decode_event_ack(const uint8_t* buffer, int length, EventAckMessage& message);
+
+int encode_time_request(const TimeRequestMessage& message, uint8_t* buffer, int capacity);
+bool decode_time_request(const uint8_t* buffer, int length, TimeRequestMessage& message);
+
+int encode_time_response(const TimeResponseMessage& message, uint8_t* buffer, int capacity);
+bool decode_time_response(const uint8_t* buffer, int length, TimeResponseMessage& message);
@@ -0,0 +1,183 @@
+#include "protocol_benchmark.hpp"
+
+// The text the server used to send every tick before the binary protocol, built the same way it was.
+static std::string encode_text_snapshot(const MatchState& match) {
+	return "bx:" + std::to_string(to_pixels(match.ball.x)) +
+		" by:" + std::to_string(to_pixels(match.ball.y)) +
+		" p1:" + std::to_string(to_pixels(match.player_1.y)) +
+		" p1s:" + std::to_string(match.player_1_score) +
+		" p2s:" + std::to_string(match.player_2_score) +
+		" bvx:" + std::to_string(to_pixels(match.ball_velocity_x)) +
+		" bvy:" + std::to_string(to_pixels(match.ball_velocity_y)) +
+		" endsc:" + std::to_string(match.end_score);
+}
+
+static std::vector<std::string> split_string(const std::string& text, char seperator) {
+	std::vector<std::string> tokens;
+
+	std::size_t start = 0;
+	std::size_t end = 0;
+
+	while ((end = text.find(seperator, start)) != std::string::npos) {
+		tokens.push_back(text.substr(start, end - start));
+		start = end + 1;
+	}
+	tokens.push_back(text.substr(start));
+	return tokens;
+}
+
+// And the client's side of it, also the same as it was.
+static void decode_text_snapshot(const std::string& text, TextSnapshot& snapshot) {
+	for (const std::string& arg : split_string(text, ' ')) {
+		std::vector<std::string> command_and_value = split_string(arg, ':');
+		if (command_and_value.size() != 2)
+			continue;
+
+		const std::string& command = command_and_value[0];
+		int value = std::stoi(command_and_value[1]);
+
+		if (command == "bx")
+			snapshot.ball_x = value;
+		else if (command == "by")
+			snapshot.ball_y = value;
+		else if (command == "p1")
+			snapshot.player_1_y = value;
+		else if (command == "p1s")
+			snapshot.player_1_score = value;
+		else if (command == "p2s")
+			snapshot.player_2_score = value;
+		else if (command == "bvx")
+			snapshot.ball_velocity_x = value;
+		else if (command == "bvy")
+			snapshot.ball_velocity_y = value;
+		else if (command == "endsc")
+			snapshot.end_score = value;
+	}
+}
+
+static bool is_same_snapshot(const SnapshotMessage& a, const SnapshotMessage& b) {
+	return a.sequence == b.sequence && a.server_tick == b.server_tick && a.ball_event_type == b.ball_event_type && a.ball_tick == b.ball_tick &&
+		a.ball_x == b.ball_x && a.ball_y == b.ball_y && a.ball_velocity_x == b.ball_velocity_x && a.ball_velocity_y == b.ball_velocity_y &&
+		a.player_1_y == b.player_1_y && a.player_2_y == b.player_2_y && a.last_processed_input == b.last_processed_input;
+}
+
+static double get_seconds_since(std::chrono::steady_clock::time_point start_time) {
+	return std::max(std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count(), 0.000001);
+}
+
+// Encodes every snapshot, against the one before it if is_delta like a client that acknowledges every snapshot, then decodes them all again and checks that they came out the same.
+static bool run_binary_snapshots(const std::vector<SnapshotMessage>& snapshots, bool is_delta) {
+	int snapshot_count = static_cast<int>(snapshots.size());
+	std::vector<uint8_t> encoded(static_cast<size_t>(snapshot_count) * MAX_PACKET_LENGTH);
+	std::vector<int> lengths(snapshot_count);
+
+	auto start_time = std::chrono::steady_clock::now();
+	uint64_t total_bytes = 0;
+	for (int i = 0; i < snapshot_count; i++) {
+		const SnapshotMessage* baseline = (is_delta && i > 0) ? &snapshots[i - 1] : nullptr;
+		lengths[i] = encode_snapshot(snapshots[i], baseline, &encoded[static_cast<size_t>(i) * MAX_PACKET_LENGTH], MAX_PACKET_LENGTH);
+		total_bytes += lengths[i];
+	}
+	double encode_seconds = get_seconds_since(start_time);
+
+	SnapshotHistory received_snapshots;
+	SnapshotMessage decoded;
+	int mismatch_count = 0;
+
+	start_time = std::chrono::steady_clock::now();
+	for (int i = 0; i < snapshot_count; i++) {
+		if (!decode_snapshot(&encoded[static_cast<size_t>(i) * MAX_PACKET_LENGTH], lengths[i], received_snapshots, decoded) || !is_same_snapshot(decoded, snapshots[i])) {
+			mismatch_count++;
+			continue;
+		}
+
+		received_snapshots.store(decoded);
+	}
+	double decode_seconds = get_seconds_since(start_time);
+
+	std::cout << (is_delta ? "Binary, delta: " : "Binary, full: ") << static_cast<double>(total_bytes) / snapshot_count << " bytes on average, ";
+	std::cout << snapshot_count / encode_seconds << " encodes/sec, " << snapshot_count / decode_seconds << " decodes/sec." << "\n";
+
+	if (mismatch_count > 0) {
+		std::cerr << mismatch_count << " snapshots didn't decode to what was encoded." << "\n";
+		return false;
+	}
+
+	return true;
+}
+
+/*
+"dingdong --protocol-bench [snapshots] [seed]" plays a match between two get_ai_input bots, takes a snapshot on every tick like the server would, and encodes and decodes all of them.
+The binary snapshots go both as full snapshots and as deltas, and the old text format goes through the exact string building and splitting it used to, so the bytes on the wire and the speed of each can be compared.
+The text format carried the scores too, binary snapshots leave those to the reliable event channel.
+*/
+int run_protocol_benchmark(int argc, char* argv[]) {
+	int snapshot_count = std::max((argc > 2) ? std::atoi(argv[2]) : PROTOCOL_BENCHMARK_DEFAULT_SNAPSHOTS, 1);
+	uint32_t seed = (argc > 3) ? static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 10)) : PROTOCOL_BENCHMARK_DEFAULT_SEED;
+
+	std::cout << "Encoding and decoding " << snapshot_count << " snapshots, seed " << seed << "." << "\n";
+
+	std::vector<MatchState> matches(snapshot_count);
+	std::vector<SnapshotMessage> snapshots(snapshot_count);
+
+	MatchState match = create_match(PROTOCOL_BENCHMARK_END_SCORE, seed);
+	BallEventMessage latest_ball_event;
+	for (int i = 0; i < snapshot_count; i++) {
+		MatchInputs inputs;
+		inputs.player_1 = get_ai_input(match, match.player_1);
+		inputs.player_2 = get_ai_input(match, match.player_2);
+		match = step(match, inputs);
+
+		if (match.has_ball_event)
+			latest_ball_event = make_ball_event(match, match.ball_event_type);
+		else if (match.tick - latest_ball_event.tick >= PROTOCOL_BENCHMARK_CORRECTION_TICKS)
+			latest_ball_event = make_ball_event(match, BallEventType::CORRECTION);
+
+		SnapshotMessage& snapshot = snapshots[i];
+		snapshot.sequence = static_cast<uint16_t>(i);
+		snapshot.server_tick = match.tick;
+		snapshot.ball_event_type = latest_ball_event.type;
+		snapshot.ball_tick = latest_ball_event.tick;
+		snapshot.ball_x = latest_ball_event.x;
+		snapshot.ball_y = latest_ball_event.y;
+		snapshot.ball_velocity_x = latest_ball_event.velocity_x;
+		snapshot.ball_velocity_y = latest_ball_event.velocity_y;
+		snapshot.player_1_y = to_pixels(match.player_1.y);
+		snapshot.player_2_y = to_pixels(match.player_2.y);
+		snapshot.last_processed_input = advance_input_sequence(0, i + 1);
+
+		matches[i] = match;
+	}
+
+	bool is_ok = run_binary_snapshots(snapshots, false);
+	is_ok = run_binary_snapshots(snapshots, true) && is_ok;
+
+	std::vector<std::string> texts(snapshot_count);
+	auto start_time = std::chrono::steady_clock::now();
+	uint64_t total_bytes = 0;
+	for (int i = 0; i < snapshot_count; i++) {
+		texts[i] = encode_text_snapshot(matches[i]);
+		total_bytes += texts[i].size();
+	}
+	double encode_seconds = get_seconds_since(start_time);
+
+	TextSnapshot text_snapshot;
+	int64_t checksum = 0; // So the decoding can't be optimized away.
+	start_time = std::chrono::steady_clock::now();
+	for (int i = 0; i < snapshot_count; i++) {
+		decode_text_snapshot(texts[i], text_snapshot);
+		checksum += text_snapshot.ball_x + text_snapshot.player_1_y;
+	}
+	double decode_seconds = get_seconds_since(start_time);
+
+	std::cout << "Text: " << static_cast<double>(total_bytes) / snapshot_count << " bytes on average, ";
+	std::cout << snapshot_count / encode_seconds << " encodes/sec, " << snapshot_count / decode_seconds << " decodes/sec (checksum " << checksum << ")." << "\n";
+
+	if (!is_ok) {
+		std::cout << "FAILED" << "\n";
+		return 1;
+	}
+
+	std::cout << "OK" << "\n";
+	return 0;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <algorithm>
+#include "protocol.hpp"
+#include "match_simulation.hpp"
+
+// What "dingdong --protocol-bench" runs with unless told otherwise.
+#define PROTOCOL_BENCHMARK_DEFAULT_SNAPSHOTS 200000
+#define PROTOCOL_BENCHMARK_DEFAULT_SEED 1
+
+// High enough that the match never ends during the benchmark.
+#define PROTOCOL_BENCHMARK_END_SCORE 1000
+
+// How often the server resends where the ball is when nothing happened to it, same as MATCH_BALL_CORRECTION_INTERVAL_MS at 60 ticks per second.
+#define PROTOCOL_BENCHMARK_CORRECTION_TICKS 60
+
+// Everything the old text snapshots carried, in pixels.
+struct TextSnapshot {
+	int ball_x = 0;
+	int ball_y = 0;
+	int player_1_y = 0;
+	int player_1_score = 0;
+	int player_2_score = 0;
+	int ball_velocity_x = 0;
+	int ball_velocity_y = 0;
+	int end_score = 0;
+};
+
+int run_protocol_benchmark(int argc, char* argv[]);
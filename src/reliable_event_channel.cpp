@@ -0,0 +1,96 @@
+#include "reliable_event_channel.hpp"
+
+// Numbers the event and queues it for the next make_event_message. Returns false if RELIABLE_WINDOW_SIZE events are already waiting on an acknowledgement, the other side is probably gone by then.
+bool ReliableEventChannel::push_event(const ReliableEvent& event) {
+	if (static_cast<uint16_t>(next_send_sequence - oldest_unacked_sequence) >= RELIABLE_WINDOW_SIZE) {
+		std::cerr << "Too many unacknowledged events, dropping one." << "\n";
+		return false;
+	}
+
+	PendingEvent& pending_event = sent_events[next_send_sequence % RELIABLE_WINDOW_SIZE];
+	pending_event.event = event;
+	pending_event.event.sequence = next_send_sequence++;
+	pending_event.send_count = 0;
+	pending_event.is_pending = true;
+	return true;
+}
+
+// Fills the message with every event that hasn't been sent yet or is due to be sent again, oldest first. Returns false if there's nothing to send.
+bool ReliableEventChannel::make_event_message(double now, double retransmit_timeout, ReliableEventMessage& message) {
+	message.event_count = 0;
+	retransmit_timeout = std::max(retransmit_timeout, RELIABLE_MIN_RETRANSMIT_MS);
+
+	for (uint16_t sequence = oldest_unacked_sequence; sequence != next_send_sequence && message.event_count < MAX_RELIABLE_EVENTS_PER_MESSAGE; sequence++) {
+		PendingEvent& pending_event = sent_events[sequence % RELIABLE_WINDOW_SIZE];
+		if (!pending_event.is_pending)
+			continue;
+
+		if (pending_event.send_count > 0) {
+			double timeout = std::min(retransmit_timeout * (1 << std::min(pending_event.send_count - 1, 5)), RELIABLE_MAX_RETRANSMIT_MS);
+			if (now - pending_event.last_send_time < timeout)
+				continue;
+
+			resent_count++;
+		}
+
+		pending_event.last_send_time = now;
+		pending_event.send_count++;
+		message.events[message.event_count++] = pending_event.event;
+	}
+
+	return message.event_count > 0;
+}
+
+void ReliableEventChannel::on_event_ack(const EventAckMessage& ack) {
+	for (uint16_t sequence = oldest_unacked_sequence; sequence != next_send_sequence; sequence++) {
+		PendingEvent& pending_event = sent_events[sequence % RELIABLE_WINDOW_SIZE];
+
+		uint16_t offset = static_cast<uint16_t>(sequence - ack.next_sequence) - 1; // Bit in the mask, only meaningful if the sequence is after next_sequence.
+		if (sequence_more_recent(ack.next_sequence, sequence) || (offset < RELIABLE_WINDOW_SIZE && (ack.received_mask & (1u << offset))))
+			pending_event.is_pending = false;
+	}
+
+	while (oldest_unacked_sequence != next_send_sequence && !sent_events[oldest_unacked_sequence % RELIABLE_WINDOW_SIZE].is_pending)
+		oldest_unacked_sequence++;
+}
+
+// Keeps every event we haven't had yet and fills in the acknowledgement to send back, which is needed even if they were all duplicates since our last one might have been lost.
+void ReliableEventChannel::receive_events(const ReliableEventMessage& message, EventAckMessage& ack) {
+	for (int i = 0; i < message.event_count; i++) {
+		const ReliableEvent& event = message.events[i];
+
+		// Anything before next_pop_sequence was already handed out, and the sender never gets further ahead than the window.
+		if (static_cast<uint16_t>(event.sequence - next_pop_sequence) >= RELIABLE_WINDOW_SIZE)
+			continue;
+
+		received_events[event.sequence % RELIABLE_WINDOW_SIZE] = event;
+		is_received[event.sequence % RELIABLE_WINDOW_SIZE] = true;
+	}
+
+	ack.next_sequence = next_pop_sequence;
+	while (static_cast<uint16_t>(ack.next_sequence - next_pop_sequence) < RELIABLE_WINDOW_SIZE && is_received[ack.next_sequence % RELIABLE_WINDOW_SIZE])
+		ack.next_sequence++;
+
+	ack.received_mask = 0;
+	for (int i = 0; i < RELIABLE_WINDOW_SIZE; i++) {
+		uint16_t sequence = static_cast<uint16_t>(ack.next_sequence + 1 + i);
+		if (static_cast<uint16_t>(sequence - next_pop_sequence) < RELIABLE_WINDOW_SIZE && is_received[sequence % RELIABLE_WINDOW_SIZE])
+			ack.received_mask |= 1u << i;
+	}
+}
+
+// Hands out the next event in order, or returns false if it hasn't arrived yet.
+bool ReliableEventChannel::pop_event(ReliableEvent& event) {
+	int index = next_pop_sequence % RELIABLE_WINDOW_SIZE;
+	if (!is_received[index])
+		return false;
+
+	event = received_events[index];
+	is_received[index] = false;
+	next_pop_sequence++;
+	return true;
+}
+
+void ReliableEventChannel::reset() {
+	*this = ReliableEventChannel();
+}
@@ -0,0 +1,50 @@
+#pragma once
+
+#include <iostream>
+#include <cstdint>
+#include <algorithm>
+#include "protocol.hpp"
+
+// An event is sent again if it hasn't been acknowledged this long after it was last sent, doubling every time it's sent again, up to RELIABLE_MAX_RETRANSMIT_MS.
+// The caller passes in how long to wait the first time, which should be about a round trip, but never less than RELIABLE_MIN_RETRANSMIT_MS.
+#define RELIABLE_MIN_RETRANSMIT_MS 50.0
+#define RELIABLE_MAX_RETRANSMIT_MS 2000.0
+
+/*
+Gets discrete events (someone scored, the match ended) to the other side exactly once and in order, over the same datagrams as everything else.
+The sender keeps every event until it's acknowledged and sends it again on a timer. The receiver acknowledges every message it gets with the first event it's missing plus a mask of the ones after that it already has,
+so a lost message only ever costs resending the events that were actually lost, and a lost acknowledgement is covered by the next one.
+Events are held back until everything before them has arrived, and handed out by pop_event.
+Kept apart from the snapshots, which are only ever as reliable as the next one. Doesn't know about sockets, Game and MatchServer send its messages for it.
+*/
+class ReliableEventChannel {
+	private:
+		struct PendingEvent {
+			ReliableEvent event;
+			double last_send_time = 0.0;
+			int send_count = 0;
+			bool is_pending = false;
+		};
+
+		// Sending side, indexed by sequence number.
+		PendingEvent sent_events[RELIABLE_WINDOW_SIZE];
+		uint16_t next_send_sequence = 0;
+		uint16_t oldest_unacked_sequence = 0;
+
+		// Receiving side, indexed by sequence number.
+		ReliableEvent received_events[RELIABLE_WINDOW_SIZE];
+		bool is_received[RELIABLE_WINDOW_SIZE] = { false };
+		uint16_t next_pop_sequence = 0;
+	public:
+		uint32_t resent_count = 0;
+
+		bool push_event(const ReliableEvent& event);
+		bool make_event_message(double now, double retransmit_timeout, ReliableEventMessage& message);
+		void on_event_ack(const EventAckMessage& ack);
+		bool has_unacked_events() const { return oldest_unacked_sequence != next_send_sequence; }
+
+		void receive_events(const ReliableEventMessage& message, EventAckMessage& ack);
+		bool pop_event(ReliableEvent& event);
+
+		void reset();
+};
@@ -0,0 +1,233 @@
+#include "rollback_harness.hpp"
+
+void SimulatedLink::init(double latency_ms_param, double jitter_ms_param, double loss_percent, uint32_t seed) {
+	latency_ms = latency_ms_param;
+	jitter_ms = jitter_ms_param;
+	loss_chance = loss_percent / 100.0;
+	random_generator.seed(seed);
+
+	in_flight.clear();
+	sent_count = lost_count = 0;
+}
+
+void SimulatedLink::send(const uint8_t* data, int length, double now) {
+	if (length <= 0 || length > MAX_PACKET_LENGTH)
+		return;
+
+	sent_count++;
+
+	std::uniform_real_distribution<double> distribution(0.0, 1.0);
+	if (distribution(random_generator) < loss_chance) {
+		lost_count++;
+		return;
+	}
+
+	InFlightDatagram datagram;
+	datagram.delivery_time = now + latency_ms + jitter_ms * distribution(random_generator);
+	datagram.length = length;
+	std::copy(data, data + length, datagram.data);
+
+	in_flight.push_back(datagram);
+}
+
+// Hands over the datagram that's been due the longest and returns its length, or 0 if nothing is due yet.
+int SimulatedLink::receive(double now, uint8_t* buffer) {
+	int due_index = -1;
+
+	for (int i = 0; i < static_cast<int>(in_flight.size()); i++) {
+		if (in_flight[i].delivery_time <= now && (due_index == -1 || in_flight[i].delivery_time < in_flight[due_index].delivery_time))
+			due_index = i;
+	}
+
+	if (due_index == -1)
+		return 0;
+
+	int length = in_flight[due_index].length;
+	std::copy(in_flight[due_index].data, in_flight[due_index].data + length, buffer);
+
+	in_flight[due_index] = in_flight.back();
+	in_flight.pop_back();
+
+	return length;
+}
+
+// One side of the match, doing what Game does in a rollback game with a bot at the keyboard.
+struct HarnessPeer {
+	int player = 1;
+	RollbackSession session;
+	DesyncDetector desync_detector;
+
+	SimulatedLink* incoming = nullptr;
+	SimulatedLink* outgoing = nullptr;
+	double next_tick_time = 0.0;
+
+	// The bot mostly plays like the single player AI, but every now and then holds some random key for a while. That's what makes the other side's predictions go wrong.
+	std::mt19937 random_generator;
+	PaddleInput held_input;
+	int held_frames = 0;
+
+	std::vector<PaddleInput> inputs_by_frame; // Our inputs, by the frame they were applied on. For stepping the reference match afterwards.
+	std::vector<uint32_t> confirmed_hashes; // hash_match_state of every confirmed frame.
+};
+
+static PaddleInput get_bot_input(HarnessPeer& peer) {
+	if (peer.held_frames > 0) {
+		peer.held_frames--;
+		return peer.held_input;
+	}
+
+	std::uniform_int_distribution<int> percent_distribution(0, 99);
+	if (percent_distribution(peer.random_generator) < 3) {
+		std::uniform_int_distribution<int> frame_distribution(5, 30);
+		peer.held_input = unpack_frame_input(static_cast<uint8_t>(percent_distribution(peer.random_generator) % 3));
+		peer.held_frames = frame_distribution(peer.random_generator);
+		return peer.held_input;
+	}
+
+	const MatchState& state = peer.session.get_state();
+	return get_ai_input(state, (peer.player == 1) ? state.player_1 : state.player_2);
+}
+
+static void tick_peer(HarnessPeer& peer, double now) {
+	uint8_t buffer[MAX_PACKET_LENGTH];
+	int length = 0;
+
+	while ((length = peer.incoming->receive(now, buffer)) != 0) {
+		MessageType message_type;
+		if (!peek_message_type(buffer, length, message_type))
+			continue;
+
+		if (message_type == MessageType::ROLLBACK_INPUT) {
+			RollbackInputMessage message;
+			if (decode_rollback_input(buffer, length, message))
+				peer.session.add_remote_inputs(message);
+		}
+		else if (message_type == MessageType::STATE_HASH) {
+			StateHashMessage message;
+			if (decode_state_hash(buffer, length, message))
+				peer.desync_detector.store_remote(message.tick, message.hash);
+		}
+	}
+
+	PaddleInput input = get_bot_input(peer);
+	uint32_t input_frame = peer.session.get_frame() + ROLLBACK_INPUT_DELAY;
+
+	if (peer.session.advance(input)) {
+		if (peer.inputs_by_frame.size() <= input_frame)
+			peer.inputs_by_frame.resize(input_frame + 1);
+
+		peer.inputs_by_frame[input_frame] = input;
+	}
+
+	// Same as Game::send_rollback_messages.
+	uint32_t confirmed_frame = peer.session.get_confirmed_frame();
+	while (peer.confirmed_hashes.size() <= confirmed_frame) {
+		uint32_t hashed_frame = static_cast<uint32_t>(peer.confirmed_hashes.size());
+		uint32_t hash = hash_match_state(peer.session.get_confirmed_state(hashed_frame));
+
+		peer.confirmed_hashes.push_back(hash);
+		peer.desync_detector.store_local(hashed_frame, hash);
+	}
+
+	RollbackInputMessage input_message;
+	peer.session.make_input_message(input_message);
+	peer.outgoing->send(buffer, encode_rollback_input(input_message, buffer, MAX_PACKET_LENGTH), now);
+
+	StateHashMessage state_hash;
+	state_hash.tick = confirmed_frame;
+	state_hash.hash = peer.confirmed_hashes[confirmed_frame];
+	peer.outgoing->send(buffer, encode_state_hash(state_hash, buffer, MAX_PACKET_LENGTH), now);
+
+	peer.next_tick_time += SIMULATION_STEP_MS;
+}
+
+static void print_peer_stats(const HarnessPeer& peer) {
+	const RollbackSession& session = peer.session;
+	double average_depth = (session.rollback_count > 0) ? static_cast<double>(session.resimulated_frame_count) / session.rollback_count : 0.0;
+
+	std::cout << "Player " << peer.player << ": " << session.get_frame() << " frames, " << session.rollback_count << " rollbacks (" << average_depth << " frames deep on average, "
+		<< session.max_rollback_depth << " at most, slowest took " << session.max_resimulation_ms << " ms), stalled " << session.stall_count << " times." << "\n";
+}
+
+/*
+"dingdong --rollback-test [latency ms] [jitter ms] [loss percent] [seconds] [seed]" plays a rollback match between two bots in this one process, over a pair of SimulatedLinks instead of a socket.
+Runs on a made up clock, so it takes as long as stepping the frames does rather than the number of seconds it simulates.
+The match, both links and both bots are seeded from seed (a random one if not given, printed either way), so giving it the seed of a run that failed plays that exact run again.
+Fails if the two sides ever disagree on a confirmed frame, or if either of them disagrees with a match that's stepped once with everyone's real inputs.
+*/
+int run_rollback_harness(int argc, char* argv[]) {
+	double latency_ms = (argc > 2) ? std::atof(argv[2]) : HARNESS_DEFAULT_LATENCY_MS;
+	double jitter_ms = (argc > 3) ? std::atof(argv[3]) : HARNESS_DEFAULT_JITTER_MS;
+	double loss_percent = (argc > 4) ? std::atof(argv[4]) : HARNESS_DEFAULT_LOSS_PERCENT;
+	int seconds = (argc > 5) ? std::atoi(argv[5]) : HARNESS_DEFAULT_SECONDS;
+	uint32_t seed = (argc > 6) ? static_cast<uint32_t>(std::strtoul(argv[6], nullptr, 10)) : std::random_device()();
+
+	std::cout << "Running a " << seconds << " second rollback match with " << latency_ms << " ms latency, " << jitter_ms << " ms jitter and " << loss_percent << "% loss each way, seed " << seed << "." << "\n";
+
+	MatchState initial_state = create_match(1000000, seed); // Nobody should win before the time is up.
+
+	SimulatedLink links[2];
+	links[0].init(latency_ms, jitter_ms, loss_percent, seed + 1);
+	links[1].init(latency_ms, jitter_ms, loss_percent, seed + 2);
+
+	HarnessPeer peers[2];
+	for (int i = 0; i < 2; i++) {
+		HarnessPeer& peer = peers[i];
+		peer.player = i + 1;
+		peer.session.init(initial_state, peer.player);
+		peer.incoming = &links[1 - i];
+		peer.outgoing = &links[i];
+		peer.random_generator.seed(seed + 3 + i);
+	}
+
+	// The client only learns that it's connected once the SYN-ACK gets to it, so it starts that much later.
+	peers[1].next_tick_time = latency_ms;
+
+	double end_time = seconds * 1000.0;
+	auto start_time = std::chrono::steady_clock::now();
+
+	while (peers[0].next_tick_time < end_time || peers[1].next_tick_time < end_time) {
+		HarnessPeer& peer = (peers[0].next_tick_time <= peers[1].next_tick_time) ? peers[0] : peers[1];
+		tick_peer(peer, peer.next_tick_time);
+	}
+
+	double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+
+	// Step the match once more with everyone's real inputs, without any rollbacks, and make sure both sides ended up with the exact same frames.
+	size_t checked_frame_count = std::min(peers[0].confirmed_hashes.size(), peers[1].confirmed_hashes.size());
+	int mismatch_count = 0;
+	MatchState reference_state = initial_state;
+
+	for (size_t checked_frame = 0; checked_frame < checked_frame_count; checked_frame++) {
+		uint32_t reference_hash = hash_match_state(reference_state);
+		if (peers[0].confirmed_hashes[checked_frame] != reference_hash || peers[1].confirmed_hashes[checked_frame] != reference_hash) {
+			if (mismatch_count == 0)
+				std::cerr << "Frame " << checked_frame << " doesn't match the reference match." << "\n";
+
+			mismatch_count++;
+		}
+
+		MatchInputs inputs;
+		if (checked_frame < peers[0].inputs_by_frame.size())
+			inputs.player_1 = peers[0].inputs_by_frame[checked_frame];
+		if (checked_frame < peers[1].inputs_by_frame.size())
+			inputs.player_2 = peers[1].inputs_by_frame[checked_frame];
+
+		reference_state = step(reference_state, inputs);
+	}
+
+	print_peer_stats(peers[0]);
+	print_peer_stats(peers[1]);
+
+	std::cout << "Lost " << links[0].lost_count << " of " << links[0].sent_count << " and " << links[1].lost_count << " of " << links[1].sent_count << " datagrams." << "\n";
+	std::cout << "Checked " << checked_frame_count << " confirmed frames against the reference match, the score ended up " << reference_state.player_1_score << " - " << reference_state.player_2_score
+		<< ". Took " << elapsed_ms << " ms." << "\n";
+
+	if (mismatch_count > 0 || peers[0].desync_detector.has_desynced || peers[1].desync_detector.has_desynced) {
+		std::cout << "FAILED, " << mismatch_count << " frames didn't match." << "\n";
+		return 1;
+	}
+
+	std::cout << "OK" << "\n";
+	return 0;
+}
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+#include <random>
+#include <string>
+#include "rollback_session.hpp"
+#include "desync_detector.hpp"
+
+// What "dingdong --rollback-test" runs with unless told otherwise.
+#define HARNESS_DEFAULT_LATENCY_MS 60.0
+#define HARNESS_DEFAULT_JITTER_MS 15.0
+#define HARNESS_DEFAULT_LOSS_PERCENT 5.0
+#define HARNESS_DEFAULT_SECONDS 300
+
+// One direction of a made up network link. Every datagram is either lost or delivered after the latency plus a random amount of jitter, so they can arrive out of order too.
+class SimulatedLink {
+	private:
+		struct InFlightDatagram {
+			double delivery_time = 0.0;
+			int length = 0;
+			uint8_t data[MAX_PACKET_LENGTH] = { 0 };
+		};
+
+		std::vector<InFlightDatagram> in_flight;
+		std::mt19937 random_generator;
+
+		double latency_ms = 0.0;
+		double jitter_ms = 0.0;
+		double loss_chance = 0.0;
+	public:
+		uint32_t sent_count = 0;
+		uint32_t lost_count = 0;
+
+		void init(double latency_ms_param, double jitter_ms_param, double loss_percent, uint32_t seed);
+		void send(const uint8_t* data, int length, double now);
+		int receive(double now, uint8_t* buffer);
+};
+
+int run_rollback_harness(int argc, char* argv[]);
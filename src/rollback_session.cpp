@@ -0,0 +1,125 @@
+#include "rollback_session.hpp"
+
+uint8_t pack_frame_input(const PaddleInput& input) {
+	return (input.up ? FRAME_INPUT_UP : 0) | (input.down ? FRAME_INPUT_DOWN : 0);
+}
+
+PaddleInput unpack_frame_input(uint8_t input) {
+	PaddleInput unpacked;
+	unpacked.up = (input & FRAME_INPUT_UP) != 0;
+	unpacked.down = (input & FRAME_INPUT_DOWN) != 0;
+	return unpacked;
+}
+
+void RollbackSession::init(const MatchState& initial_state, int local_player_param) {
+	*this = RollbackSession();
+
+	local_player = local_player_param;
+	current_state = initial_state;
+}
+
+MatchInputs RollbackSession::get_inputs(uint32_t input_frame) {
+	PaddleInput local_input = unpack_frame_input(local_inputs[input_frame % ROLLBACK_BUFFER_SIZE]);
+	PaddleInput remote_input = unpack_frame_input(remote_inputs[input_frame % ROLLBACK_BUFFER_SIZE]);
+
+	MatchInputs inputs;
+	inputs.player_1 = (local_player == 1) ? local_input : remote_input;
+	inputs.player_2 = (local_player == 1) ? remote_input : local_input;
+	return inputs;
+}
+
+// Whatever the other side did on the latest frame we know about, people tend to hold keys down for a while.
+uint8_t RollbackSession::predict_remote_input() {
+	return (remote_frame_count > 0) ? remote_inputs[(remote_frame_count - 1) % ROLLBACK_BUFFER_SIZE] : 0;
+}
+
+// Goes back to the first frame we got the other side's input wrong on and steps every frame since then again. Frames we still don't have the real input for get predicted again from the newest one we have.
+void RollbackSession::roll_back() {
+	auto start_time = std::chrono::steady_clock::now();
+
+	uint32_t depth = frame - first_mispredicted_frame;
+	current_state = states[first_mispredicted_frame % ROLLBACK_BUFFER_SIZE];
+
+	for (uint32_t resimulated_frame = first_mispredicted_frame; resimulated_frame < frame; resimulated_frame++) {
+		if (resimulated_frame >= remote_frame_count)
+			remote_inputs[resimulated_frame % ROLLBACK_BUFFER_SIZE] = predict_remote_input();
+
+		states[resimulated_frame % ROLLBACK_BUFFER_SIZE] = current_state;
+		current_state = step(current_state, get_inputs(resimulated_frame));
+	}
+
+	first_mispredicted_frame = NO_FRAME;
+
+	rollback_count++;
+	resimulated_frame_count += depth;
+	max_rollback_depth = std::max(max_rollback_depth, depth);
+	max_resimulation_ms = std::max(max_resimulation_ms, std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count());
+}
+
+// Steps the next frame, with local_input being applied ROLLBACK_INPUT_DELAY frames from now. Returns false without doing anything if we're too far ahead of the other side, the caller should keep sending its messages and try again the next frame.
+bool RollbackSession::advance(const PaddleInput& local_input) {
+	if (first_mispredicted_frame != NO_FRAME)
+		roll_back();
+
+	if (frame >= remote_frame_count + ROLLBACK_MAX_FRAMES) {
+		stall_count++;
+		return false;
+	}
+
+	local_inputs[(frame + ROLLBACK_INPUT_DELAY) % ROLLBACK_BUFFER_SIZE] = pack_frame_input(local_input);
+
+	if (frame >= remote_frame_count)
+		remote_inputs[frame % ROLLBACK_BUFFER_SIZE] = predict_remote_input();
+
+	states[frame % ROLLBACK_BUFFER_SIZE] = current_state;
+	current_state = step(current_state, get_inputs(frame));
+	frame++;
+
+	return true;
+}
+
+// Takes in the inputs we didn't have yet. The rollback they cause (if any) happens on the next advance, so several messages arriving at once only cost one.
+void RollbackSession::add_remote_inputs(const RollbackInputMessage& message) {
+	if (message.received_frame_count > acked_frame_count && message.received_frame_count <= frame + ROLLBACK_INPUT_DELAY)
+		acked_frame_count = message.received_frame_count;
+
+	for (int i = 0; i < message.input_count; i++) {
+		uint32_t input_frame = message.first_frame + i;
+
+		if (input_frame < remote_frame_count) // Already have it.
+			continue;
+
+		// Can't happen with how the messages are made, but a gap would leave us waiting for inputs that are never coming, and we can only store so far ahead.
+		if (input_frame > remote_frame_count || input_frame >= frame + ROLLBACK_BUFFER_SIZE - ROLLBACK_MAX_FRAMES)
+			break;
+
+		uint8_t input = message.inputs[i] & (FRAME_INPUT_UP | FRAME_INPUT_DOWN);
+		if (input_frame < frame && remote_inputs[input_frame % ROLLBACK_BUFFER_SIZE] != input)
+			first_mispredicted_frame = std::min(first_mispredicted_frame, input_frame);
+
+		remote_inputs[input_frame % ROLLBACK_BUFFER_SIZE] = input;
+		remote_frame_count++;
+	}
+}
+
+// Every input of ours the other side hasn't acknowledged yet, and how many of its inputs we have.
+void RollbackSession::make_input_message(RollbackInputMessage& message) {
+	uint32_t local_frame_count = frame + ROLLBACK_INPUT_DELAY;
+
+	message.first_frame = acked_frame_count;
+	message.received_frame_count = remote_frame_count;
+	message.input_count = static_cast<int>(std::min<uint32_t>(local_frame_count - acked_frame_count, MAX_INPUTS_PER_MESSAGE));
+
+	for (int i = 0; i < message.input_count; i++)
+		message.inputs[i] = local_inputs[(acked_frame_count + i) % ROLLBACK_BUFFER_SIZE];
+}
+
+// The latest frame whose starting state can't change anymore, as we have both sides' real inputs for every frame before it.
+uint32_t RollbackSession::get_confirmed_frame() const {
+	return std::min({ frame, remote_frame_count, first_mispredicted_frame });
+}
+
+// Only valid for the last ROLLBACK_MAX_FRAMES or so frames up to get_confirmed_frame().
+const MatchState& RollbackSession::get_confirmed_state(uint32_t confirmed_frame) const {
+	return (confirmed_frame == frame) ? current_state : states[confirmed_frame % ROLLBACK_BUFFER_SIZE];
+}
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <cstdint>
+#include <chrono>
+#include <algorithm>
+#include "protocol.hpp"
+#include "match_simulation.hpp"
+
+// Local inputs are applied this many frames after they're made, which hides that much of the round trip without ever having to roll back.
+#define ROLLBACK_INPUT_DELAY 2
+
+// How many frames we're allowed to run ahead of the other side's latest input, predicting what it's doing. This is also the furthest we ever roll back, so it's what bounds the resimulation cost of a frame.
+#define ROLLBACK_MAX_FRAMES 8
+
+// States and inputs are kept around for this many frames. Has to cover rolling back ROLLBACK_MAX_FRAMES on our side plus the other side being that far and its input delay ahead of us.
+#define ROLLBACK_BUFFER_SIZE 32
+
+static_assert(2 * (ROLLBACK_MAX_FRAMES + ROLLBACK_INPUT_DELAY) < ROLLBACK_BUFFER_SIZE, "ROLLBACK_BUFFER_SIZE is too small to roll back ROLLBACK_MAX_FRAMES.");
+static_assert(2 * (ROLLBACK_MAX_FRAMES + ROLLBACK_INPUT_DELAY) <= MAX_INPUTS_PER_MESSAGE, "A ROLLBACK_INPUT message has to be able to carry every input the other side might be missing.");
+
+#define NO_FRAME UINT32_MAX
+
+/*
+GGPO style rollback for a match between two peers that only ever send each other their inputs.
+Both sides step the match right away every frame, with whatever the other side did last standing in for its input until the real one comes in.
+The state at the start of each frame is saved, and when an input comes in that isn't what we predicted, we go back to the state of that frame and step everything since then again with the right inputs.
+Doesn't know about sockets or SDL, Game and the rollback test harness feed it the inputs and send its messages for it.
+*/
+class RollbackSession {
+	private:
+		int local_player = 1; // 1 or 2, which paddle the local inputs move.
+
+		MatchState current_state;
+		MatchState states[ROLLBACK_BUFFER_SIZE]; // The state at the start of each frame, indexed by frame number.
+		uint8_t local_inputs[ROLLBACK_BUFFER_SIZE] = { 0 }; // FRAME_INPUT_ flags.
+		uint8_t remote_inputs[ROLLBACK_BUFFER_SIZE] = { 0 }; // Either the other side's input, or what we predicted it to be if it hasn't arrived yet.
+
+		uint32_t frame = 0; // The next frame to be stepped. We have our own inputs up to frame + ROLLBACK_INPUT_DELAY.
+		uint32_t remote_frame_count = ROLLBACK_INPUT_DELAY; // We have the other side's real inputs for all frames before this one. The first ROLLBACK_INPUT_DELAY frames have no input on both sides.
+		uint32_t acked_frame_count = ROLLBACK_INPUT_DELAY; // How many of our inputs the other side has let us know it has.
+		uint32_t first_mispredicted_frame = NO_FRAME;
+
+		MatchInputs get_inputs(uint32_t input_frame);
+		uint8_t predict_remote_input();
+		void roll_back();
+	public:
+		// How the rollbacks went so far, for the harness and for logging.
+		uint32_t rollback_count = 0;
+		uint32_t resimulated_frame_count = 0;
+		uint32_t max_rollback_depth = 0;
+		uint32_t stall_count = 0;
+		double max_resimulation_ms = 0.0;
+
+		void init(const MatchState& initial_state, int local_player_param);
+		bool advance(const PaddleInput& local_input);
+		void add_remote_inputs(const RollbackInputMessage& message);
+		void make_input_message(RollbackInputMessage& message);
+
+		const MatchState& get_state() const { return current_state; }
+		uint32_t get_frame() const { return frame; }
+		uint32_t get_confirmed_frame() const;
+		const MatchState& get_confirmed_state(uint32_t confirmed_frame) const;
+};
+
+uint8_t pack_frame_input(const PaddleInput& input);
+PaddleInput unpack_frame_input(uint8_t input);
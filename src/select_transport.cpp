@@ -0,0 +1,70 @@
+#include "select_transport.hpp"
+
+bool SelectTransport::open(SOCKET sock_param) {
+	sock = sock_param;
+	return true;
+}
+
+bool SelectTransport::wait_until_readable(int timeout_us) {
+	fd_set read_set;
+	FD_ZERO(&read_set);
+	FD_SET(sock, &read_set);
+
+	timeval timeout;
+	timeout.tv_sec = timeout_us / 1000000;
+	timeout.tv_usec = timeout_us % 1000000;
+
+	syscall_count++;
+	return select(static_cast<int>(sock) + 1, &read_set, nullptr, nullptr, &timeout) > 0;
+}
+
+int SelectTransport::receive(Datagram* datagrams, int capacity, int timeout_us) {
+	if (pending_error != 0) {
+		last_error = pending_error;
+		pending_error = 0;
+		return SOCKET_ERROR;
+	}
+
+	if (timeout_us > 0 && !wait_until_readable(timeout_us))
+		return 0;
+
+	int count = 0;
+	while (count < capacity) {
+		socklen_t address_len = sizeof(datagrams[count].address);
+		syscall_count++; // Including the last one, which only finds out there's nothing left.
+		int receive_result = recvfrom(sock, (char*)datagrams[count].data, MAX_DATAGRAM_LENGTH, 0, (SOCKADDR*)&datagrams[count].address, &address_len);
+
+		if (receive_result == SOCKET_ERROR) {
+			int error = WSAGetLastError();
+			if (error == WSAEWOULDBLOCK)
+				break;
+
+			if (count > 0) { // Hand over what we've got first.
+				pending_error = error;
+				break;
+			}
+
+			last_error = error;
+			return SOCKET_ERROR;
+		}
+
+		datagrams[count].length = receive_result;
+		count++;
+	}
+
+	return count;
+}
+
+bool SelectTransport::send(const Datagram* datagrams, int count) {
+	bool has_sent_all = true;
+
+	for (int i = 0; i < count; i++) {
+		syscall_count++;
+		if (sendto(sock, (const char*)datagrams[i].data, datagrams[i].length, 0, (const SOCKADDR*)&datagrams[i].address, sizeof(datagrams[i].address)) == SOCKET_ERROR) {
+			last_error = WSAGetLastError();
+			has_sent_all = false;
+		}
+	}
+
+	return has_sent_all;
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include "transport.hpp"
+
+// select to wait, then one recvfrom/sendto per datagram. The only backend Winsock has, and the fallback everywhere else.
+class SelectTransport : public Transport {
+	private:
+		SOCKET sock = INVALID_SOCKET;
+
+		bool wait_until_readable(int timeout_us);
+	public:
+		bool open(SOCKET sock_param) override;
+		int receive(Datagram* datagrams, int capacity, int timeout_us) override;
+		bool send(const Datagram* datagrams, int count) override;
+};
@@ -0,0 +1,183 @@
+#include "shard_benchmark.hpp"
+
+#ifndef _WIN32
+#include <sys/resource.h>
+#endif
+
+// Every client needs a socket of its own, and at a few hundred clients per core that's more than the default limit on open files on most systems.
+static void raise_open_file_limit() {
+#ifndef _WIN32
+	rlimit limit;
+	if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+		limit.rlim_cur = limit.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &limit);
+	}
+#endif
+}
+
+static void close_client_sockets(std::vector<SOCKET>& sockets) {
+	for (SOCKET sock : sockets)
+		closesocket(sock);
+
+	sockets.clear();
+}
+
+static void send_syn(SOCKET sock, const SOCKADDR_IN& server_address) {
+	uint8_t data[MAX_DATAGRAM_LENGTH];
+	write_connection_id(data, NO_CONNECTION_ID);
+	int length = CONNECTION_ID_LENGTH + encode_handshake(MessageType::SYN, data + CONNECTION_ID_LENGTH, MAX_PACKET_LENGTH);
+
+	sendto(sock, (const char*)data, length, 0, (const SOCKADDR*)&server_address, sizeof(server_address));
+}
+
+// Opens a session for every client socket and returns how many of them got one. The clients never send anything after that, the server keeps their matches going against its AI until they time out.
+static int connect_clients(const std::vector<SOCKET>& sockets, const SOCKADDR_IN& server_address) {
+	std::vector<bool> is_connected(sockets.size(), false);
+	int connected_count = 0;
+
+	auto start_time = std::chrono::steady_clock::now();
+	double last_syn_ms = -SHARD_BENCHMARK_SYN_INTERVAL_MS;
+
+	while (connected_count < static_cast<int>(sockets.size())) {
+		double elapsed_ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+		if (elapsed_ms > SHARD_BENCHMARK_CONNECT_TIMEOUT_MS)
+			break;
+
+		bool should_send_syn = elapsed_ms - last_syn_ms >= SHARD_BENCHMARK_SYN_INTERVAL_MS;
+		if (should_send_syn)
+			last_syn_ms = elapsed_ms;
+
+		for (size_t i = 0; i < sockets.size(); i++) {
+			if (is_connected[i])
+				continue;
+
+			uint8_t data[MAX_DATAGRAM_LENGTH];
+			int length;
+			while ((length = recvfrom(sockets[i], (char*)data, MAX_DATAGRAM_LENGTH, 0, nullptr, nullptr)) > CONNECTION_ID_LENGTH) {
+				if (decode_handshake(data + CONNECTION_ID_LENGTH, length - CONNECTION_ID_LENGTH, MessageType::SYN_ACK)) {
+					is_connected[i] = true;
+					connected_count++;
+					break;
+				}
+			}
+
+			if (!is_connected[i] && should_send_syn)
+				send_syn(sockets[i], server_address);
+		}
+
+		std::this_thread::sleep_for(std::chrono::milliseconds(1));
+	}
+
+	return connected_count;
+}
+
+/*
+Runs a sharded server with thread_count shards on loopback, opens matches_per_thread sessions for each shard from as many client sockets, and times every shard's passes over its matches for the given number of seconds once their countdowns are over.
+The clients go quiet after the handshake, so what's measured is the server stepping every match against its AI and sending the snapshots, ball events and scores, not the clients' inputs.
+*/
+bool run_shard_scaling_step(int thread_count, int matches_per_thread, double seconds, ShardBenchmarkResult& result) {
+	ShardedMatchServer server;
+	server.is_verbose = false;
+	if (server.init(SHARD_BENCHMARK_PORT, thread_count * matches_per_thread * SHARD_BENCHMARK_SESSION_HEADROOM, thread_count) != 0)
+		return false;
+
+	SOCKADDR_IN server_address;
+	memset(&server_address, 0, sizeof(server_address));
+	server_address.sin_family = AF_INET;
+	server_address.sin_port = htons(SHARD_BENCHMARK_PORT);
+	server_address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	std::vector<SOCKET> sockets;
+	for (int i = 0; i < thread_count * matches_per_thread; i++) {
+		SOCKET sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+		if (sock == INVALID_SOCKET || !set_non_blocking(sock)) {
+			std::cerr << "Couldn't open a socket for client " << i << ": " << WSAGetLastError() << "\n";
+			if (sock != INVALID_SOCKET)
+				closesocket(sock);
+
+			close_client_sockets(sockets);
+			return false;
+		}
+
+		sockets.push_back(sock);
+	}
+
+	std::thread server_thread([&server]() { server.run(); });
+
+	result.thread_count = server.get_shard_count();
+	result.match_count = connect_clients(sockets, server_address);
+
+	// Nothing is stepped until the countdown is over.
+	std::this_thread::sleep_for(std::chrono::duration<double, std::milli>(MATCH_COUNTDOWN_MS + SIMULATION_STEP_MS));
+
+	for (int i = 0; i < result.thread_count; i++)
+		server.get_shard(i).is_timing_updates = true;
+
+	std::this_thread::sleep_for(std::chrono::duration<double>(seconds));
+
+	for (int i = 0; i < result.thread_count; i++)
+		server.get_shard(i).is_timing_updates = false;
+
+	server.stop();
+	server_thread.join();
+	close_client_sockets(sockets);
+
+	std::vector<float> update_times_ms;
+	double busy_fraction_sum = 0.0;
+	double matches_per_core_sum = 0.0;
+	for (int i = 0; i < result.thread_count; i++) {
+		MatchServer& shard = server.get_shard(i);
+
+		double busy_ms = 0.0;
+		for (float time_ms : shard.update_times_ms)
+			busy_ms += time_ms;
+
+		double busy_fraction = busy_ms / (seconds * 1000.0);
+		busy_fraction_sum += busy_fraction;
+		matches_per_core_sum += shard.get_session_count() / std::max(busy_fraction, 0.000001);
+
+		update_times_ms.insert(update_times_ms.end(), shard.update_times_ms.begin(), shard.update_times_ms.end());
+	}
+
+	result.busy_fraction = busy_fraction_sum / result.thread_count;
+	result.matches_per_core = matches_per_core_sum / result.thread_count;
+
+	if (!update_times_ms.empty()) {
+		size_t p99_index = update_times_ms.size() * 99 / 100;
+		std::nth_element(update_times_ms.begin(), update_times_ms.begin() + p99_index, update_times_ms.end());
+		result.p99_tick_ms = update_times_ms[p99_index];
+	}
+
+	return true;
+}
+
+/*
+"dingdong --shard-bench [matches per thread] [seconds] [max threads]" hosts that many matches per thread on 1, 2, 4 and so on up to max threads (all cores by default), and reports how the server scales:
+how many matches one core could host before its shard is busy all of the time, worked out from how busy the shards were with the matches they had, and the p99 of how long a pass over a shard's matches took.
+If it scales, neither of them changes as threads are added. The clients run on the same machine, but after the handshake they don't do anything.
+*/
+int run_shard_benchmark(int argc, char* argv[]) {
+	int matches_per_thread = std::max((argc > 2) ? std::atoi(argv[2]) : SHARD_BENCHMARK_DEFAULT_MATCHES_PER_THREAD, 1);
+	double seconds = std::clamp((argc > 3) ? std::atof(argv[3]) : SHARD_BENCHMARK_DEFAULT_SECONDS, 0.1, SESSION_TIMEOUT_MS / 1000.0 - 5.0); // The sessions time out if it runs longer.
+	int max_threads = std::clamp((argc > 4) ? std::atoi(argv[4]) : static_cast<int>(std::thread::hardware_concurrency()), 1, MAX_SERVER_SHARDS);
+
+	raise_open_file_limit();
+
+	std::cout << "Hosting " << matches_per_thread << " matches per thread for " << seconds << " seconds, on up to " << max_threads << " threads." << "\n";
+
+	for (int thread_count = 1; ; thread_count = std::min(thread_count * 2, max_threads)) {
+		ShardBenchmarkResult result;
+		if (!run_shard_scaling_step(thread_count, matches_per_thread, seconds, result)) {
+			std::cerr << "Couldn't run the server with " << thread_count << " threads." << "\n";
+			return 1;
+		}
+
+		std::cout << result.thread_count << ((result.thread_count == 1) ? " thread: " : " threads: ") << result.match_count << " matches, " << result.busy_fraction * 100.0 << "% busy, " << result.matches_per_core << " matches per core at full load, ";
+		std::cout << result.p99_tick_ms << " ms p99 tick latency." << "\n";
+
+		if (thread_count == max_threads)
+			break;
+	}
+
+	return 0;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+#include <thread>
+#include <chrono>
+#include <algorithm>
+#include "sharded_match_server.hpp"
+
+// What "dingdong --shard-bench" runs with unless told otherwise.
+#define SHARD_BENCHMARK_DEFAULT_MATCHES_PER_THREAD 200
+#define SHARD_BENCHMARK_DEFAULT_SECONDS 3.0
+
+// Out of the way of a server running on the default port.
+#define SHARD_BENCHMARK_PORT (DEFAULT_PORT + 1)
+
+// Clients send their SYN again this often until the SYN-ACK comes back, and give up after SHARD_BENCHMARK_CONNECT_TIMEOUT_MS.
+#define SHARD_BENCHMARK_SYN_INTERVAL_MS 100.0
+#define SHARD_BENCHMARK_CONNECT_TIMEOUT_MS 3000.0
+
+// Sessions are spread over the shards by the kernel hashing the client's address, so every shard gets room for more than its share.
+#define SHARD_BENCHMARK_SESSION_HEADROOM 2
+
+struct ShardBenchmarkResult {
+	int thread_count = 0;
+	int match_count = 0;
+	double matches_per_core = 0.0; // How many matches one of the shards could host before it's busy all of the time.
+	double busy_fraction = 0.0; // How much of the time the average shard spent updating its matches.
+	double p99_tick_ms = 0.0; // How long 99% of the passes over a shard's matches took at most, which is how late a tick can go out.
+};
+
+bool run_shard_scaling_step(int thread_count, int matches_per_thread, double seconds, ShardBenchmarkResult& result);
+int run_shard_benchmark(int argc, char* argv[]);
@@ -0,0 +1,82 @@
+#include "sharded_match_server.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+ShardedMatchServer::~ShardedMatchServer() {
+	stop();
+}
+
+// Returns last WSA error if any of the shards couldn't set up its socket, or 0 if the server is ready to run.
+// max_sessions is split evenly between the shards.
+int ShardedMatchServer::init(int port, int max_sessions, int shard_count, TransportBackend backend, double snapshot_bytes_per_second, AiDifficulty ai_difficulty) {
+#ifndef SO_REUSEPORT
+	if (shard_count > 1) {
+		std::cout << "This platform can't share a port between sockets, running a single shard." << "\n";
+		shard_count = 1;
+	}
+#endif
+
+	shard_count = std::clamp(shard_count, 1, MAX_SERVER_SHARDS);
+	int sessions_per_shard = (max_sessions + shard_count - 1) / shard_count;
+
+	shards.clear();
+	for (int i = 0; i < shard_count; i++) {
+		shards.push_back(std::make_unique<MatchServer>());
+		shards.back()->is_verbose = is_verbose;
+
+		int result = shards.back()->init(port, sessions_per_shard, i, shard_count, backend, snapshot_bytes_per_second, ai_difficulty);
+		if (result != 0) {
+			shards.clear();
+			return result;
+		}
+	}
+
+	if (shard_count > 1)
+		shards.front()->attach_shard_filter();
+
+	return 0;
+}
+
+void ShardedMatchServer::pin_current_thread(int core) {
+#ifdef _WIN32
+	if (SetThreadAffinityMask(GetCurrentThread(), static_cast<DWORD_PTR>(1) << core) == 0)
+		std::cerr << "Couldn't pin a shard to core " << core << ": " << GetLastError() << "\n";
+#else
+	cpu_set_t cpu_set;
+	CPU_ZERO(&cpu_set);
+	CPU_SET(core, &cpu_set);
+
+	int result = pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+	if (result != 0)
+		std::cerr << "Couldn't pin a shard to core " << core << ": " << result << "\n";
+#endif
+}
+
+// Blocks until stop is called from another thread.
+void ShardedMatchServer::run() {
+	int core_count = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+
+	for (size_t i = 0; i < shards.size(); i++) {
+		MatchServer* shard = shards[i].get();
+
+		threads.emplace_back([shard, i, core_count]() {
+			pin_current_thread(static_cast<int>(i) % core_count);
+			shard->run();
+		});
+	}
+
+	for (std::thread& thread : threads)
+		thread.join();
+
+	threads.clear();
+}
+
+void ShardedMatchServer::stop() {
+	for (auto& shard : shards)
+		shard->is_running = false;
+}
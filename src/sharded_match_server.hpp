@@ -0,0 +1,29 @@
+#pragma once
+
+#include <iostream>
+#include <vector>
+#include <memory>
+#include <thread>
+#include "match_server.hpp"
+
+#define MAX_SERVER_SHARDS 64
+
+// Runs one MatchServer per thread, all on the same port, with every thread pinned to its own core. Nothing is shared between the shards, every session lives and dies on the shard that opened it.
+// Needs SO_REUSEPORT for more than one shard, everywhere else it runs a single shard.
+class ShardedMatchServer {
+	private:
+		std::vector<std::unique_ptr<MatchServer>> shards;
+		std::vector<std::thread> threads;
+
+		static void pin_current_thread(int core);
+	public:
+		bool is_verbose = true; // Passed on to every shard, see MatchServer.
+
+		~ShardedMatchServer();
+		int init(int port, int max_sessions, int shard_count, TransportBackend backend = get_default_transport_backend(), double snapshot_bytes_per_second = DEFAULT_SNAPSHOT_BYTES_PER_SECOND, AiDifficulty ai_difficulty = DEFAULT_AI_DIFFICULTY);
+		void run();
+		void stop();
+
+		int get_shard_count() const { return static_cast<int>(shards.size()); }
+		MatchServer& get_shard(int index) { return *shards[index]; }
+};
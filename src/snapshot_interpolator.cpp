@@ -0,0 +1,87 @@
+#include "snapshot_interpolator.hpp"
+
+// Age 0 is the newest state, age 1 the one before it and so on.
+const RemoteState& SnapshotInterpolator::state_at(int age) {
+	return states[(newest_index - age + INTERPOLATION_BUFFER_SIZE) % INTERPOLATION_BUFFER_SIZE];
+}
+
+// snapshot_time is when the server was at the snapshot's tick on our clock, see ClockSync. arrival_time is when it got here, which is later by however long the trip took.
+void SnapshotInterpolator::push(double snapshot_time, double arrival_time, const SnapshotMessage& snapshot) {
+	// Time can't go backwards between snapshots, even if the clock estimate just moved, or the countdown (where every snapshot is on tick 0) just ended.
+	if (state_count > 0)
+		snapshot_time = std::max(snapshot_time, state_at(0).time);
+
+	double lateness = arrival_time - snapshot_time;
+
+	// Exponential moving averages of how far apart the snapshots are, how late they arrive and how much that varies. The delay is kept large enough to cover the usual interval and lateness plus a few deviations of it.
+	if (state_count == 0)
+		mean_lateness = lateness;
+	else {
+		double interval = snapshot_time - state_at(0).time;
+
+		if (mean_interval == 0.0)
+			mean_interval = interval;
+		else
+			mean_interval += (interval - mean_interval) * 0.1;
+
+		lateness_jitter += (std::abs(lateness - mean_lateness) - lateness_jitter) * 0.1;
+		mean_lateness += (lateness - mean_lateness) * 0.1;
+
+		target_delay = std::clamp(mean_interval + mean_lateness + lateness_jitter * 3.0, MIN_INTERPOLATION_DELAY, MAX_INTERPOLATION_DELAY);
+	}
+
+	newest_index = (newest_index + 1) % INTERPOLATION_BUFFER_SIZE;
+	state_count = std::min(state_count + 1, INTERPOLATION_BUFFER_SIZE);
+
+	RemoteState& state = states[newest_index];
+	state.time = snapshot_time;
+	state.server_tick = snapshot.server_tick;
+	state.player_1_y = snapshot.player_1_y;
+}
+
+// Returns false if there's nothing to sample yet.
+bool SnapshotInterpolator::sample(double now, RemoteState& sampled_state) {
+	if (state_count == 0)
+		return false;
+
+	// Ease the delay towards its target instead of jumping, so that remote things don't visibly skip back and forth in time when the network gets better or worse.
+	delay += (target_delay - delay) * 0.05;
+
+	double render_time = now - delay;
+
+	// Past the newest snapshot, so keep the server's clock running for a bit. The paddle stays where it was last seen.
+	const RemoteState& newest = state_at(0);
+	if (render_time >= newest.time) {
+		double extrapolation_time = std::min(render_time - newest.time, MAX_EXTRAPOLATION_TIME);
+
+		sampled_state = newest;
+		sampled_state.time = render_time;
+		sampled_state.server_tick += extrapolation_time / SIMULATION_STEP_MS;
+		return true;
+	}
+
+	// Find the two snapshots that render_time falls in between.
+	for (int age = 1; age < state_count; age++) {
+		const RemoteState& older = state_at(age);
+		const RemoteState& newer = state_at(age - 1);
+
+		if (render_time >= older.time) {
+			double t = (newer.time > older.time) ? (render_time - older.time) / (newer.time - older.time) : 1.0;
+
+			sampled_state = older;
+			sampled_state.time = render_time;
+			sampled_state.server_tick = older.server_tick + (newer.server_tick - older.server_tick) * t;
+			sampled_state.player_1_y = older.player_1_y + (newer.player_1_y - older.player_1_y) * t;
+			return true;
+		}
+	}
+
+	// Older than everything we have, which only happens right after the buffer was cleared. Hold the oldest snapshot until time catches up.
+	sampled_state = state_at(state_count - 1);
+	return true;
+}
+
+void SnapshotInterpolator::clear() {
+	newest_index = -1;
+	state_count = 0;
+}
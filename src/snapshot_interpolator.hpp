@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cmath>
+#include <algorithm>
+#include "protocol.hpp"
+#include "match_simulation.hpp"
+
+#define INTERPOLATION_BUFFER_SIZE 32
+
+// Remote entities are rendered this many milliseconds in the past, so that there's (almost) always a snapshot on both sides of the time we render at.
+// This includes the time snapshots take to get here, as they're placed at when the server was at their tick rather than at when they arrived.
+#define MIN_INTERPOLATION_DELAY 20.0
+#define MAX_INTERPOLATION_DELAY 500.0
+#define INITIAL_INTERPOLATION_DELAY 75.0
+
+// If the snapshots stop coming in, keep the server's clock running for at most this long before freezing everything. The ball follows its trajectory in the meantime.
+#define MAX_EXTRAPOLATION_TIME 1000.0
+
+// The parts of a snapshot that belong to things the client doesn't control itself.
+struct RemoteState {
+	double time = 0.0; // When the server was at the snapshot's tick, on our clock in milliseconds.
+
+	double server_tick = 0.0; // Where the ball is gets worked out from this and the ball's trajectory.
+	double player_1_y = 0.0;
+};
+
+// Jitter buffer on the client's side. Snapshots are pushed as they arrive and sampled every frame at (now - delay), where the delay follows how late and how unevenly the snapshots have been arriving.
+class SnapshotInterpolator {
+	private:
+		RemoteState states[INTERPOLATION_BUFFER_SIZE];
+		int newest_index = -1;
+		int state_count = 0;
+
+		double mean_interval = 0.0;
+		double mean_lateness = 0.0;
+		double lateness_jitter = 0.0;
+		double target_delay = INITIAL_INTERPOLATION_DELAY;
+		double delay = INITIAL_INTERPOLATION_DELAY;
+
+		const RemoteState& state_at(int age);
+	public:
+		void push(double snapshot_time, double arrival_time, const SnapshotMessage& snapshot);
+		bool sample(double now, RemoteState& sampled_state);
+		void clear();
+};
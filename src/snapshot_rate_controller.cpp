@@ -0,0 +1,148 @@
+#include "snapshot_rate_controller.hpp"
+
+// Before the first round trip is measured, a snapshot has this long to be acknowledged.
+#define SNAPSHOT_INITIAL_ACK_TIMEOUT_MS 1000.0
+
+// The fastest round trip creeps up by this much with every sample, so a route that got longer for good stops looking like congestion after a while.
+#define SNAPSHOT_MIN_RTT_DRIFT_MS 0.02
+
+// The bucket holds enough for a full snapshot interval's worth of bytes, or one full datagram if the cap is tiny, so a snapshot can always go out eventually.
+static double get_burst_bytes(double max_bytes_per_second) {
+	return std::max(max_bytes_per_second * SNAPSHOT_MAX_INTERVAL_MS / 1000.0, static_cast<double>(MAX_PACKET_LENGTH + DATAGRAM_HEADER_OVERHEAD));
+}
+
+void SnapshotRateController::reset(double now) {
+	double max_bytes_per_second_setting = max_bytes_per_second;
+	*this = SnapshotRateController();
+	max_bytes_per_second = max_bytes_per_second_setting;
+
+	available_bytes = get_burst_bytes(max_bytes_per_second);
+	last_refill_time = now;
+}
+
+// Called for everything sent to the client, not just snapshots, since it all goes through the same link. Snapshots are the only thing that waits for the budget though.
+void SnapshotRateController::note_sent_bytes(int message_length) {
+	if (message_length > 0)
+		available_bytes -= message_length + DATAGRAM_HEADER_OVERHEAD;
+}
+
+void SnapshotRateController::on_snapshot_sent(uint16_t sequence, double now) {
+	expire_lost_snapshots(now);
+
+	SentSnapshot& sent_snapshot = sent_snapshots[sequence % SNAPSHOT_HISTORY_SIZE];
+	if (sent_snapshot.is_pending) { // Still waiting on the one that was sent SNAPSHOT_HISTORY_SIZE snapshots ago, it's not coming.
+		record_loss_sample(1.0);
+		lost_count++;
+	}
+
+	sent_snapshot.sequence = sequence;
+	sent_snapshot.send_time = now;
+	sent_snapshot.is_pending = true;
+
+	last_snapshot_time = now;
+	has_sent_snapshot = true;
+	sent_count++;
+
+	if (is_congested())
+		update_backoff(now);
+}
+
+void SnapshotRateController::on_snapshot_acked(uint16_t sequence, double now) {
+	SentSnapshot& sent_snapshot = sent_snapshots[sequence % SNAPSHOT_HISTORY_SIZE];
+	if (!sent_snapshot.is_pending || sent_snapshot.sequence != sequence) // Already counted as lost, or too old to still be around.
+		return;
+
+	sent_snapshot.is_pending = false;
+	double rtt = now - sent_snapshot.send_time;
+
+	// RFC 6298, the variation gets updated with the old smoothed value first.
+	if (!has_rtt_sample) {
+		smoothed_rtt = min_rtt = rtt;
+		rtt_variation = rtt / 2.0;
+		has_rtt_sample = true;
+	}
+	else {
+		rtt_variation = 0.75 * rtt_variation + 0.25 * std::abs(smoothed_rtt - rtt);
+		smoothed_rtt = 0.875 * smoothed_rtt + 0.125 * rtt;
+		min_rtt = std::min(rtt, min_rtt + SNAPSHOT_MIN_RTT_DRIFT_MS);
+	}
+
+	record_loss_sample(0.0);
+
+	if (is_congested())
+		update_backoff(now);
+	else
+		backoff = std::max(1.0, backoff - SNAPSHOT_BACKOFF_RECOVERY);
+}
+
+void SnapshotRateController::expire_lost_snapshots(double now) {
+	double ack_timeout = get_ack_timeout();
+
+	for (SentSnapshot& sent_snapshot : sent_snapshots) {
+		if (sent_snapshot.is_pending && now - sent_snapshot.send_time > ack_timeout) {
+			sent_snapshot.is_pending = false;
+			record_loss_sample(1.0);
+			lost_count++;
+		}
+	}
+}
+
+// 1.0 for a lost snapshot, 0.0 for an acknowledged one. Averages over roughly the last 32 snapshots, so a single lost one doesn't count as congestion.
+void SnapshotRateController::record_loss_sample(double lost) {
+	loss_rate += (lost - loss_rate) / 32.0;
+}
+
+// Only backs off once per round trip, as that's how long it takes for the last back off to show up in the measurements.
+void SnapshotRateController::update_backoff(double now) {
+	if (now - last_backoff_time < std::max(smoothed_rtt, SNAPSHOT_MAX_INTERVAL_MS))
+		return;
+
+	backoff = std::min(backoff * SNAPSHOT_BACKOFF_FACTOR, SNAPSHOT_MAX_BACKOFF);
+	last_backoff_time = now;
+}
+
+void SnapshotRateController::refill(double now) {
+	available_bytes = std::min(available_bytes + max_bytes_per_second * (now - last_refill_time) / 1000.0, get_burst_bytes(max_bytes_per_second));
+	last_refill_time = now;
+}
+
+// How long after sending something to the client we should have heard back about it. ReliableEventChannel uses this as its retransmit timeout too.
+double SnapshotRateController::get_ack_timeout() const {
+	return has_rtt_sample ? smoothed_rtt + 4.0 * rtt_variation + SNAPSHOT_ACK_GRACE_MS : SNAPSHOT_INITIAL_ACK_TIMEOUT_MS;
+}
+
+bool SnapshotRateController::is_congested() const {
+	if (loss_rate > SNAPSHOT_CONGESTION_LOSS_RATE)
+		return true;
+
+	// Jitter alone can push the smoothed round trip above the fastest one, so that much doesn't count as queueing.
+	return has_rtt_sample && smoothed_rtt - min_rtt > SNAPSHOT_CONGESTION_QUEUE_DELAY_MS + rtt_variation;
+}
+
+double SnapshotRateController::get_send_interval(const MatchState& match) const {
+	double interval = SNAPSHOT_MAX_INTERVAL_MS;
+
+	// Nothing's moving during the countdown or after the match ended.
+	if (match.tick > 0 && !match.has_ended) {
+		int speed = std::max(std::abs(match.ball_velocity_x), 1);
+		interval = SNAPSHOT_MAX_INTERVAL_MS * to_fixed(MATCH_BALL_START_SPEED) / std::max(speed, to_fixed(MATCH_BALL_START_SPEED));
+
+		// How far the ball still has to go to reach the front of the paddle it's heading for. Negative once it's gotten past it.
+		int distance = (match.ball_velocity_x < 0) ? match.ball.x - (match.player_1.x + match.player_1.w) : match.player_2.x - (match.ball.x + match.ball.w);
+		if (distance / speed <= SNAPSHOT_NEAR_PADDLE_TICKS)
+			interval = SNAPSHOT_MIN_INTERVAL_MS;
+	}
+
+	return std::clamp(interval * backoff, SNAPSHOT_MIN_INTERVAL_MS, SNAPSHOT_MAX_INTERVAL_MS * SNAPSHOT_MAX_BACKOFF);
+}
+
+bool SnapshotRateController::should_send_snapshot(const MatchState& match, double now) {
+	if (has_sent_snapshot && now - last_snapshot_time < get_send_interval(match))
+		return false;
+
+	if (max_bytes_per_second <= 0.0)
+		return true;
+
+	refill(now);
+	return available_bytes >= 0.0;
+}
@@ -0,0 +1,88 @@
+#pragma once
+
+#include <cstdint>
+#include <cmath>
+#include <algorithm>
+#include "protocol.hpp"
+#include "match_simulation.hpp"
+
+// Never more than one snapshot per tick, as nothing would have changed in between.
+#define SNAPSHOT_MIN_INTERVAL_MS SIMULATION_STEP_MS
+
+// How far apart snapshots are while the ball moves at its starting speed and isn't about to reach a paddle. They get closer together the faster the ball goes.
+#define SNAPSHOT_MAX_INTERVAL_MS 100.0
+
+// Once the ball is this many ticks away from the paddle it's heading for, snapshots go out every tick until it gets there.
+#define SNAPSHOT_NEAR_PADDLE_TICKS 15
+
+// While the link looks congested, the interval gets multiplied by SNAPSHOT_BACKOFF_FACTOR at most once per round trip, up to SNAPSHOT_MAX_BACKOFF times longer.
+// Every acknowledged snapshot on a healthy link takes SNAPSHOT_BACKOFF_RECOVERY back off of it, so it takes a few seconds to get back to full rate.
+#define SNAPSHOT_BACKOFF_FACTOR 1.5
+#define SNAPSHOT_MAX_BACKOFF 4.0
+#define SNAPSHOT_BACKOFF_RECOVERY 0.1
+
+// The link counts as congested if more than this share of snapshots don't get acknowledged, or if the round trip has grown this much over the fastest one we've seen, which means some router is queueing our datagrams up.
+#define SNAPSHOT_CONGESTION_LOSS_RATE 0.1
+#define SNAPSHOT_CONGESTION_QUEUE_DELAY_MS 80.0
+
+// A snapshot counts as lost if it hasn't been acknowledged this long after the round trip time plus four times the jitter.
+#define SNAPSHOT_ACK_GRACE_MS 50.0
+
+// IPv4 and UDP headers, counted against the bitrate cap on top of every message.
+#define DATAGRAM_HEADER_OVERHEAD 28
+
+// 0 means snapshots aren't capped. "dingdong --server" takes a cap in kilobits per second, see run_headless_server.
+#define DEFAULT_SNAPSHOT_BYTES_PER_SECOND 0.0
+
+/*
+Picks when the server sends the next snapshot to one client.
+The ball's trajectory changes are already sent as ball events the moment they happen, snapshots are what keeps the paddles and the input acknowledgements flowing in between, so they matter most when the ball is fast or about to be hit.
+Every acknowledged snapshot gives a round trip time sample, smoothed the same way TCP does it, with the smoothed deviation standing in for the jitter. Snapshots that never get acknowledged count towards the loss rate.
+When either of those says the link is struggling, snapshots are backed off until it recovers, and everything sent to the client is charged against max_bytes_per_second, if set.
+Works on the network thread's clock in milliseconds, and only ever touched by the thread that sends the snapshots.
+*/
+class SnapshotRateController {
+	private:
+		struct SentSnapshot {
+			uint16_t sequence = 0;
+			double send_time = 0.0;
+			bool is_pending = false; // Neither acknowledged nor given up on yet.
+		};
+
+		SentSnapshot sent_snapshots[SNAPSHOT_HISTORY_SIZE];
+
+		double last_snapshot_time = 0.0;
+		bool has_sent_snapshot = false;
+
+		bool has_rtt_sample = false;
+		double min_rtt = 0.0;
+		double backoff = 1.0;
+		double last_backoff_time = 0.0;
+
+		double available_bytes = 0.0; // Token bucket for the bitrate cap, can go below 0 as a snapshot is never cut short.
+		double last_refill_time = 0.0;
+
+		void expire_lost_snapshots(double now);
+		void record_loss_sample(double lost);
+		void update_backoff(double now);
+		void refill(double now);
+	public:
+		double max_bytes_per_second = DEFAULT_SNAPSHOT_BYTES_PER_SECOND; // Survives reset, it's a setting rather than a measurement.
+
+		// What's been measured so far, exposed for logging.
+		double smoothed_rtt = 0.0;
+		double rtt_variation = 0.0; // The jitter.
+		double loss_rate = 0.0;
+		uint32_t sent_count = 0;
+		uint32_t lost_count = 0;
+
+		void reset(double now);
+		void note_sent_bytes(int message_length);
+		void on_snapshot_sent(uint16_t sequence, double now);
+		void on_snapshot_acked(uint16_t sequence, double now);
+
+		double get_ack_timeout() const;
+		bool is_congested() const;
+		double get_send_interval(const MatchState& match) const;
+		bool should_send_snapshot(const MatchState& match, double now);
+};
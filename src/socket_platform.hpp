@@ -0,0 +1,59 @@
+#pragma once
+
+// The network thread only needs plain BSD-style sockets, so it builds against Winsock on Windows and against the system headers everywhere else (which is how it gets tested over loopback on Linux).
+// Everything below maps the few Winsock names it uses onto their POSIX equivalents.
+
+#ifdef _WIN32
+#include <winsock2.h>
+#include <ws2tcpip.h>
+#else
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/select.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <cstring>
+
+typedef int SOCKET;
+typedef struct sockaddr SOCKADDR;
+typedef struct sockaddr_in SOCKADDR_IN;
+
+#define INVALID_SOCKET -1
+#define SOCKET_ERROR -1
+
+#define WSAEWOULDBLOCK EWOULDBLOCK
+#define WSAECONNRESET ECONNREFUSED // What Linux reports on a UDP socket when the other side's port isn't open, which is the case Winsock calls a reset.
+
+inline int WSAGetLastError() {
+	return errno;
+}
+
+inline int closesocket(SOCKET sock) {
+	return close(sock);
+}
+
+// Linux has epoll (and recvmmsg/sendmmsg to move a whole batch of datagrams with one call), io_uring on new enough headers, and lets a BPF program pick which SO_REUSEPORT socket gets a datagram.
+#ifdef __linux__
+#include <sys/epoll.h>
+#include <linux/filter.h>
+#define HAS_EPOLL
+#define HAS_REUSEPORT_FILTER
+#if __has_include(<linux/io_uring.h>)
+#define HAS_IO_URING
+#endif
+#endif
+#endif
+
+// Returns false if the socket couldn't be put in non-blocking mode, WSAGetLastError has the reason.
+inline bool set_non_blocking(SOCKET sock) {
+#ifdef _WIN32
+	unsigned long mode = 1;
+	return ioctlsocket(sock, FIONBIO, &mode) != SOCKET_ERROR;
+#else
+	int flags = fcntl(sock, F_GETFL, 0);
+	return flags != -1 && fcntl(sock, F_SETFL, flags | O_NONBLOCK) != -1;
+#endif
+}
@@ -0,0 +1,42 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// Fixed size lock-free queue for exactly one producer thread and one consumer thread.
+// The producer only ever writes tail and the consumer only ever writes head, so neither side has to wait for the other.
+template <typename T, size_t Capacity>
+class SpscQueue {
+	static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "SpscQueue capacity has to be a power of two.");
+
+	private:
+		T slots[Capacity];
+
+		// Kept on separate cache lines so the two threads don't keep stealing the same line from each other.
+		alignas(64) std::atomic<size_t> head{ 0 };
+		alignas(64) std::atomic<size_t> tail{ 0 };
+	public:
+		// Producer side. Returns false if the queue is full.
+		bool push(const T& item) {
+			size_t current_tail = tail.load(std::memory_order_relaxed);
+
+			if (current_tail - head.load(std::memory_order_acquire) == Capacity)
+				return false;
+
+			slots[current_tail & (Capacity - 1)] = item;
+			tail.store(current_tail + 1, std::memory_order_release);
+			return true;
+		}
+
+		// Consumer side. Returns false if the queue is empty.
+		bool pop(T& item) {
+			size_t current_head = head.load(std::memory_order_relaxed);
+
+			if (current_head == tail.load(std::memory_order_acquire))
+				return false;
+
+			item = slots[current_head & (Capacity - 1)];
+			head.store(current_head + 1, std::memory_order_release);
+			return true;
+		}
+};
@@ -0,0 +1,96 @@
+#include "step_benchmark.hpp"
+
+static PaddleInput get_random_input(std::mt19937& random_generator) {
+	PaddleInput input;
+	switch (random_generator() % 3) {
+		case 0:
+			input.up = true;
+			break;
+		case 1:
+			input.down = true;
+			break;
+		default:
+			break;
+	}
+
+	return input;
+}
+
+static std::vector<MatchInputs> create_scripted_inputs(uint32_t seed) {
+	std::mt19937 random_generator(seed);
+	std::vector<MatchInputs> inputs(STEP_BENCHMARK_INPUT_COUNT);
+
+	MatchInputs held;
+	for (int i = 0; i < STEP_BENCHMARK_INPUT_COUNT; i++) {
+		if (random_generator() % STEP_BENCHMARK_MAX_HOLD_TICKS == 0)
+			held.player_1 = get_random_input(random_generator);
+		if (random_generator() % STEP_BENCHMARK_MAX_HOLD_TICKS == 0)
+			held.player_2 = get_random_input(random_generator);
+
+		inputs[i] = held;
+	}
+
+	return inputs;
+}
+
+// Plays matches back to back with step() until step_count steps are done, a new one with the next seed every time one ends. Returns the hash of every match's final state combined, which is the same on every run with the same seed.
+// Both players follow the script if has_bots is false, otherwise they're get_ai_input like the arena's batch bots.
+static uint32_t run_steps(uint64_t step_count, uint32_t seed, const std::vector<MatchInputs>& scripted_inputs, bool has_bots, double& seconds) {
+	uint32_t match_seed = seed;
+	MatchState match = create_match(STEP_BENCHMARK_END_SCORE, match_seed);
+	uint32_t combined_hash = 0;
+
+	auto start_time = std::chrono::steady_clock::now();
+	for (uint64_t i = 0; i < step_count; i++) {
+		MatchInputs inputs;
+		if (has_bots) {
+			inputs.player_1 = get_ai_input(match, match.player_1);
+			inputs.player_2 = get_ai_input(match, match.player_2);
+		}
+		else
+			inputs = scripted_inputs[i % STEP_BENCHMARK_INPUT_COUNT];
+
+		match = step(match, inputs);
+
+		if (match.has_ended) {
+			combined_hash = combined_hash * 31 + hash_match_state(match);
+			match = create_match(STEP_BENCHMARK_END_SCORE, ++match_seed);
+		}
+	}
+	seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start_time).count();
+
+	return combined_hash * 31 + hash_match_state(match);
+}
+
+/*
+"dingdong --step-bench [steps] [seed]" times step() on one thread, the baseline for everything that runs the rules in bulk: bots, replays and hosting.
+It plays matches back to back, first with scripted inputs so that only step() itself is timed, then with get_ai_input on both sides. Each is run twice, and fails if the two runs don't end up in the same state.
+*/
+int run_step_benchmark(int argc, char* argv[]) {
+	uint64_t step_count = std::max<uint64_t>((argc > 2) ? std::strtoull(argv[2], nullptr, 10) : STEP_BENCHMARK_DEFAULT_STEPS, 1);
+	uint32_t seed = (argc > 3) ? static_cast<uint32_t>(std::strtoul(argv[3], nullptr, 10)) : STEP_BENCHMARK_DEFAULT_SEED;
+
+	std::vector<MatchInputs> scripted_inputs = create_scripted_inputs(seed);
+	std::cout << "Stepping " << step_count << " times on one thread, seeds " << seed << " and up." << "\n";
+
+	bool has_failed = false;
+	for (bool has_bots : { false, true }) {
+		double seconds = 0.0;
+		double repeat_seconds = 0.0;
+		uint32_t hash = run_steps(step_count, seed, scripted_inputs, has_bots, seconds);
+		uint32_t repeat_hash = run_steps(step_count, seed, scripted_inputs, has_bots, repeat_seconds);
+
+		double best_seconds = std::max(std::min(seconds, repeat_seconds), 0.000001);
+		std::cout << (has_bots ? "get_ai_input bots: " : "Scripted inputs: ") << step_count / best_seconds / 1000000.0 << " million steps/sec, " << 1000000000.0 * best_seconds / step_count << " ns per step";
+
+		if (hash == repeat_hash)
+			std::cout << ", both runs ended in the same state." << "\n";
+		else {
+			std::cout << ", but the two runs ended in different states." << "\n";
+			has_failed = true;
+		}
+	}
+
+	std::cout << (has_failed ? "FAILED" : "OK") << "\n";
+	return has_failed ? 1 : 0;
+}
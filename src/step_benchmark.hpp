@@ -0,0 +1,21 @@
+#pragma once
+
+#include <iostream>
+#include <cstdlib>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include "match_simulation.hpp"
+
+// What "dingdong --step-bench" runs with unless told otherwise.
+#define STEP_BENCHMARK_DEFAULT_STEPS 50000000
+#define STEP_BENCHMARK_DEFAULT_SEED 1
+
+#define STEP_BENCHMARK_END_SCORE 10
+
+// The scripted inputs are played on a loop, and every one of them is held for a few ticks like a player would.
+#define STEP_BENCHMARK_INPUT_COUNT 4096
+#define STEP_BENCHMARK_MAX_HOLD_TICKS 30
+
+int run_step_benchmark(int argc, char* argv[]);
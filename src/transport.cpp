@@ -0,0 +1,42 @@
+#include "transport.hpp"
+#include "select_transport.hpp"
+#include "epoll_transport.hpp"
+#include "io_uring_transport.hpp"
+
+std::unique_ptr<Transport> create_transport(TransportBackend backend) {
+	switch (backend) {
+		case TransportBackend::SELECT:
+			return std::make_unique<SelectTransport>();
+#ifdef HAS_EPOLL
+		case TransportBackend::EPOLL:
+			return std::make_unique<EpollTransport>();
+#endif
+#ifdef HAS_IO_URING
+		case TransportBackend::IO_URING:
+			return std::make_unique<IoUringTransport>();
+#endif
+		default:
+			return nullptr;
+	}
+}
+
+TransportBackend get_default_transport_backend() {
+#ifdef HAS_EPOLL
+	return TransportBackend::EPOLL;
+#else
+	return TransportBackend::SELECT;
+#endif
+}
+
+bool parse_transport_backend(const std::string& name, TransportBackend& backend) {
+	if (name == "select")
+		backend = TransportBackend::SELECT;
+	else if (name == "epoll")
+		backend = TransportBackend::EPOLL;
+	else if (name == "io_uring")
+		backend = TransportBackend::IO_URING;
+	else
+		return false;
+
+	return true;
+}
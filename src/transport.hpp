@@ -0,0 +1,50 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include "socket_platform.hpp"
+#include "protocol.hpp"
+
+#define RECEIVE_CONNRESET -1
+
+// The most datagrams a transport moves in one go, and the size of the batches NetworkThread and MatchServer hand it.
+#define TRANSPORT_BATCH_SIZE 32
+
+struct Datagram {
+	uint8_t data[MAX_DATAGRAM_LENGTH]; // The connection ID, then the message.
+	int length = 0; // Including the connection ID, or RECEIVE_CONNRESET if the connection was reset.
+	double arrival_time = 0.0; // get_network_time() when the network thread received it.
+	SOCKADDR_IN address; // Who sent it, or who it's going to.
+};
+
+enum class TransportBackend {
+	SELECT, // Plain select and recvfrom/sendto, works everywhere.
+	EPOLL, // Linux, epoll and recvmmsg/sendmmsg.
+	IO_URING // Linux, receives and sends asynchronously through an io_uring with registered buffers.
+};
+
+// Moves datagrams between a non-blocking UDP socket and the caller's batches, so that nothing above it has to know which OS calls that takes.
+// The socket still belongs to whoever created it and has to outlive the transport.
+class Transport {
+	protected:
+		int pending_error = 0; // An error that came up after some datagrams were already received, reported by the next receive.
+	public:
+		int last_error = 0; // Why the last call failed, same codes as WSAGetLastError.
+		uint64_t syscall_count = 0; // How many times receive and send called into the OS, so --transport-bench can tell what batching saves.
+
+		virtual ~Transport() {};
+
+		// Returns false if the backend couldn't be set up for this socket, last_error has the reason.
+		virtual bool open(SOCKET sock) = 0;
+
+		// Waits up to timeout_us for datagrams to come in, then receives up to capacity of them. Returns how many (0 if nothing came in), or SOCKET_ERROR.
+		virtual int receive(Datagram* datagrams, int capacity, int timeout_us) = 0;
+
+		// Sends every datagram to its address. Returns false if any of them couldn't be sent, the rest are still sent.
+		virtual bool send(const Datagram* datagrams, int count) = 0;
+};
+
+// Returns nullptr if the backend isn't available on this platform.
+std::unique_ptr<Transport> create_transport(TransportBackend backend);
+TransportBackend get_default_transport_backend();
+bool parse_transport_backend(const std::string& name, TransportBackend& backend);
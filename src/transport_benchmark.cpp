@@ -0,0 +1,214 @@
+#include "transport_benchmark.hpp"
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+static const char* get_transport_backend_name(TransportBackend backend) {
+	switch (backend) {
+		case TransportBackend::EPOLL:
+			return "epoll";
+		case TransportBackend::IO_URING:
+			return "io_uring";
+		default:
+			return "select";
+	}
+}
+
+// How much CPU time the calling thread has used so far, in and out of the kernel.
+static double get_thread_cpu_seconds() {
+#ifdef _WIN32
+	FILETIME creation_time, exit_time, kernel_time, user_time;
+	if (!GetThreadTimes(GetCurrentThread(), &creation_time, &exit_time, &kernel_time, &user_time))
+		return 0.0;
+
+	ULARGE_INTEGER kernel_ticks = { { kernel_time.dwLowDateTime, kernel_time.dwHighDateTime } };
+	ULARGE_INTEGER user_ticks = { { user_time.dwLowDateTime, user_time.dwHighDateTime } };
+	return static_cast<double>(kernel_ticks.QuadPart + user_ticks.QuadPart) / 10000000.0; // In 100 ns ticks.
+#else
+	timespec time;
+	clock_gettime(CLOCK_THREAD_CPUTIME_ID, &time);
+	return static_cast<double>(time.tv_sec) + static_cast<double>(time.tv_nsec) / 1000000000.0;
+#endif
+}
+
+static double get_milliseconds_since(std::chrono::steady_clock::time_point start_time) {
+	return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - start_time).count();
+}
+
+// A non-blocking UDP socket on a port of its own on loopback. Returns INVALID_SOCKET if it couldn't be set up.
+static SOCKET open_loopback_socket(SOCKADDR_IN& address) {
+	memset(&address, 0, sizeof(address));
+	address.sin_family = AF_INET;
+	address.sin_port = 0; // Whatever port is free.
+	address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+	SOCKET sock = socket(address.sin_family, SOCK_DGRAM, IPPROTO_UDP);
+	if (sock == INVALID_SOCKET)
+		return INVALID_SOCKET;
+
+	socklen_t address_length = sizeof(address);
+	if (bind(sock, (SOCKADDR*)&address, sizeof(address)) == SOCKET_ERROR || getsockname(sock, (SOCKADDR*)&address, &address_length) == SOCKET_ERROR || !set_non_blocking(sock)) {
+		std::cerr << "Couldn't set up a loopback socket: " << WSAGetLastError() << "\n";
+		closesocket(sock);
+		return INVALID_SOCKET;
+	}
+
+	return sock;
+}
+
+// Keeps up to TRANSPORT_BENCHMARK_WINDOW datagrams in flight to the server until datagram_count of them have been sent, and counts what comes back.
+static void run_echo_client(const SOCKADDR_IN& server_address, int datagram_count, TransportBenchmarkResult& result) {
+	SOCKADDR_IN address;
+	SOCKET sock = open_loopback_socket(address);
+	if (sock == INVALID_SOCKET)
+		return;
+
+	// The client is as fast as this platform gets, so it isn't what's being measured.
+	std::unique_ptr<Transport> transport = create_transport(get_default_transport_backend());
+	if (!transport->open(sock)) {
+		std::cerr << "Couldn't set up the client's transport: " << transport->last_error << "\n";
+		transport.reset();
+		closesocket(sock);
+		return;
+	}
+
+	Datagram batch[TRANSPORT_BATCH_SIZE];
+	int sent_count = 0;
+	int in_flight = 0;
+	auto last_echo_time = std::chrono::steady_clock::now();
+
+	while (sent_count < datagram_count || in_flight > 0) {
+		int send_count = std::min({ TRANSPORT_BENCHMARK_WINDOW - in_flight, datagram_count - sent_count, TRANSPORT_BATCH_SIZE });
+		for (int i = 0; i < send_count; i++) {
+			memset(batch[i].data, 0, TRANSPORT_BENCHMARK_DATAGRAM_LENGTH);
+			memcpy(batch[i].data, &sent_count, sizeof(sent_count));
+			batch[i].length = TRANSPORT_BENCHMARK_DATAGRAM_LENGTH;
+			batch[i].address = server_address;
+			sent_count++;
+		}
+
+		if (send_count > 0) {
+			transport->send(batch, send_count);
+			in_flight += send_count;
+		}
+
+		int received_count = transport->receive(batch, TRANSPORT_BATCH_SIZE, (in_flight == TRANSPORT_BENCHMARK_WINDOW) ? 1000 : 0);
+		if (received_count > 0) {
+			result.echoed_count += received_count;
+			in_flight -= std::min(received_count, in_flight);
+			last_echo_time = std::chrono::steady_clock::now();
+		}
+		else if (in_flight > 0 && get_milliseconds_since(last_echo_time) > TRANSPORT_BENCHMARK_STALL_MS) {
+			result.lost_count += in_flight;
+			in_flight = 0;
+			last_echo_time = std::chrono::steady_clock::now();
+		}
+	}
+
+	transport.reset();
+	closesocket(sock);
+}
+
+// Sends every datagram the transport receives straight back to where it came from, like a server that answers every message, while a client thread keeps it busy.
+// It receives and sends batch_size datagrams at a time at most, 1 to see what it costs to make a call per datagram.
+bool run_transport_echo(TransportBackend backend, int datagram_count, int batch_size, TransportBenchmarkResult& result) {
+	SOCKADDR_IN server_address;
+	SOCKET sock = open_loopback_socket(server_address);
+	if (sock == INVALID_SOCKET)
+		return false;
+
+	std::unique_ptr<Transport> transport = create_transport(backend);
+	if (transport == nullptr || !transport->open(sock)) {
+		transport.reset();
+		closesocket(sock);
+		return false;
+	}
+
+	std::atomic<bool> is_done{ false };
+	TransportBenchmarkResult client_result;
+
+	auto start_time = std::chrono::steady_clock::now();
+	double start_cpu_seconds = get_thread_cpu_seconds();
+
+	std::thread client([&]() {
+		run_echo_client(server_address, datagram_count, client_result);
+		is_done = true;
+	});
+
+	Datagram batch[TRANSPORT_BATCH_SIZE];
+	while (!is_done) {
+		int count = transport->receive(batch, batch_size, 1000);
+		if (count > 0)
+			transport->send(batch, count); // Every datagram still has its sender's address.
+	}
+
+	result = client_result;
+	result.cpu_seconds = get_thread_cpu_seconds() - start_cpu_seconds;
+	result.syscall_count = transport->syscall_count;
+	result.seconds = get_milliseconds_since(start_time) / 1000.0;
+
+	client.join();
+	transport.reset();
+	closesocket(sock);
+	return true;
+}
+
+/*
+"dingdong --transport-bench [transport] [datagrams] [batch size]" echoes that many datagrams through each transport (or just the one given) over loopback and reports how many it got through per second, how many calls into the OS it made per datagram, and how much CPU time the transport's thread spent per datagram to receive it and send it back.
+Unless a batch size is given, every transport is run one datagram at a time and TRANSPORT_BATCH_SIZE at a time, which is what recvmmsg/sendmmsg and io_uring are there for.
+A client thread on the platform's default transport keeps TRANSPORT_BENCHMARK_WINDOW datagrams in flight the whole time, so the transport is never waiting on it for long.
+*/
+int run_transport_benchmark(int argc, char* argv[]) {
+	TransportBackend backends[] = { TransportBackend::SELECT, TransportBackend::EPOLL, TransportBackend::IO_URING };
+	int backend_count = 3;
+
+	if (argc > 2 && std::string(argv[2]) != "all") {
+		if (!parse_transport_backend(argv[2], backends[0])) {
+			std::cerr << "Unknown transport \"" << argv[2] << "\", expected select, epoll, io_uring or all." << "\n";
+			return 1;
+		}
+
+		backend_count = 1;
+	}
+
+	int datagram_count = std::max((argc > 3) ? std::atoi(argv[3]) : TRANSPORT_BENCHMARK_DEFAULT_DATAGRAMS, 1);
+
+	int batch_sizes[] = { 1, TRANSPORT_BATCH_SIZE };
+	int batch_size_count = 2;
+	if (argc > 4) {
+		batch_sizes[0] = std::clamp(std::atoi(argv[4]), 1, TRANSPORT_BATCH_SIZE);
+		batch_size_count = 1;
+	}
+
+#ifdef _WIN32
+	WSADATA wsadata;
+	int startup_result = WSAStartup(MAKEWORD(2, 2), &wsadata);
+	if (startup_result != 0) {
+		std::cerr << "WSAStartup failed, error: " << startup_result << "\n";
+		return 1;
+	}
+#endif
+
+	std::cout << "Echoing " << datagram_count << " datagrams of " << TRANSPORT_BENCHMARK_DATAGRAM_LENGTH << " bytes over loopback, " << TRANSPORT_BENCHMARK_WINDOW << " in flight at once." << "\n";
+
+	for (int i = 0; i < backend_count; i++) {
+		for (int j = 0; j < batch_size_count; j++) {
+			TransportBenchmarkResult result;
+			if (!run_transport_echo(backends[i], datagram_count, batch_sizes[j], result)) {
+				std::cout << get_transport_backend_name(backends[i]) << ": not available here." << "\n";
+				break;
+			}
+
+			double echoed = static_cast<double>(std::max<uint64_t>(result.echoed_count, 1));
+			std::cout << get_transport_backend_name(backends[i]) << ", " << batch_sizes[j] << " at a time: " << result.echoed_count / std::max(result.seconds, 0.000001) << " datagrams/sec, ";
+			std::cout << result.syscall_count / echoed << " syscalls and " << result.cpu_seconds * 1000000.0 / echoed << " us of CPU per datagram received and sent back, " << result.lost_count << " lost." << "\n";
+		}
+	}
+
+#ifdef _WIN32
+	WSACleanup();
+#endif
+
+	return 0;
+}
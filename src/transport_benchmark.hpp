@@ -0,0 +1,34 @@
+#pragma once
+
+#include <iostream>
+#include <cstdlib>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <algorithm>
+#include <ctime>
+#include "transport.hpp"
+
+// What "dingdong --transport-bench" runs with unless told otherwise.
+#define TRANSPORT_BENCHMARK_DEFAULT_DATAGRAMS 500000
+
+// About as long as the average snapshot, see --protocol-bench.
+#define TRANSPORT_BENCHMARK_DATAGRAM_LENGTH (CONNECTION_ID_LENGTH + 16)
+
+// How many datagrams the client keeps in flight at once. Any more and they overflow the server socket's default receive buffer and get dropped, even on loopback.
+#define TRANSPORT_BENCHMARK_WINDOW 128
+
+// The client gives up on whatever is in flight if nothing came back for this long.
+#define TRANSPORT_BENCHMARK_STALL_MS 200.0
+
+struct TransportBenchmarkResult {
+	uint64_t echoed_count = 0;
+	uint64_t lost_count = 0;
+	double seconds = 0.0;
+	double cpu_seconds = 0.0; // Of the thread that ran the transport being measured.
+	uint64_t syscall_count = 0; // Same.
+};
+
+bool run_transport_echo(TransportBackend backend, int datagram_count, int batch_size, TransportBenchmarkResult& result);
+int run_transport_benchmark(int argc, char* argv[]);